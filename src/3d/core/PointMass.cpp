@@ -4,6 +4,14 @@ PointMass::PointMass(float mass, float x, float y, float z)
     : mass(mass), position(x, y, z), velocity(0, 0, 0), acceleration(0, 0, 0), fixed(false) {
 }
 
+std::atomic<unsigned long long> PointMass::pinVersion{0};
+
+void PointMass::setFixed(bool fixed) {
+    if (this->fixed == fixed) return;
+    this->fixed = fixed;
+    pinVersion.fetch_add(1, std::memory_order_relaxed);
+}
+
 void PointMass::update(float dt) {
     if (fixed) return;
 
@@ -20,3 +28,13 @@ void PointMass::applyForce(const Vector3D& force) {
 void PointMass::addSpring(Spring* spring) {
     springs.push_back(spring);
 }
+
+void PointMass::removeSpring(Spring* spring) {
+    for (size_t i = 0; i < springs.size(); ++i) {
+        if (springs[i] == spring) {
+            springs[i] = springs.back();
+            springs.pop_back();
+            return;
+        }
+    }
+}
@@ -3,6 +3,7 @@
 
 #include "Vector3D.h"
 #include "Spring.h"
+#include <atomic>
 #include <vector>
 
 class PointMass {
@@ -17,20 +18,35 @@ public:
     [[nodiscard]] Vector3D getAcceleration() const { return acceleration; }
     [[nodiscard]] float getMass() const { return mass; }
     [[nodiscard]] bool isFixed() const { return fixed; }
+    [[nodiscard]] int getIslandId() const { return islandId; }
 
-    void setFixed(bool fixed) { this->fixed = fixed; }
+    // Raw x, y, z storage, for exporting strided views of packed simulations
+    [[nodiscard]] float* positionData() { return &position.x; }
+    [[nodiscard]] float* velocityData() { return &velocity.x; }
+
+    void setFixed(bool fixed);
     void setPosition(const Vector3D& pos) { position = pos; }
     void setVelocity(const Vector3D& vel) { velocity = vel; }
+    void setIslandId(int id) { islandId = id; }
+    void clearAcceleration() { acceleration = Vector3D(0, 0, 0); }
 
     void addSpring(Spring* spring);
+    void removeSpring(Spring* spring);
     [[nodiscard]] const std::vector<Spring*>& getSprings() const { return springs; }
 
+    // Bumped whenever any point mass is pinned or unpinned, so owners can skip looking
+    // for pin changes while it stays the same
+    [[nodiscard]] static unsigned long long getPinVersion() { return pinVersion.load(std::memory_order_relaxed); }
+
 private:
+    static std::atomic<unsigned long long> pinVersion;
+
     float mass;
     Vector3D position;
     Vector3D velocity;
     Vector3D acceleration;
     bool fixed;
+    int islandId{-1};
     std::vector<Spring*> springs;
 };
 
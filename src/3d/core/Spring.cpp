@@ -15,7 +15,7 @@ Spring::Spring(PointMass* p1, PointMass* p2, float stiffness, float damping, flo
     p2->addSpring(this);
 }
 
-void Spring::applyForces() {
+float Spring::applyForces() {
     Vector3D p1 = pointMass1->getPosition();
     Vector3D p2 = pointMass2->getPosition();
     Vector3D v1 = pointMass1->getVelocity();
@@ -24,7 +24,7 @@ void Spring::applyForces() {
     Vector3D delta = p2 - p1;
     float currentLength = delta.magnitude();
 
-    if (currentLength == 0) return;
+    if (currentLength == 0) return currentLength;
 
     float displacement = currentLength - restLength;
     Vector3D springForce = delta.normalized() * (stiffness * displacement);
@@ -36,6 +36,7 @@ void Spring::applyForces() {
 
     pointMass1->applyForce(totalForce);
     pointMass2->applyForce(totalForce * -1.0f);
+    return currentLength;
 }
 
 float Spring::getCurrentLength() const {
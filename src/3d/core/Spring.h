@@ -8,7 +8,8 @@ class Spring {
 public:
     Spring(PointMass* p1, PointMass* p2, float stiffness, float damping, float restLength = -1.0f);
 
-    void applyForces();
+    // Applies spring and damping forces; returns the current length
+    float applyForces();
 
     [[nodiscard]] PointMass* getPointMass1() const { return pointMass1; }
     [[nodiscard]] PointMass* getPointMass2() const { return pointMass2; }
@@ -16,6 +17,9 @@ public:
     [[nodiscard]] float getStiffness() const { return stiffness; }
     [[nodiscard]] float getDamping() const { return damping; }
     [[nodiscard]] float getCurrentLength() const;
+    // Slot in the owning simulation's spring store, used for O(1) removal
+    [[nodiscard]] int getIndex() const { return index; }
+    void setIndex(int i) { index = i; }
 
 private:
     PointMass* pointMass1;
@@ -23,6 +27,7 @@ private:
     float stiffness;
     float damping;
     float restLength;
+    int index{-1};
 };
 
 
@@ -2,6 +2,13 @@
 #include "GLFWContext.h"
 #include <stdexcept>
 #include <iostream>
+#include <cstring>
+#ifdef PBD_X_HAS_EGL
+// No X11 headers: offscreen contexts never talk to a display server
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 
 static bool glfwInitialized = false;
 
@@ -27,44 +34,197 @@ void GLFWContext::terminate() {
     }
 }
 
-GLFWContext::GLFWContext(int width, int height, const std::string& title) {
-    initialize();
+GLFWContext::GLFWContext(int width, int height, const std::string& title, bool offscreen)
+    : offscreen(offscreen), width(width), height(height) {
+    if (offscreen) {
+        createOffscreenContext();
+    } else {
+        initialize();
+
+        window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+        if (!window) {
+            terminate();
+            throw std::runtime_error("Failed to create GLFW window");
+        }
+
+        glfwMakeContextCurrent(window);
+
+        if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
+            glfwDestroyWindow(window);
+            terminate();
+            throw std::runtime_error("Failed to initialize GLAD");
+        }
+    }
+
+    glEnable(GL_BLEND);
+    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LEQUAL);
+}
+
+#ifdef PBD_X_HAS_EGL
+void GLFWContext::createOffscreenContext() {
+    // Prefer Mesa's surfaceless platform, which needs no display server; otherwise use
+    // the default display with a pbuffer
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+    auto getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC) eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay && clientExtensions && std::strstr(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+        display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+        if (display != EGL_NO_DISPLAY && !eglInitialize(display, nullptr, nullptr)) display = EGL_NO_DISPLAY;
+    }
+    if (display == EGL_NO_DISPLAY) {
+        display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+        if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+            throw std::runtime_error("Failed to initialize an EGL display");
+        }
+    }
+    eglDisplay = display;
+
+    const EGLint configAttributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8,
+        EGL_NONE
+    };
+    EGLConfig config;
+    EGLint configCount = 0;
+    if (!eglBindAPI(EGL_OPENGL_API) || !eglChooseConfig(display, configAttributes, &config, 1, &configCount) ||
+        configCount < 1) {
+        destroy();
+        throw std::runtime_error("No EGL config supports desktop OpenGL");
+    }
+
+    const EGLint contextAttributes[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    eglContext = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+    if (eglContext == EGL_NO_CONTEXT) {
+        eglContext = nullptr;
+        destroy();
+        throw std::runtime_error("Failed to create an EGL OpenGL 3.3 context");
+    }
+
+    // Rendering goes to the framebuffer object, so a surface is only made when the
+    // display cannot make a context current without one
+    const char* displayExtensions = eglQueryString(display, EGL_EXTENSIONS);
+    if (!displayExtensions || !std::strstr(displayExtensions, "EGL_KHR_surfaceless_context")) {
+        const EGLint pbufferAttributes[] = {EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE};
+        eglSurface = eglCreatePbufferSurface(display, config, pbufferAttributes);
+        if (eglSurface == EGL_NO_SURFACE) {
+            eglSurface = nullptr;
+            destroy();
+            throw std::runtime_error("Failed to create an EGL pbuffer");
+        }
+    }
+    EGLSurface surface = eglSurface ? (EGLSurface) eglSurface : EGL_NO_SURFACE;
+    if (!eglMakeCurrent(display, surface, surface, (EGLContext) eglContext)) {
+        destroy();
+        throw std::runtime_error("Failed to make the EGL context current");
+    }
 
-    window = glfwCreateWindow(width, height, title.c_str(), nullptr, nullptr);
+    if (!gladLoadGLLoader((GLADloadproc) eglGetProcAddress)) {
+        destroy();
+        throw std::runtime_error("Failed to initialize GLAD");
+    }
+    createFramebuffer();
+}
+#else
+void GLFWContext::createOffscreenContext() {
+    // Without EGL the context comes from a hidden window, which still needs a display
+    initialize();
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    window = glfwCreateWindow(width, height, "", nullptr, nullptr);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_TRUE);
     if (!window) {
         terminate();
-        throw std::runtime_error("Failed to create GLFW window");
+        throw std::runtime_error("Failed to create a hidden GLFW window for offscreen rendering");
     }
 
     glfwMakeContextCurrent(window);
 
     if (!gladLoadGLLoader((GLADloadproc) glfwGetProcAddress)) {
-        glfwDestroyWindow(window);
+        destroy();
         terminate();
         throw std::runtime_error("Failed to initialize GLAD");
     }
+    createFramebuffer();
+}
+#endif
 
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
-    glEnable(GL_DEPTH_TEST);
-    glDepthFunc(GL_LEQUAL);
+void GLFWContext::createFramebuffer() {
+    glGenRenderbuffers(1, &colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+    glGenRenderbuffers(1, &depthBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    // Stays bound for the lifetime of the context, so draws and glReadPixels use it
+    glGenFramebuffers(1, &framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colorBuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depthBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        destroy();
+        throw std::runtime_error("Offscreen framebuffer is incomplete");
+    }
+    glViewport(0, 0, width, height);
 }
 
-GLFWContext::~GLFWContext() {
+void GLFWContext::destroy() {
+    if (framebuffer) {
+        glDeleteFramebuffers(1, &framebuffer);
+        glDeleteRenderbuffers(1, &colorBuffer);
+        glDeleteRenderbuffers(1, &depthBuffer);
+        framebuffer = colorBuffer = depthBuffer = 0;
+    }
+#ifdef PBD_X_HAS_EGL
+    if (eglDisplay) {
+        eglMakeCurrent((EGLDisplay) eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        if (eglSurface) eglDestroySurface((EGLDisplay) eglDisplay, (EGLSurface) eglSurface);
+        if (eglContext) eglDestroyContext((EGLDisplay) eglDisplay, (EGLContext) eglContext);
+        eglTerminate((EGLDisplay) eglDisplay);
+        eglDisplay = eglContext = eglSurface = nullptr;
+    }
+#endif
     if (window) {
         glfwDestroyWindow(window);
         window = nullptr;
     }
 }
 
+GLFWContext::~GLFWContext() {
+    destroy();
+}
+
 bool GLFWContext::shouldClose() const {
+    // Nobody can close an offscreen context; its owner decides how many frames to draw
+    if (offscreen) return false;
     return window ? glfwWindowShouldClose(window) : true;
 }
 
 void GLFWContext::pollEvents() const {
-    glfwPollEvents();
+    if (glfwInitialized) glfwPollEvents();
 }
 
 void GLFWContext::swapBuffers() const {
-    if (window) glfwSwapBuffers(window);
+    if (offscreen) {
+        glFlush();
+    } else if (window) {
+        glfwSwapBuffers(window);
+    }
+}
+
+void GLFWContext::getFramebufferSize(int& w, int& h) const {
+    if (offscreen) {
+        w = width;
+        h = height;
+    } else {
+        glfwGetFramebufferSize(window, &w, &h);
+    }
 }
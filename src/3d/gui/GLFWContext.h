@@ -4,21 +4,43 @@
 #include <string>
 #include <GLFW/glfw3.h>
 
+// A current OpenGL 3.3 core context. Windowed contexts present through GLFW. Offscreen
+// contexts render into a framebuffer object of the requested size and need no display:
+// with EGL available they are created surfaceless (Mesa) or on a pbuffer, otherwise on
+// a hidden GLFW window. swapBuffers only flushes them, so frames are not vsync-limited.
 class GLFWContext {
 public:
-    GLFWContext(int width, int height, const std::string& title);
+    GLFWContext(int width, int height, const std::string& title, bool offscreen = false);
     ~GLFWContext();
 
     bool shouldClose() const;
     void pollEvents() const;
     void swapBuffers() const;
+    // Null for offscreen contexts created through EGL
     GLFWwindow* getWindow() const { return window; }
+    [[nodiscard]] bool isOffscreen() const { return offscreen; }
+    // Size of the framebuffer rendered to: the window's, or the offscreen target's
+    void getFramebufferSize(int& w, int& h) const;
 
     static void initialize();
     static void terminate();
 
 private:
+    void createOffscreenContext();
+    void createFramebuffer();
+    void destroy();
+
     GLFWwindow* window{nullptr};
+    bool offscreen{false};
+    int width{0};
+    int height{0};
+    // EGL display, context and surface (EGL_NO_SURFACE when surfaceless)
+    void* eglDisplay{nullptr};
+    void* eglContext{nullptr};
+    void* eglSurface{nullptr};
+    unsigned int framebuffer{0};
+    unsigned int colorBuffer{0};
+    unsigned int depthBuffer{0};
 };
 
 #endif //PBD_X_GLFWCONTEXT_H
@@ -1,15 +1,28 @@
 #include <glad/glad.h>
 #include "OpenGLApplication3D.h"
+#include "../utils/SceneLoader.h"
+#include "../utils/Parallel.h"
 #include <GLFW/glfw3.h>
 #include <chrono>
+#include <cstdio>
 #include <iostream>
+#include <unordered_map>
 #include <glm/glm.hpp>
 
-OpenGLApplication3D::OpenGLApplication3D(int width, int height) {
-    ctx = std::make_unique<GLFWContext>(width, height, "PBD-X 3D Simulation");
+namespace {
+
+const char* DEMO_SCENE = R"(
+cloth position=0,2,0 size=8,8 spacing=0.2 pins=corners
+rope position=3,0,0 points=10 spacing=0.15 pins=first
+)";
+
+} // namespace
+
+OpenGLApplication3D::OpenGLApplication3D(int width, int height, const std::string& scenePath, bool offscreen) {
+    ctx = std::make_unique<GLFWContext>(width, height, "PBD-X 3D Simulation", offscreen);
     renderer = std::make_unique<OpenGLRenderer3D>(width, height);
 
-    GLFWwindow* window = ctx->getWindow();
+    GLFWwindow* window = ctx->isOffscreen() ? nullptr : ctx->getWindow();
     if (window) {
         glfwSetWindowUserPointer(window, this);
         glfwSetScrollCallback(window, [](GLFWwindow* w, double xoffset, double yoffset) {
@@ -23,10 +36,15 @@ OpenGLApplication3D::OpenGLApplication3D(int width, int height) {
         });
     }
 
-    sim.createCloth(0.0f, 2.0f, 0.0f, 8, 8, 0.2f);
-    sim.createRope(3.0f, 0.0f, 0.0f, 10, 0.15f);
+    SceneSettings scene = scenePath.empty() ? SceneLoader::loadFromString(DEMO_SCENE, sim, "demo")
+                                            : SceneLoader::load(scenePath, sim);
+    gravity = scene.gravity;
+    windForce = scene.wind;
+    windEnabled = scene.windEnabled;
+    // Torn springs are dropped from the uploaded topology at the next render
+    sim.setTearListener([this](PointMass* a, PointMass* b) { tornSprings.emplace_back(a, b); });
 
-    lastTime = glfwGetTime();
+    if (!offscreen) lastTime = glfwGetTime();
 }
 
 OpenGLApplication3D::~OpenGLApplication3D() {
@@ -34,6 +52,7 @@ OpenGLApplication3D::~OpenGLApplication3D() {
 }
 
 void OpenGLApplication3D::processInput() {
+    if (ctx->isOffscreen()) return;
     GLFWwindow* window = ctx->getWindow();
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS) {
         glfwSetWindowShouldClose(window, true);
@@ -62,15 +81,46 @@ void OpenGLApplication3D::processInput() {
     }
     wState = w;
 
+    static int tState = GLFW_RELEASE;
+    int t = glfwGetKey(window, GLFW_KEY_T);
+    if (t == GLFW_PRESS && tState == GLFW_RELEASE) {
+        tearingEnabled = !tearingEnabled;
+        sim.setTearingEnabled(tearingEnabled);
+        std::cout << "Tearing: " << (tearingEnabled ? "ON" : "OFF") << std::endl;
+    }
+    tState = t;
+
+    static int lState = GLFW_RELEASE;
+    int l = glfwGetKey(window, GLFW_KEY_L);
+    if (l == GLFW_PRESS && lState == GLFW_RELEASE) {
+        tethersEnabled = !tethersEnabled;
+        sim.setLongRangeAttachmentsEnabled(tethersEnabled);
+        std::cout << "Long-range attachments: " << (tethersEnabled ? "ON" : "OFF") << std::endl;
+    }
+    lState = l;
+
     double mouseX, mouseY;
     glfwGetCursorPos(window, &mouseX, &mouseY);
     int leftButton = glfwGetMouseButton(window, GLFW_MOUSE_BUTTON_LEFT);
     if (leftButton == GLFW_PRESS) {
-        if (!isDraggingCamera) {
-            // start drag
-            isDraggingCamera = true;
+        if (!isDraggingCamera && !isDraggingParticle) {
+            // start drag: grab what is under the cursor, or turn the camera
+            Vector3D origin, direction;
+            cursorRay(mouseX, mouseY, origin, direction);
+            PickHit hit = sim.pick(origin, direction, pickRadius);
+            if (hit.pointMass) {
+                isDraggingParticle = true;
+                grabDistance = hit.distance;
+                sim.grab(hit.pointMass, hit.point);
+            } else {
+                isDraggingCamera = true;
+            }
             lastMouseX = mouseX;
             lastMouseY = mouseY;
+        } else if (isDraggingParticle) {
+            Vector3D origin, direction;
+            cursorRay(mouseX, mouseY, origin, direction);
+            sim.setGrabTarget(origin + direction * grabDistance);
         } else {
             double dx = mouseX - lastMouseX;
             double dy = mouseY - lastMouseY;
@@ -81,6 +131,8 @@ void OpenGLApplication3D::processInput() {
         }
     } else {
         isDraggingCamera = false;
+        if (isDraggingParticle) sim.release();
+        isDraggingParticle = false;
     }
 
     if (glfwGetKey(window, GLFW_KEY_UP) == GLFW_PRESS) {
@@ -126,6 +178,17 @@ void OpenGLApplication3D::processInput() {
     }
     incState = inc;
 
+    static int mState = GLFW_RELEASE;
+    int m = glfwGetKey(window, GLFW_KEY_M);
+    if (m == GLFW_PRESS && mState == GLFW_RELEASE) {
+        renderMode = renderMode == RenderMode::Springs ? RenderMode::Surface
+                   : renderMode == RenderMode::Surface ? RenderMode::SurfaceAndSprings
+                                                       : RenderMode::Springs;
+        const char* names[] = {"springs", "surface", "surface and springs"};
+        std::cout << "Render mode: " << names[(int)renderMode] << std::endl;
+    }
+    mState = m;
+
     static int vState = GLFW_RELEASE;
     int v = glfwGetKey(window, GLFW_KEY_V);
     if (v == GLFW_PRESS && vState == GLFW_RELEASE) {
@@ -135,69 +198,143 @@ void OpenGLApplication3D::processInput() {
     vState = v;
 }
 
+void OpenGLApplication3D::cursorRay(double x, double y, Vector3D& origin, Vector3D& direction) const {
+    // Cursor positions are in window coordinates, which differ from framebuffer pixels on
+    // high-density displays
+    int width, height;
+    glfwGetWindowSize(ctx->getWindow(), &width, &height);
+    glm::vec3 o, d;
+    renderer->getCursorRay((float)x, (float)y, (float)std::max(width, 1), (float)std::max(height, 1), o, d);
+    origin = Vector3D(o.x, o.y, o.z);
+    direction = Vector3D(d.x, d.y, d.z);
+}
+
 void OpenGLApplication3D::render() {
     int w, h;
-    glfwGetFramebufferSize(ctx->getWindow(), &w, &h);
+    ctx->getFramebufferSize(w, h);
     renderer->setViewportSize(w, h);
 
     glClearColor(0.12f, 0.12f, 0.14f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    renderer->beginFrame();
     if (showGrid) {
         renderer->drawGrid(gridSpacing, glm::vec3(1.0f, 1.0f, 1.0f));
     }
 
+    const auto& points = sim.getPointMasses();
     const auto& springs = sim.getSprings();
-    std::vector<float> linePositions;
-    std::vector<glm::vec3> lineColors;
-    linePositions.reserve(springs.size() * 6);
-    lineColors.reserve(springs.size() * 2);
-
-    for (Spring* sp : springs) {
-        auto p1 = sp->getPointMass1()->getPosition();
-        auto p2 = sp->getPointMass2()->getPosition();
-        linePositions.push_back(p1.x);
-        linePositions.push_back(p1.y);
-        linePositions.push_back(p1.z);
-        linePositions.push_back(p2.x);
-        linePositions.push_back(p2.y);
-        linePositions.push_back(p2.z);
-
-        float currentLen = sp->getCurrentLength();
-        float restLen = sp->getRestLength();
-        float strain = (restLen > 0) ? (currentLen - restLen) / restLen : 0.0f;
-        
-        strain = std::max(0.0f, std::min(strain, 1.0f));
-        glm::vec3 color;
-        if (strain < 0.15f) {
-            color = glm::vec3(strain / 0.15f, 1.0f, 0.0f);
-        } else {
-            float t = (strain - 0.15f) / (1.0f - 0.15f);
-            color = glm::vec3(1.0f, 1.0f - t, 0.0f);
+    const auto& islands = sim.getIslands();
+    // Torn springs are swap-removed from what the renderer holds. Anything else that
+    // changes a count, or moves the point masses in storage, uploads the topology again.
+    // Islands are the bodies the renderer culls.
+    if (sim.getStorageVersion() == uploadedStorageVersion) {
+        for (const auto& [a, b] : tornSprings) {
+            auto slotA = particleSlots.find(a), slotB = particleSlots.find(b);
+            if (slotA != particleSlots.end() && slotB != particleSlots.end() &&
+                renderer->removeSpring(slotA->second, slotB->second)) {
+                uploadedSpringCount--;
+            }
         }
-        
-        lineColors.push_back(color);
-        lineColors.push_back(color);
     }
+    tornSprings.clear();
+    if ((int)springs.size() != uploadedSpringCount || (int)points.size() != uploadedPointCount ||
+        (int)islands.size() != uploadedBodyCount || sim.getStorageVersion() != uploadedStorageVersion) {
+        particleSlots.clear();
+        particleSlots.reserve(points.size());
+        for (int i = 0; i < (int)points.size(); ++i) particleSlots[points[i]] = i;
+
+        std::vector<RenderBody> bodies(islands.size(), RenderBody{0, 0, 0, 0, 0, 0});
+        std::vector<std::vector<const Spring*>> bodySprings(islands.size());
+        for (const Spring* sp : springs) bodySprings[sp->getPointMass1()->getIslandId()].push_back(sp);
+        std::vector<int> endpoints;
+        std::vector<float> restLengths;
+        endpoints.reserve(springs.size() * 2);
+        restLengths.reserve(springs.size());
+        for (size_t b = 0; b < islands.size(); ++b) {
+            bodies[b].firstSpring = (int)restLengths.size();
+            bodies[b].springCount = (int)bodySprings[b].size();
+            for (const Spring* sp : bodySprings[b]) {
+                endpoints.push_back(particleSlots[sp->getPointMass1()]);
+                endpoints.push_back(particleSlots[sp->getPointMass2()]);
+                restLengths.push_back(sp->getRestLength());
+            }
+        }
 
-    renderer->drawLinesWithColors(linePositions, lineColors);
+        const auto& surface = sim.getSurfaceTriangles();
+        std::vector<std::vector<int>> bodyTriangles(islands.size());
+        for (size_t t = 0; t + 2 < surface.size(); t += 3) {
+            auto& list = bodyTriangles[points[surface[t]]->getIslandId()];
+            list.insert(list.end(), surface.begin() + t, surface.begin() + t + 3);
+        }
+        std::vector<int> triangles;
+        triangles.reserve(surface.size());
+        for (size_t b = 0; b < islands.size(); ++b) {
+            bodies[b].firstTriangle = (int)(triangles.size() / 3);
+            bodies[b].triangleCount = (int)(bodyTriangles[b].size() / 3);
+            triangles.insert(triangles.end(), bodyTriangles[b].begin(), bodyTriangles[b].end());
+        }
 
-    const auto& points = sim.getPointMasses();
-    std::vector<float> pointPositions;
-    pointPositions.reserve(points.size() * 3);
-    for (PointMass* pm : points) {
-        auto pos = pm->getPosition();
-        pointPositions.push_back(pos.x);
-        pointPositions.push_back(pos.y);
-        pointPositions.push_back(pos.z);
+        std::vector<int> bodyParticles;
+        bodyParticles.reserve(points.size());
+        for (size_t b = 0; b < islands.size(); ++b) {
+            bodies[b].firstParticle = (int)bodyParticles.size();
+            bodies[b].particleCount = (int)islands[b].pointMasses.size();
+            for (const PointMass* pm : islands[b].pointMasses) bodyParticles.push_back(particleSlots[pm]);
+        }
+
+        renderer->setSceneTopology(endpoints, restLengths, triangles, bodyParticles, bodies);
+        uploadedSpringCount = (int)springs.size();
+        uploadedPointCount = (int)points.size();
+        uploadedBodyCount = (int)islands.size();
+        uploadedStorageVersion = sim.getStorageVersion();
     }
 
-    renderer->drawPoints(pointPositions, {0.2f, 0.7f, 0.9f}, 6.0f);
+    std::vector<float> pointPositions(points.size() * 3);
+    Parallel::forRange((int)points.size(), 65536, [&](int begin, int end) {
+        for (int i = begin; i < end; ++i) {
+            auto pos = points[i]->getPosition();
+            pointPositions[i * 3] = pos.x;
+            pointPositions[i * 3 + 1] = pos.y;
+            pointPositions[i * 3 + 2] = pos.z;
+        }
+    });
+    // Island bounds are refreshed by the last substep; pad them by the particle radius
+    std::vector<float> bodyBounds;
+    bodyBounds.reserve(islands.size() * 6);
+    for (const Island& island : islands) {
+        bodyBounds.insert(bodyBounds.end(), {island.boundsMin.x - particleRadius, island.boundsMin.y - particleRadius,
+                                             island.boundsMin.z - particleRadius, island.boundsMax.x + particleRadius,
+                                             island.boundsMax.y + particleRadius, island.boundsMax.z + particleRadius});
+    }
+
+    const bool surface = renderMode != RenderMode::Springs;
+    renderer->setParticles(pointPositions, bodyBounds, surface);
+    if (surface) renderer->drawSurface({0.75f, 0.55f, 0.35f});
+    if (renderMode != RenderMode::Surface) {
+        renderer->drawStrainLines();
+        renderer->drawParticleSpheres({0.2f, 0.7f, 0.9f}, particleRadius);
+    }
+    renderer->endFrame();
 }
 
-int OpenGLApplication3D::run() {
-    GLFWwindow* window = ctx->getWindow();
+void OpenGLApplication3D::setTelemetry(const std::string& path) {
+    telemetry = std::make_unique<Telemetry>(path);
+    sim.setDiagnosticsEnabled(true);
+}
 
+void OpenGLApplication3D::step(float dt) {
+    if (!telemetry) {
+        sim.update(dt);
+        return;
+    }
+    auto t0 = std::chrono::steady_clock::now();
+    sim.update(dt);
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    telemetry->record(sim, dt, ms);
+}
+
+int OpenGLApplication3D::run() {
     while (!ctx->shouldClose()) {
         processInput();
         ctx->pollEvents();
@@ -211,12 +348,12 @@ int OpenGLApplication3D::run() {
             if (dt <= 0.0f) dt = 0.0f;
             if (dt > 0.05f) dt = 0.05f;
             if (gravityEnabled) {
-                sim.applyGlobalForce(Vector3D(0, -9.81f, 0));
+                sim.applyGlobalForce(gravity);
             }
             if (windEnabled) {
                 sim.applyGlobalForce(windForce);
             }
-            sim.update(dt);
+            step(dt);
         }
 
         render();
@@ -226,3 +363,26 @@ int OpenGLApplication3D::run() {
 
     return 0;
 }
+
+int OpenGLApplication3D::capture(const std::string& directory, int frames, float dt) {
+    for (int frame = 0; frame < frames; ++frame) {
+        if (gravityEnabled) {
+            sim.applyGlobalForce(gravity);
+        }
+        if (windEnabled) {
+            sim.applyGlobalForce(windForce);
+        }
+        step(dt);
+
+        render();
+        ctx->swapBuffers();
+
+        char name[32];
+        std::snprintf(name, sizeof(name), "/frame_%05d.ppm", frame);
+        if (!renderer->saveFrameAsPPM(directory + name)) {
+            std::cerr << "Could not write " << directory + name << std::endl;
+            return 1;
+        }
+    }
+    return 0;
+}
@@ -5,27 +5,49 @@
 #include "OpenGLRenderer3D.h"
 #include "../simulation/Simulation.h"
 #include "../core/Vector3D.h"
+#include "../utils/Telemetry.h"
 #include <memory>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
 
 class OpenGLApplication3D {
 public:
-    OpenGLApplication3D(int width = 1024, int height = 768);
+    // Loads the scene file at scenePath, or the built-in demo scene when empty. An
+    // offscreen application renders into a framebuffer object and needs no display.
+    OpenGLApplication3D(int width = 1024, int height = 768, const std::string& scenePath = "",
+                        bool offscreen = false);
     ~OpenGLApplication3D();
 
+    // Interactive loop until the window closes; offscreen applications use capture()
     int run();
+    // Step the scene frames times by dt and write each rendered frame to
+    // directory/frame_NNNNN.ppm, without input or pacing; returns non-zero on failure
+    int capture(const std::string& directory, int frames, float dt = 1.0f / 60.0f);
+    // Log per-frame telemetry to path (CSV, or binary columns for a .bin path)
+    void setTelemetry(const std::string& path);
 
 private:
     void processInput();
+    // World-space ray under the cursor, from the camera of the last rendered frame
+    void cursorRay(double x, double y, Vector3D& origin, Vector3D& direction) const;
     void render();
+    // Advance the simulation, timing and logging the frame when telemetry is on
+    void step(float dt);
 
     std::unique_ptr<GLFWContext> ctx;
     std::unique_ptr<OpenGLRenderer3D> renderer;
     Simulation sim;
+    std::unique_ptr<Telemetry> telemetry;
 
     bool paused{false};
     double lastTime{0.0};
     bool gravityEnabled{true};
     bool windEnabled{false};
+    bool tearingEnabled{false};
+    bool tethersEnabled{false};
+    Vector3D gravity{0.0f, -9.81f, 0.0f};
     Vector3D windForce{5.0f, 0.0f, 5.0f};
     float cameraRotationSpeed{0.05f};
     float cameraZoomFactor{1.1f};
@@ -35,8 +57,26 @@ private:
     bool showGrid{false};
     float gridSpacing{0.5f};
     bool isDraggingCamera{false};
+    // A left press on a particle or surface drags it instead, through the simulation's
+    // grab spring, at the distance along the cursor ray it was picked at
+    bool isDraggingParticle{false};
+    float grabDistance{0.0f};
+    // World distance from the cursor ray within which particles are picked
+    float pickRadius{0.1f};
     double lastMouseX{0.0}, lastMouseY{0.0};
     float simulationSpeed{0.5f};
+    // Springs with strain colors and particles, shaded surfaces, or both; M cycles
+    enum class RenderMode { Springs, Surface, SurfaceAndSprings };
+    RenderMode renderMode{RenderMode::Springs};
+    float particleRadius{0.03f};
+    // Topology last handed to the renderer
+    int uploadedSpringCount{-1};
+    int uploadedPointCount{-1};
+    int uploadedBodyCount{-1};
+    unsigned long long uploadedStorageVersion{0};
+    // Slot of each point mass in the uploaded topology, and the springs torn since
+    std::unordered_map<const PointMass*, int> particleSlots;
+    std::vector<std::pair<PointMass*, PointMass*>> tornSprings;
 };
 
 #endif //PBD_X_OPENGLAPPLICATION_H
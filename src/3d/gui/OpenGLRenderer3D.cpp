@@ -5,13 +5,20 @@
 #include <iostream>
 #include <fstream>
 #include <cmath>
+#include <algorithm>
+#include <cstdint>
+#include "../utils/Parallel.h"
 
+// Camera matrices come from a uniform block filled once per frame and shared by
+// every program
 static const char* vertexSrc = R"(
 #version 330 core
 layout(location = 0) in vec3 aPos;
 layout(location = 1) in vec3 aColor;
-uniform mat4 uProjection;
-uniform mat4 uView;
+layout(std140) uniform Camera {
+    mat4 uProjection;
+    mat4 uView;
+};
 out vec3 vertexColor;
 void main() {
     gl_Position = uProjection * uView * vec4(aPos, 1.0);
@@ -22,18 +29,151 @@ void main() {
 static const char* fragmentSrc = R"(
 #version 330 core
 in vec3 vertexColor;
-uniform vec3 uColor;
 out vec4 FragColor;
 void main() {
-    // If vertex color is provided (non-zero), use it; otherwise use uniform color
-    if (length(vertexColor) > 0.0) {
-        FragColor = vec4(vertexColor, 1.0);
+    FragColor = vec4(vertexColor, 1.0);
+}
+)";
+
+// Positions come from a buffer texture of x, y, z floats per particle, so a vertex can
+// read the other end of its spring. Same ramp as the old CPU path: green to yellow up
+// to 15% strain, then to red at 100%.
+static const char* strainVertexSrc = R"(
+#version 330 core
+layout(location = 0) in ivec2 aEndpoints;
+layout(location = 1) in float aRestLength;
+layout(std140) uniform Camera {
+    mat4 uProjection;
+    mat4 uView;
+};
+uniform samplerBuffer uPositions;
+out vec3 vertexColor;
+vec3 particle(int i) {
+    return vec3(texelFetch(uPositions, i * 3).r, texelFetch(uPositions, i * 3 + 1).r, texelFetch(uPositions, i * 3 + 2).r);
+}
+void main() {
+    vec3 self = particle(aEndpoints.x);
+    vec3 other = particle(aEndpoints.y);
+    float strain = aRestLength > 0.0 ? (length(other - self) - aRestLength) / aRestLength : 0.0;
+    strain = clamp(strain, 0.0, 1.0);
+    if (strain < 0.15) {
+        vertexColor = vec3(strain / 0.15, 1.0, 0.0);
     } else {
-        FragColor = vec4(uColor, 1.0);
+        vertexColor = vec3(1.0, 1.0 - (strain - 0.15) / 0.85, 0.0);
     }
+    gl_Position = uProjection * uView * vec4(self, 1.0);
+}
+)";
+
+// Two-sided headlight shading; the view matrix is rigid, so it also rotates normals
+static const char* surfaceVertexSrc = R"(
+#version 330 core
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec3 aNormal;
+layout(std140) uniform Camera {
+    mat4 uProjection;
+    mat4 uView;
+};
+out vec3 viewNormal;
+void main() {
+    viewNormal = mat3(uView) * aNormal;
+    gl_Position = uProjection * uView * vec4(aPos, 1.0);
+}
+)";
+
+static const char* surfaceFragmentSrc = R"(
+#version 330 core
+in vec3 viewNormal;
+uniform vec3 uColor;
+out vec4 FragColor;
+void main() {
+    float facing = abs(normalize(viewNormal).z);
+    FragColor = vec4(uColor * (0.25 + 0.75 * facing), 1.0);
+}
+)";
+
+// One camera-facing quad per instance, centered on the particle at uFirst + gl_InstanceID
+// of the body particle list. The fragment shader carves the sphere out of the quad and
+// writes its true depth.
+static const char* sphereVertexSrc = R"(
+#version 330 core
+layout(location = 0) in vec2 aCorner;
+layout(std140) uniform Camera {
+    mat4 uProjection;
+    mat4 uView;
+};
+uniform samplerBuffer uPositions;
+uniform isamplerBuffer uParticles;
+uniform int uFirst;
+uniform float uRadius;
+out vec2 corner;
+out vec3 viewCenter;
+void main() {
+    int i = texelFetch(uParticles, uFirst + gl_InstanceID).r * 3;
+    vec3 center = vec3(texelFetch(uPositions, i).r, texelFetch(uPositions, i + 1).r, texelFetch(uPositions, i + 2).r);
+    vec4 view = uView * vec4(center, 1.0);
+    corner = aCorner;
+    viewCenter = view.xyz;
+    gl_Position = uProjection * (view + vec4(aCorner * uRadius, 0.0, 0.0));
+}
+)";
+
+static const char* sphereFragmentSrc = R"(
+#version 330 core
+in vec2 corner;
+in vec3 viewCenter;
+layout(std140) uniform Camera {
+    mat4 uProjection;
+    mat4 uView;
+};
+uniform vec3 uColor;
+uniform float uRadius;
+out vec4 FragColor;
+void main() {
+    float r2 = dot(corner, corner);
+    if (r2 > 1.0) discard;
+    vec3 normal = vec3(corner, sqrt(1.0 - r2));
+    vec4 clip = uProjection * vec4(viewCenter + normal * uRadius, 1.0);
+    gl_FragDepth = clip.z / clip.w * 0.5 + 0.5;
+    FragColor = vec4(uColor * (0.3 + 0.7 * normal.z), 1.0);
 }
 )";
 
+// Uniform buffer binding point of the Camera block
+static const unsigned int CAMERA_BINDING = 0;
+// Vertical field of view and clip planes of the camera
+static const float FIELD_OF_VIEW = glm::radians(45.0f);
+static const float NEAR_PLANE = 0.1f;
+static const float FAR_PLANE = 100.0f;
+// Springs worth drawing per pixel of a body's projected bounding square
+static const float SPRINGS_PER_PIXEL = 2.0f;
+// Bodies are never decimated below this many springs
+static const int MIN_LOD_SPRINGS = 64;
+// Particles per thread below which the normal pass runs inline
+static const int NORMALS_PER_THREAD = 16384;
+
+// Permutation of [0, n) in bit-reversed order: every prefix is spread evenly over the range
+// Unordered particle pair of a spring
+static uint64_t springKey(int a, int b) {
+    if (a > b) std::swap(a, b);
+    return ((uint64_t)(uint32_t)a << 32) | (uint32_t)b;
+}
+
+static std::vector<int> spreadOrder(int n) {
+    int bits = 0;
+    while ((1 << bits) < n) ++bits;
+    std::vector<int> order;
+    order.reserve(n);
+    for (int i = 0; i < (1 << bits); ++i) {
+        int reversed = 0;
+        for (int b = 0; b < bits; ++b) {
+            if (i & (1 << b)) reversed |= 1 << (bits - 1 - b);
+        }
+        if (reversed < n) order.push_back(reversed);
+    }
+    return order;
+}
+
 bool OpenGLRenderer3D::saveFrameAsPPM(const std::string& path) {
     if (viewportWidth <= 0 || viewportHeight <= 0) return false;
     int w = viewportWidth;
@@ -63,8 +203,21 @@ bool OpenGLRenderer3D::saveFrameAsPPM(const std::string& path) {
 OpenGLRenderer3D::OpenGLRenderer3D(int width, int height)
     : viewportWidth(width), viewportHeight(height) {
     shader = new Shader(vertexSrc, fragmentSrc);
-    ensureLineBuffers();
-    ensurePointBuffers();
+    strainShader = new Shader(strainVertexSrc, fragmentSrc);
+    shader->bindUniformBlock("Camera", CAMERA_BINDING);
+    strainShader->bindUniformBlock("Camera", CAMERA_BINDING);
+    strainShader->bind();
+    strainShader->setUniform1i("uPositions", 0);
+    surfaceShader = new Shader(surfaceVertexSrc, surfaceFragmentSrc);
+    surfaceShader->bindUniformBlock("Camera", CAMERA_BINDING);
+    sphereShader = new Shader(sphereVertexSrc, sphereFragmentSrc);
+    sphereShader->bindUniformBlock("Camera", CAMERA_BINDING);
+    sphereShader->bind();
+    sphereShader->setUniform1i("uPositions", 0);
+    sphereShader->setUniform1i("uParticles", 1);
+    sphereShader->unbind();
+    ensureFrameBuffers();
+    ensureSceneBuffers();
 }
 
 void OpenGLRenderer3D::rotateCameraX(float angle) {
@@ -87,40 +240,112 @@ void OpenGLRenderer3D::zoomCamera(float factor) {
     if (cameraDistance > 50.0f) cameraDistance = 50.0f;
 }
 
+void OpenGLRenderer3D::getCursorRay(float x, float y, float width, float height, glm::vec3& origin,
+                                    glm::vec3& direction) const {
+    // Unproject the cursor on the near and far planes
+    const float ndcX = 2.0f * x / width - 1.0f;
+    const float ndcY = 1.0f - 2.0f * y / height;
+    const glm::mat4 inverse = glm::inverse(frameViewProjection);
+    glm::vec4 nearPoint = inverse * glm::vec4(ndcX, ndcY, -1.0f, 1.0f);
+    glm::vec4 farPoint = inverse * glm::vec4(ndcX, ndcY, 1.0f, 1.0f);
+    origin = glm::vec3(nearPoint) / nearPoint.w;
+    direction = glm::normalize(glm::vec3(farPoint) / farPoint.w - origin);
+}
+
 OpenGLRenderer3D::~OpenGLRenderer3D() {
     delete shader;
-    if (lineVBO) glDeleteBuffers(1, &lineVBO);
-    if (lineColorVBO) glDeleteBuffers(1, &lineColorVBO);
-    if (lineVAO) glDeleteVertexArrays(1, &lineVAO);
-    if (pointVBO) glDeleteBuffers(1, &pointVBO);
-    if (pointVAO) glDeleteVertexArrays(1, &pointVAO);
-}
-
-void OpenGLRenderer3D::ensureLineBuffers() {
-    if (lineVAO == 0) {
-        glGenVertexArrays(1, &lineVAO);
-        glGenBuffers(1, &lineVBO);
-        glGenBuffers(1, &lineColorVBO);
-        glBindVertexArray(lineVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
+    delete strainShader;
+    delete surfaceShader;
+    delete sphereShader;
+    if (framePositionVBO) glDeleteBuffers(1, &framePositionVBO);
+    if (frameColorVBO) glDeleteBuffers(1, &frameColorVBO);
+    if (frameVAO) glDeleteVertexArrays(1, &frameVAO);
+    if (cameraUBO) glDeleteBuffers(1, &cameraUBO);
+    if (strainEndpointVBO) glDeleteBuffers(1, &strainEndpointVBO);
+    if (strainRestVBO) glDeleteBuffers(1, &strainRestVBO);
+    if (strainVAO) glDeleteVertexArrays(1, &strainVAO);
+    if (particleTexture) glDeleteTextures(1, &particleTexture);
+    if (particleBuffer) glDeleteBuffers(1, &particleBuffer);
+    if (surfaceNormalVBO) glDeleteBuffers(1, &surfaceNormalVBO);
+    if (surfaceEBO) glDeleteBuffers(1, &surfaceEBO);
+    if (surfaceVAO) glDeleteVertexArrays(1, &surfaceVAO);
+    if (sphereCornerVBO) glDeleteBuffers(1, &sphereCornerVBO);
+    if (sphereVAO) glDeleteVertexArrays(1, &sphereVAO);
+    if (bodyParticleTexture) glDeleteTextures(1, &bodyParticleTexture);
+    if (bodyParticleBuffer) glDeleteBuffers(1, &bodyParticleBuffer);
+}
+
+void OpenGLRenderer3D::ensureFrameBuffers() {
+    if (frameVAO == 0) {
+        glGenVertexArrays(1, &frameVAO);
+        glGenBuffers(1, &framePositionVBO);
+        glGenBuffers(1, &frameColorVBO);
+        glBindVertexArray(frameVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, framePositionVBO);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
-        glBindBuffer(GL_ARRAY_BUFFER, lineColorVBO);
+        glBindBuffer(GL_ARRAY_BUFFER, frameColorVBO);
         glEnableVertexAttribArray(1);
         glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
         glBindVertexArray(0);
+
+        glGenBuffers(1, &cameraUBO);
+        glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+        glBufferData(GL_UNIFORM_BUFFER, 2 * sizeof(glm::mat4), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BINDING, cameraUBO);
     }
 }
 
-void OpenGLRenderer3D::ensurePointBuffers() {
-    if (pointVAO == 0) {
-        glGenVertexArrays(1, &pointVAO);
-        glGenBuffers(1, &pointVBO);
-        glBindVertexArray(pointVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
+void OpenGLRenderer3D::ensureSceneBuffers() {
+    if (strainVAO == 0) {
+        glGenBuffers(1, &particleBuffer);
+        glGenTextures(1, &particleTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, particleBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, particleTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32F, particleBuffer);
+        glGenBuffers(1, &bodyParticleBuffer);
+        glGenTextures(1, &bodyParticleTexture);
+        glBindBuffer(GL_TEXTURE_BUFFER, bodyParticleBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, bodyParticleTexture);
+        glTexBuffer(GL_TEXTURE_BUFFER, GL_R32I, bodyParticleBuffer);
+        glBindTexture(GL_TEXTURE_BUFFER, 0);
+        glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+        glGenVertexArrays(1, &strainVAO);
+        glGenBuffers(1, &strainEndpointVBO);
+        glGenBuffers(1, &strainRestVBO);
+        glBindVertexArray(strainVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, strainEndpointVBO);
+        glEnableVertexAttribArray(0);
+        glVertexAttribIPointer(0, 2, GL_INT, 2 * sizeof(int), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, strainRestVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 1, GL_FLOAT, GL_FALSE, sizeof(float), (void*)0);
+
+        // The surface reads its positions straight from the particle buffer
+        glGenVertexArrays(1, &surfaceVAO);
+        glGenBuffers(1, &surfaceNormalVBO);
+        glGenBuffers(1, &surfaceEBO);
+        glBindVertexArray(surfaceVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, particleBuffer);
         glEnableVertexAttribArray(0);
         glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ARRAY_BUFFER, surfaceNormalVBO);
+        glEnableVertexAttribArray(1);
+        glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, 3 * sizeof(float), (void*)0);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, surfaceEBO);
+
+        const float corners[8] = {-1.0f, -1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, 1.0f};
+        glGenVertexArrays(1, &sphereVAO);
+        glGenBuffers(1, &sphereCornerVBO);
+        glBindVertexArray(sphereVAO);
+        glBindBuffer(GL_ARRAY_BUFFER, sphereCornerVBO);
+        glBufferData(GL_ARRAY_BUFFER, sizeof(corners), corners, GL_STATIC_DRAW);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 2 * sizeof(float), (void*)0);
         glBindVertexArray(0);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
     }
 }
 
@@ -130,96 +355,347 @@ void OpenGLRenderer3D::setViewportSize(int width, int height) {
     glViewport(0, 0, width, height);
 }
 
-void OpenGLRenderer3D::drawLines(const std::vector<float>& positions, const glm::vec3& color) {
-    if (positions.empty()) return;
-    shader->bind();
+void OpenGLRenderer3D::beginFrame() {
+    drawList.clear();
+    framePositions.clear();
+    frameColors.clear();
 
-    float aspect = (float)viewportWidth / (float)viewportHeight;
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-    
-    // Build view matrix with current camera rotation and distance
+    float aspect = viewportHeight > 0 ? (float)viewportWidth / (float)viewportHeight : 1.0f;
+    glm::mat4 camera[2];
+    camera[0] = glm::perspective(FIELD_OF_VIEW, aspect, NEAR_PLANE, FAR_PLANE);
     glm::vec3 camPos(
         cameraPanX + cameraDistance * sin(cameraRotY) * cos(cameraRotX),
         cameraPanY + cameraDistance * sin(cameraRotX),
         cameraPanZ + cameraDistance * cos(cameraRotY) * cos(cameraRotX)
     );
-    glm::mat4 view = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
-    
-    shader->setUniformMat4("uProjection", glm::value_ptr(proj));
-    shader->setUniformMat4("uView", glm::value_ptr(view));
-    
-    int loc = glGetUniformLocation(shader->getProgram(), "uColor");
-    glUniform3f(loc, color.r, color.g, color.b);
-
-    glBindVertexArray(lineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, lineColorVBO);
-    glBufferData(GL_ARRAY_BUFFER, 0, nullptr, GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_LINES, 0, (GLsizei)(positions.size() / 3));
-    glBindVertexArray(0);
+    camera[1] = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
+    frameViewProjection = camera[0] * camera[1];
+    frameCameraPosition = camPos;
+    glBindBuffer(GL_UNIFORM_BUFFER, cameraUBO);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(camera), glm::value_ptr(camera[0]));
+    glBindBuffer(GL_UNIFORM_BUFFER, 0);
+}
 
+void OpenGLRenderer3D::endFrame() {
+    if (drawList.empty()) return;
+    if (!framePositions.empty()) {
+        glBindBuffer(GL_ARRAY_BUFFER, framePositionVBO);
+        glBufferData(GL_ARRAY_BUFFER, framePositions.size() * sizeof(float), framePositions.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, frameColorVBO);
+        glBufferData(GL_ARRAY_BUFFER, frameColors.size() * sizeof(glm::vec3), frameColors.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+
+    // Program and vertex array only change between runs of different kinds
+    const Shader* bound = nullptr;
+    for (const DrawCommand& cmd : drawList) {
+        const Shader* wanted = shader;
+        unsigned int vao = frameVAO;
+        switch (cmd.kind) {
+            case DrawKind::StrainLines: wanted = strainShader; vao = strainVAO; break;
+            case DrawKind::Surface: wanted = surfaceShader; vao = surfaceVAO; break;
+            case DrawKind::Spheres: wanted = sphereShader; vao = sphereVAO; break;
+            default: break;
+        }
+        if (wanted != bound) {
+            wanted->bind();
+            glBindVertexArray(vao);
+            bound = wanted;
+        }
+        switch (cmd.kind) {
+            case DrawKind::Lines:
+                glDrawArrays(GL_LINES, cmd.first, cmd.count);
+                break;
+            case DrawKind::Points:
+                glPointSize(cmd.size);
+                glDrawArrays(GL_POINTS, cmd.first, cmd.count);
+                break;
+            case DrawKind::Triangles:
+                glDrawArrays(GL_TRIANGLES, cmd.first, cmd.count);
+                break;
+            case DrawKind::StrainLines:
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_BUFFER, particleTexture);
+                glMultiDrawArrays(GL_LINES, springFirsts.data(), springCounts.data(), (GLsizei)springFirsts.size());
+                glBindTexture(GL_TEXTURE_BUFFER, 0);
+                break;
+            case DrawKind::Surface:
+                surfaceShader->setUniform3f("uColor", cmd.color.r, cmd.color.g, cmd.color.b);
+                glMultiDrawElements(GL_TRIANGLES, triangleCounts.data(), GL_UNSIGNED_INT, triangleOffsets.data(),
+                                    (GLsizei)triangleCounts.size());
+                break;
+            case DrawKind::Spheres:
+                sphereShader->setUniform3f("uColor", cmd.color.r, cmd.color.g, cmd.color.b);
+                sphereShader->setUniform1f("uRadius", cmd.size);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_BUFFER, particleTexture);
+                glActiveTexture(GL_TEXTURE1);
+                glBindTexture(GL_TEXTURE_BUFFER, bodyParticleTexture);
+                // Without base instances (GL 4.2) each range passes its start as a uniform
+                for (size_t r = 0; r < particleFirsts.size(); ++r) {
+                    sphereShader->setUniform1i("uFirst", particleFirsts[r]);
+                    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, particleCounts[r]);
+                }
+                glBindTexture(GL_TEXTURE_BUFFER, 0);
+                glActiveTexture(GL_TEXTURE0);
+                glBindTexture(GL_TEXTURE_BUFFER, 0);
+                break;
+        }
+    }
+    glBindVertexArray(0);
     shader->unbind();
+    drawList.clear();
 }
 
-void OpenGLRenderer3D::drawLinesWithColors(const std::vector<float>& positions, const std::vector<glm::vec3>& colors) {
-    if (positions.empty() || colors.empty()) return;
-    shader->bind();
+void OpenGLRenderer3D::pushVertices(DrawKind kind, const std::vector<float>& positions, const glm::vec3* colors,
+                                    const glm::vec3& color, float pointSize) {
+    const int first = (int)(framePositions.size() / 3);
+    const int count = (int)(positions.size() / 3);
+    framePositions.insert(framePositions.end(), positions.begin(), positions.begin() + count * 3);
+    if (colors) frameColors.insert(frameColors.end(), colors, colors + count);
+    else frameColors.resize(frameColors.size() + count, color);
+
+    // Extend the previous command when it draws the same kind right before this range
+    if (!drawList.empty()) {
+        DrawCommand& last = drawList.back();
+        if (last.kind == kind && last.first + last.count == first && (kind != DrawKind::Points || last.size == pointSize)) {
+            last.count += count;
+            return;
+        }
+    }
+    drawList.push_back({kind, first, count, pointSize, color});
+}
 
-    float aspect = (float)viewportWidth / (float)viewportHeight;
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-    
-    // Build view matrix with current camera rotation and distance
-    glm::vec3 camPos(
-        cameraPanX + cameraDistance * sin(cameraRotY) * cos(cameraRotX),
-        cameraPanY + cameraDistance * sin(cameraRotX),
-        cameraPanZ + cameraDistance * cos(cameraRotY) * cos(cameraRotX)
-    );
-    glm::mat4 view = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
-    
-    shader->setUniformMat4("uProjection", glm::value_ptr(proj));
-    shader->setUniformMat4("uView", glm::value_ptr(view));
-
-    glBindVertexArray(lineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-    glBindBuffer(GL_ARRAY_BUFFER, lineColorVBO);
-    glBufferData(GL_ARRAY_BUFFER, colors.size() * sizeof(glm::vec3), colors.data(), GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_LINES, 0, (GLsizei)(positions.size() / 3));
+void OpenGLRenderer3D::setSceneTopology(const std::vector<int>& endpoints, const std::vector<float>& restLengths,
+                                        const std::vector<int>& triangles, const std::vector<int>& particles,
+                                        const std::vector<RenderBody>& sceneBodies) {
+    bodies = sceneBodies;
+    glBindBuffer(GL_TEXTURE_BUFFER, bodyParticleBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, particles.size() * sizeof(int), particles.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Two line vertices per spring, each naming its own particle first, in each body's
+    // level of detail order
+    vertexEndpoints.clear();
+    vertexRest.clear();
+    vertexEndpoints.reserve(restLengths.size() * 4);
+    vertexRest.reserve(restLengths.size() * 2);
+    springSlots.clear();
+    springSlots.reserve(restLengths.size());
+    springBodies.clear();
+    springBodies.reserve(restLengths.size());
+    for (size_t b = 0; b < bodies.size(); ++b) {
+        const RenderBody& body = bodies[b];
+        for (int k : spreadOrder(body.springCount)) {
+            const int s = body.firstSpring + k;
+            const int a = endpoints[s * 2], c = endpoints[s * 2 + 1];
+            springSlots[springKey(a, c)] = (int)springBodies.size();
+            springBodies.push_back((int)b);
+            vertexEndpoints.insert(vertexEndpoints.end(), {a, c, c, a});
+            vertexRest.push_back(restLengths[s]);
+            vertexRest.push_back(restLengths[s]);
+        }
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, strainEndpointVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexEndpoints.size() * sizeof(int), vertexEndpoints.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, strainRestVBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexRest.size() * sizeof(float), vertexRest.data(), GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    surfaceTriangles = triangles;
+    glBindVertexArray(surfaceVAO);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, surfaceTriangles.size() * sizeof(int), surfaceTriangles.data(), GL_STATIC_DRAW);
     glBindVertexArray(0);
 
-    shader->unbind();
+    // Triangles around each particle, for gathering vertex normals without write conflicts
+    int vertices = 0;
+    for (int v : surfaceTriangles) vertices = std::max(vertices, v + 1);
+    vertexTriangleStart.assign(vertices + 1, 0);
+    for (int v : surfaceTriangles) vertexTriangleStart[v + 1]++;
+    for (int v = 0; v < vertices; ++v) vertexTriangleStart[v + 1] += vertexTriangleStart[v];
+    vertexTriangles.resize(surfaceTriangles.size());
+    std::vector<int> fill(vertexTriangleStart.begin(), vertexTriangleStart.end() - 1);
+    for (size_t i = 0; i < surfaceTriangles.size(); ++i) {
+        vertexTriangles[fill[surfaceTriangles[i]]++] = (int)(i / 3);
+    }
 }
 
-void OpenGLRenderer3D::drawPoints(const std::vector<float>& positions, const glm::vec3& color, float size) {
+bool OpenGLRenderer3D::removeSpring(int a, int b) {
+    auto it = springSlots.find(springKey(a, b));
+    if (it == springSlots.end()) return false;
+    const int slot = it->second;
+    springSlots.erase(it);
+
+    // The body's last spring takes the slot, so its range stays contiguous; the detail
+    // order loses only that one spring's place
+    RenderBody& body = bodies[springBodies[slot]];
+    const int last = body.firstSpring + --body.springCount;
+    if (slot == last) return true;
+    std::copy_n(vertexEndpoints.begin() + last * 4, 4, vertexEndpoints.begin() + slot * 4);
+    std::copy_n(vertexRest.begin() + last * 2, 2, vertexRest.begin() + slot * 2);
+    springSlots[springKey(vertexEndpoints[slot * 4], vertexEndpoints[slot * 4 + 1])] = slot;
+
+    glBindBuffer(GL_ARRAY_BUFFER, strainEndpointVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, slot * 4 * sizeof(int), 4 * sizeof(int), &vertexEndpoints[slot * 4]);
+    glBindBuffer(GL_ARRAY_BUFFER, strainRestVBO);
+    glBufferSubData(GL_ARRAY_BUFFER, slot * 2 * sizeof(float), 2 * sizeof(float), &vertexRest[slot * 2]);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void OpenGLRenderer3D::setParticles(const std::vector<float>& positions, const std::vector<float>& bodyBounds,
+                                    bool surfaceNormals) {
+    particleCount = (int)(positions.size() / 3);
+    // Orphan and refill; the texture and vertex array views of the buffer stay valid
+    glBindBuffer(GL_TEXTURE_BUFFER, particleBuffer);
+    glBufferData(GL_TEXTURE_BUFFER, positions.size() * sizeof(float), positions.data(), GL_STREAM_DRAW);
+    glBindBuffer(GL_TEXTURE_BUFFER, 0);
+
+    // Frustum planes of the frame's camera (Gribb-Hartmann), as a, b, c, d with the
+    // inside positive
+    const glm::mat4& m = frameViewProjection;
+    float planes[6][4];
+    for (int p = 0; p < 6; ++p) {
+        const int row = p / 2;
+        const float sign = (p % 2 == 0) ? 1.0f : -1.0f;
+        for (int c = 0; c < 4; ++c) planes[p][c] = m[c][3] + sign * m[c][row];
+    }
+
+    const float pixelsPerUnit = 0.5f * (float)viewportHeight / std::tan(0.5f * FIELD_OF_VIEW);
+    stats = RenderStats();
+    springFirsts.clear();
+    springCounts.clear();
+    triangleCounts.clear();
+    triangleOffsets.clear();
+    particleFirsts.clear();
+    particleCounts.clear();
+    for (size_t b = 0; b < bodies.size(); ++b) {
+        const RenderBody& body = bodies[b];
+        if (b * 6 + 5 >= bodyBounds.size()) break;
+        const float* lo = &bodyBounds[b * 6];
+        const float* hi = lo + 3;
+
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; ++p) {
+            // Corner of the box farthest along the plane normal
+            const float x = planes[p][0] > 0.0f ? hi[0] : lo[0];
+            const float y = planes[p][1] > 0.0f ? hi[1] : lo[1];
+            const float z = planes[p][2] > 0.0f ? hi[2] : lo[2];
+            inside = planes[p][0] * x + planes[p][1] * y + planes[p][2] * z + planes[p][3] >= 0.0f;
+        }
+        if (!inside) {
+            stats.culledBodies++;
+            continue;
+        }
+        stats.visibleBodies++;
+
+        // Level of detail from the projected size of the bounding sphere
+        int springs = body.springCount;
+        const glm::vec3 center(0.5f * (lo[0] + hi[0]), 0.5f * (lo[1] + hi[1]), 0.5f * (lo[2] + hi[2]));
+        const float radius = 0.5f * std::sqrt((hi[0] - lo[0]) * (hi[0] - lo[0]) + (hi[1] - lo[1]) * (hi[1] - lo[1]) +
+                                              (hi[2] - lo[2]) * (hi[2] - lo[2]));
+        const float distance = glm::length(center - frameCameraPosition);
+        if (distance > radius) {
+            const float pixels = 2.0f * radius / distance * pixelsPerUnit;
+            const float budget = SPRINGS_PER_PIXEL * pixels * pixels;
+            springs = std::min(springs, std::max(MIN_LOD_SPRINGS, (int)budget));
+        }
+        if (springs > 0) {
+            springFirsts.push_back(body.firstSpring * 2);
+            springCounts.push_back(springs * 2);
+            stats.springsDrawn += springs;
+        }
+        // A subset of a surface leaves holes, so triangles are culled but not decimated
+        if (body.triangleCount > 0) {
+            triangleCounts.push_back(body.triangleCount * 3);
+            triangleOffsets.push_back((const void*)((size_t)body.firstTriangle * 3 * sizeof(int)));
+            stats.trianglesDrawn += body.triangleCount;
+        }
+        // Consecutive visible bodies share one sphere draw
+        if (body.particleCount > 0) {
+            if (!particleFirsts.empty() && particleFirsts.back() + particleCounts.back() == body.firstParticle) {
+                particleCounts.back() += body.particleCount;
+            } else {
+                particleFirsts.push_back(body.firstParticle);
+                particleCounts.push_back(body.particleCount);
+            }
+            stats.particlesDrawn += body.particleCount;
+        }
+    }
+
+    if (surfaceNormals && !triangleCounts.empty()) {
+        computeNormals(positions);
+        glBindBuffer(GL_ARRAY_BUFFER, surfaceNormalVBO);
+        glBufferData(GL_ARRAY_BUFFER, vertexNormals.size() * sizeof(float), vertexNormals.data(), GL_STREAM_DRAW);
+        glBindBuffer(GL_ARRAY_BUFFER, 0);
+    }
+}
+
+void OpenGLRenderer3D::computeNormals(const std::vector<float>& positions) {
+    const int triangles = (int)(surfaceTriangles.size() / 3);
+    const int vertices = (int)vertexTriangleStart.size() - 1;
+    faceNormals.resize((size_t)triangles * 3);
+    vertexNormals.assign((size_t)particleCount * 3, 0.0f);
+
+    // Area-weighted face normals, then each vertex sums its own triangles
+    Parallel::forRange(triangles, NORMALS_PER_THREAD, [&](int begin, int end) {
+        for (int t = begin; t < end; ++t) {
+            const float* a = &positions[surfaceTriangles[t * 3] * 3];
+            const float* b = &positions[surfaceTriangles[t * 3 + 1] * 3];
+            const float* c = &positions[surfaceTriangles[t * 3 + 2] * 3];
+            const float e1[3] = {b[0] - a[0], b[1] - a[1], b[2] - a[2]};
+            const float e2[3] = {c[0] - a[0], c[1] - a[1], c[2] - a[2]};
+            faceNormals[t * 3] = e1[1] * e2[2] - e1[2] * e2[1];
+            faceNormals[t * 3 + 1] = e1[2] * e2[0] - e1[0] * e2[2];
+            faceNormals[t * 3 + 2] = e1[0] * e2[1] - e1[1] * e2[0];
+        }
+    });
+    Parallel::forRange(std::min(vertices, particleCount), NORMALS_PER_THREAD, [&](int begin, int end) {
+        for (int v = begin; v < end; ++v) {
+            float n[3] = {0.0f, 0.0f, 0.0f};
+            for (int k = vertexTriangleStart[v]; k < vertexTriangleStart[v + 1]; ++k) {
+                const int t = vertexTriangles[k];
+                n[0] += faceNormals[t * 3];
+                n[1] += faceNormals[t * 3 + 1];
+                n[2] += faceNormals[t * 3 + 2];
+            }
+            const float length = std::sqrt(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+            const float inv = length > 0.0f ? 1.0f / length : 0.0f;
+            vertexNormals[v * 3] = n[0] * inv;
+            vertexNormals[v * 3 + 1] = n[1] * inv;
+            vertexNormals[v * 3 + 2] = n[2] * inv;
+        }
+    });
+}
+
+void OpenGLRenderer3D::drawStrainLines() {
+    if (springFirsts.empty()) return;
+    drawList.push_back({DrawKind::StrainLines, 0, 0, 1.0f, glm::vec3(0.0f)});
+}
+
+void OpenGLRenderer3D::drawSurface(const glm::vec3& color) {
+    if (triangleCounts.empty()) return;
+    drawList.push_back({DrawKind::Surface, 0, 0, 1.0f, color});
+}
+
+void OpenGLRenderer3D::drawParticleSpheres(const glm::vec3& color, float radius) {
+    if (particleFirsts.empty()) return;
+    drawList.push_back({DrawKind::Spheres, 0, 0, radius, color});
+}
+
+void OpenGLRenderer3D::drawLines(const std::vector<float>& positions, const glm::vec3& color) {
     if (positions.empty()) return;
-    shader->bind();
+    pushVertices(DrawKind::Lines, positions, nullptr, color);
+}
 
-    float aspect = (float)viewportWidth / (float)viewportHeight;
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-    
-    // Build view matrix with current camera rotation and distance
-    glm::vec3 camPos(
-        cameraPanX + cameraDistance * sin(cameraRotY) * cos(cameraRotX),
-        cameraPanY + cameraDistance * sin(cameraRotX),
-        cameraPanZ + cameraDistance * cos(cameraRotY) * cos(cameraRotX)
-    );
-    glm::mat4 view = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
-    
-    shader->setUniformMat4("uProjection", glm::value_ptr(proj));
-    shader->setUniformMat4("uView", glm::value_ptr(view));
-    
-    int loc = glGetUniformLocation(shader->getProgram(), "uColor");
-    glUniform3f(loc, color.r, color.g, color.b);
-
-    glPointSize(size);
-    glBindVertexArray(pointVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, pointVBO);
-    glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_POINTS, 0, (GLsizei)(positions.size() / 3));
-    glBindVertexArray(0);
+void OpenGLRenderer3D::drawLinesWithColors(const std::vector<float>& positions, const std::vector<glm::vec3>& colors) {
+    if (positions.empty() || colors.size() < positions.size() / 3) return;
+    pushVertices(DrawKind::Lines, positions, colors.data(), glm::vec3(0.0f));
+}
 
-    shader->unbind();
+void OpenGLRenderer3D::drawPoints(const std::vector<float>& positions, const glm::vec3& color, float size) {
+    if (positions.empty()) return;
+    pushVertices(DrawKind::Points, positions, nullptr, color, size);
 }
 
 void OpenGLRenderer3D::drawGrid(float spacing, const glm::vec3& color) {
@@ -227,9 +703,6 @@ void OpenGLRenderer3D::drawGrid(float spacing, const glm::vec3& color) {
 
     // Determine extent based on camera distance
     float extent = cameraDistance * 1.5f;
-    int lines = (int)std::ceil((extent * 2.0f) / spacing);
-    if (lines < 2) lines = 2;
-
     float half = extent;
     std::vector<float> positions;
     // lines parallel to Z (vary X)
@@ -252,33 +725,7 @@ void OpenGLRenderer3D::drawGrid(float spacing, const glm::vec3& color) {
         positions.push_back(cameraPanY);
         positions.push_back(z + cameraPanZ);
     }
-
-    if (!positions.empty()) {
-        // draw as lines using uniform color (disable per-vertex color attribute)
-        shader->bind();
-        float aspect = (float)viewportWidth / (float)viewportHeight;
-        glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-        glm::vec3 camPos(
-            cameraPanX + cameraDistance * sin(cameraRotY) * cos(cameraRotX),
-            cameraPanY + cameraDistance * sin(cameraRotX),
-            cameraPanZ + cameraDistance * cos(cameraRotY) * cos(cameraRotX)
-        );
-        glm::mat4 view = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
-        shader->setUniformMat4("uProjection", glm::value_ptr(proj));
-        shader->setUniformMat4("uView", glm::value_ptr(view));
-        int loc = glGetUniformLocation(shader->getProgram(), "uColor");
-        glUniform3f(loc, color.r, color.g, color.b);
-
-        glBindVertexArray(lineVAO);
-        glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
-        glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(float), positions.data(), GL_DYNAMIC_DRAW);
-        glDisableVertexAttribArray(1);
-        glDrawArrays(GL_LINES, 0, (GLsizei)(positions.size() / 3));
-        glEnableVertexAttribArray(1);
-        glBindVertexArray(0);
-
-        shader->unbind();
-    }
+    drawLines(positions, color);
 }
 
 void OpenGLRenderer3D::drawGridSolid(const glm::vec3& color) {
@@ -302,27 +749,5 @@ void OpenGLRenderer3D::drawGridSolid(const glm::vec3& color) {
         rx, y, rz,
         lx, y, rz
     };
-
-    shader->bind();
-    float aspect = (float)viewportWidth / (float)viewportHeight;
-    glm::mat4 proj = glm::perspective(glm::radians(45.0f), aspect, 0.1f, 100.0f);
-    glm::vec3 camPos(
-        cameraPanX + cameraDistance * sin(cameraRotY) * cos(cameraRotX),
-        cameraPanY + cameraDistance * sin(cameraRotX),
-        cameraPanZ + cameraDistance * cos(cameraRotY) * cos(cameraRotX)
-    );
-    glm::mat4 view = glm::lookAt(camPos, glm::vec3(cameraPanX, cameraPanY, cameraPanZ), glm::vec3(0.0f, 1.0f, 0.0f));
-
-    shader->setUniformMat4("uProjection", glm::value_ptr(proj));
-    shader->setUniformMat4("uView", glm::value_ptr(view));
-    int loc = glGetUniformLocation(shader->getProgram(), "uColor");
-    glUniform3f(loc, color.r, color.g, color.b);
-
-    glBindVertexArray(lineVAO);
-    glBindBuffer(GL_ARRAY_BUFFER, lineVBO);
-    glBufferData(GL_ARRAY_BUFFER, verts.size() * sizeof(float), verts.data(), GL_DYNAMIC_DRAW);
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-    glBindVertexArray(0);
-
-    shader->unbind();
+    pushVertices(DrawKind::Triangles, verts, nullptr, color);
 }
@@ -2,18 +2,80 @@
 #define PBD_X_OPENGLRENDERER_H
 
 #include "Shader.h"
+#include <cstdint>
+#include <unordered_map>
 #include <vector>
 #include <glm/glm.hpp>
 
+// Frames are recorded between beginFrame() and endFrame(). beginFrame() computes the
+// camera matrices once into a uniform block shared by every program; the draw calls
+// only append their vertices to a per-frame draw list, and endFrame() uploads the list
+// in one go and submits it, merging consecutive draws of the same kind into one call.
+//
+// Simulated geometry goes through a separate path sized for very large scenes: the
+// topology is uploaded once, grouped into bodies, and each frame only the particle
+// positions and body bounds are streamed. Bodies outside the view frustum are skipped
+// and the springs of distant bodies are decimated to what their screen size can show.
+
+// A body's springs, triangles and particles, as ranges of the arrays given to
+// setSceneTopology
+struct RenderBody {
+    int firstSpring;
+    int springCount;
+    int firstTriangle;
+    int triangleCount;
+    int firstParticle;
+    int particleCount;
+};
+
+// What the current frame draws through the scene path
+struct RenderStats {
+    int visibleBodies{0};
+    int culledBodies{0};
+    int springsDrawn{0};
+    int trianglesDrawn{0};
+    int particlesDrawn{0};
+};
+
 class OpenGLRenderer3D {
 public:
     OpenGLRenderer3D(int width, int height);
     ~OpenGLRenderer3D();
 
+    void beginFrame();
+    void endFrame();
+
     void drawLines(const std::vector<float>& positions, const glm::vec3& color);
     void drawLinesWithColors(const std::vector<float>& positions, const std::vector<glm::vec3>& colors);
     void drawPoints(const std::vector<float>& positions, const glm::vec3& color, float size = 5.0f);
 
+    // Scene topology, uploaded only when it changes. endpoints holds a pair of particle
+    // indices per spring, triangles a triple per triangle and particles the indices of
+    // each body's particles; all three are grouped by body. Within each body the springs
+    // are reordered so that any prefix is an evenly spread subset, which is what level
+    // of detail draws.
+    void setSceneTopology(const std::vector<int>& endpoints, const std::vector<float>& restLengths,
+                          const std::vector<int>& triangles, const std::vector<int>& particles,
+                          const std::vector<RenderBody>& bodies);
+    // Drop the spring between particles a and b from the uploaded topology, updating
+    // only the slot it leaves. Returns false when no such spring was uploaded, in which
+    // case the caller should upload the topology again.
+    bool removeSpring(int a, int b);
+    // Per frame, after beginFrame(): particle positions (x, y, z each) and the bounds of
+    // each body (min x, y, z then max x, y, z). Culling and detail levels are decided
+    // here, and with surfaceNormals the vertex normals are computed in a parallel pass.
+    void setParticles(const std::vector<float>& positions, const std::vector<float>& bodyBounds,
+                      bool surfaceNormals = false);
+    // Springs colored by strain in the vertex shader: green -> yellow -> red
+    void drawStrainLines();
+    // Lit triangle surfaces with per-vertex normals (setParticles with surfaceNormals);
+    // bodies without triangles are skipped
+    void drawSurface(const glm::vec3& color);
+    // The particles of the visible bodies as shaded spheres of the given world radius,
+    // drawn as instanced camera-facing quads that write sphere depth
+    void drawParticleSpheres(const glm::vec3& color, float radius);
+    [[nodiscard]] const RenderStats& getStats() const { return stats; }
+
     // Draw a ground-aligned XZ grid centered at the camera pan position
     void drawGrid(float spacing = 1.0f, const glm::vec3& color = glm::vec3(0.45f, 0.45f, 0.45f));
     // Draw a solid XZ plane under the scene with a single color
@@ -24,20 +86,80 @@ public:
     void rotateCameraY(float angle);
     void panCamera(float dx, float dy, float dz);
     void zoomCamera(float factor);
+    // World-space ray through a window point (x, y from the top left of a width by height
+    // window) under the camera of the last beginFrame(); direction has unit length
+    void getCursorRay(float x, float y, float width, float height, glm::vec3& origin, glm::vec3& direction) const;
     // Save the current framebuffer to a PPM image file. Returns true on success.
     bool saveFrameAsPPM(const std::string& path);
 
 private:
-    void ensureLineBuffers();
-    void ensurePointBuffers();
+    enum class DrawKind { Lines, Points, Triangles, StrainLines, Surface, Spheres };
+    struct DrawCommand {
+        DrawKind kind;
+        // Vertex range in the frame buffers (unused by the scene kinds)
+        int first;
+        int count;
+        // Point size, or sphere radius
+        float size;
+        glm::vec3 color;
+    };
+
+    void ensureFrameBuffers();
+    void ensureSceneBuffers();
+    void pushVertices(DrawKind kind, const std::vector<float>& positions, const glm::vec3* colors,
+                      const glm::vec3& color, float pointSize = 1.0f);
+    void computeNormals(const std::vector<float>& positions);
 
     int viewportWidth;
     int viewportHeight;
 
-    unsigned int lineVAO{0}, lineVBO{0}, lineColorVBO{0};
-    unsigned int pointVAO{0}, pointVBO{0};
+    // The frame's draw list and the vertex data it refers to; cleared, not freed, per frame
+    std::vector<DrawCommand> drawList;
+    std::vector<float> framePositions;
+    std::vector<glm::vec3> frameColors;
+    unsigned int frameVAO{0}, framePositionVBO{0}, frameColorVBO{0};
+    unsigned int cameraUBO{0};
+
+    // Camera of the current frame, for culling and level of detail
+    glm::mat4 frameViewProjection{1.0f};
+    glm::vec3 frameCameraPosition{0.0f};
+
+    // Scene path. Per line vertex: its particle and the other end, and the spring's rest
+    // length. Particle positions live in one buffer used both as a buffer texture and as
+    // the surface's vertex positions.
+    unsigned int strainVAO{0}, strainEndpointVBO{0}, strainRestVBO{0};
+    unsigned int particleBuffer{0}, particleTexture{0};
+    unsigned int surfaceVAO{0}, surfaceNormalVBO{0}, surfaceEBO{0};
+    unsigned int sphereVAO{0}, sphereCornerVBO{0};
+    // Particle indices grouped by body, read by the sphere shader as a buffer texture
+    unsigned int bodyParticleBuffer{0}, bodyParticleTexture{0};
+    int particleCount{0};
+    std::vector<RenderBody> bodies;
+    // CPU copies of the line vertex buffers, the slot of each spring by its particle
+    // pair and the body of each slot, so a torn spring is removed in place
+    std::vector<int> vertexEndpoints;
+    std::vector<float> vertexRest;
+    std::unordered_map<uint64_t, int> springSlots;
+    std::vector<int> springBodies;
+    std::vector<int> surfaceTriangles;
+    // Triangles around each particle, CSR, for the normal pass
+    std::vector<int> vertexTriangleStart;
+    std::vector<int> vertexTriangles;
+    std::vector<float> faceNormals;
+    std::vector<float> vertexNormals;
+    // Ranges chosen by setParticles for glMultiDraw*
+    std::vector<int> springFirsts;
+    std::vector<int> springCounts;
+    std::vector<int> triangleCounts;
+    std::vector<const void*> triangleOffsets;
+    std::vector<int> particleFirsts;
+    std::vector<int> particleCounts;
+    RenderStats stats;
 
     Shader* shader{nullptr};
+    Shader* strainShader{nullptr};
+    Shader* surfaceShader{nullptr};
+    Shader* sphereShader{nullptr};
     // 3D camera state
     float cameraDistance{10.0f};
     float cameraRotX{0.3f};
@@ -64,7 +64,35 @@ void Shader::unbind() const {
     glUseProgram(0);
 }
 
-void Shader::setUniformMat4(const std::string& name, const float* matrix) const {
+int Shader::getUniformLocation(const std::string& name) const {
+    auto it = uniformLocations.find(name);
+    if (it != uniformLocations.end()) return it->second;
     int loc = glGetUniformLocation(program, name.c_str());
+    uniformLocations.emplace(name, loc);
+    return loc;
+}
+
+void Shader::setUniformMat4(const std::string& name, const float* matrix) const {
+    int loc = getUniformLocation(name);
     if (loc >= 0) glUniformMatrix4fv(loc, 1, GL_FALSE, matrix);
 }
+
+void Shader::setUniform3f(const std::string& name, float x, float y, float z) const {
+    int loc = getUniformLocation(name);
+    if (loc >= 0) glUniform3f(loc, x, y, z);
+}
+
+void Shader::setUniform1i(const std::string& name, int value) const {
+    int loc = getUniformLocation(name);
+    if (loc >= 0) glUniform1i(loc, value);
+}
+
+void Shader::setUniform1f(const std::string& name, float value) const {
+    int loc = getUniformLocation(name);
+    if (loc >= 0) glUniform1f(loc, value);
+}
+
+void Shader::bindUniformBlock(const std::string& name, unsigned int binding) const {
+    unsigned int index = glGetUniformBlockIndex(program, name.c_str());
+    if (index != GL_INVALID_INDEX) glUniformBlockBinding(program, index, binding);
+}
@@ -2,6 +2,7 @@
 #define PBD_X_SHADER_H
 
 #include <string>
+#include <unordered_map>
 #include <GLFW/glfw3.h>
 
 class Shader {
@@ -13,10 +14,18 @@ public:
     void unbind() const;
 
     unsigned int getProgram() const { return program; }
+    // Looked up once per name and cached; -1 for uniforms the program does not use
+    int getUniformLocation(const std::string& name) const;
     void setUniformMat4(const std::string& name, const float* matrix) const;
+    void setUniform3f(const std::string& name, float x, float y, float z) const;
+    void setUniform1i(const std::string& name, int value) const;
+    void setUniform1f(const std::string& name, float value) const;
+    // Attach a named uniform block to a binding point shared across programs
+    void bindUniformBlock(const std::string& name, unsigned int binding) const;
 
 private:
     unsigned int program{0};
+    mutable std::unordered_map<std::string, int> uniformLocations;
     unsigned int compile(unsigned int type, const std::string& src);
 };
 
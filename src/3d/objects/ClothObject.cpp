@@ -1,13 +1,14 @@
 #include "ClothObject.h"
 
-ClothObject::ClothObject(float startX, float startY, float startZ, int width, int height, float spacing)
-    : width(width), height(height) {
+ClothObject::ClothObject(float startX, float startY, float startZ, int width, int height, float spacing,
+                         const Material& material)
+    : width(width), height(height), material(material) {
 
     grid.resize(height, std::vector<PointMass*>(width));
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
-            PointMass* pm = new PointMass(1.0f, startX + x * spacing, startY + y * spacing, startZ);
+            PointMass* pm = new PointMass(material.mass, startX + x * spacing, startY + y * spacing, startZ);
             grid[y][x] = pm;
             pointMasses.push_back(pm);
         }
@@ -28,10 +29,10 @@ ClothObject::~ClothObject() {
 }
 
 void ClothObject::createSprings() {
-    float structuralStiffness = 100.0f;
-    float shearStiffness = 30.0f;
-    float bendStiffness = 20.0f;
-    float damping = 1.0f;
+    const float structuralStiffness = material.stiffness;
+    const float shearStiffness = material.shearStiffness;
+    const float bendStiffness = material.bendStiffness;
+    const float damping = material.damping;
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
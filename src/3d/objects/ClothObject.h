@@ -4,10 +4,12 @@
 #include <vector>
 #include "../core/PointMass.h"
 #include "../core/Spring.h"
+#include "../simulation/Material.h"
 
 class ClothObject {
 public:
-    ClothObject(float startX, float startY, float startZ, int width, int height, float spacing);
+    ClothObject(float startX, float startY, float startZ, int width, int height, float spacing,
+                const Material& material = Material());
     ~ClothObject();
 
     [[nodiscard]] const std::vector<PointMass*>& getPointMasses() const { return pointMasses; }
@@ -21,6 +23,7 @@ private:
     std::vector<PointMass*> pointMasses;
     std::vector<Spring*> springs;
     int width, height;
+    Material material;
 
     void createSprings();
 };
@@ -1,10 +1,11 @@
 #include "RopeObject.h"
 
-RopeObject::RopeObject(float startX, float startY, float startZ, int numPoints, float spacing) {
+RopeObject::RopeObject(float startX, float startY, float startZ, int numPoints, float spacing,
+                       const Material& material) {
     PointMass* prev = nullptr;
 
     for (int i = 0; i < numPoints; i++) {
-        PointMass* pm = new PointMass(1.0f, startX, startY + i * spacing, startZ);
+        PointMass* pm = new PointMass(material.mass, startX, startY + i * spacing, startZ);
 
         if (i == 0) {
             pm->setFixed(true);
@@ -13,7 +14,7 @@ RopeObject::RopeObject(float startX, float startY, float startZ, int numPoints,
         pointMasses.push_back(pm);
 
         if (prev != nullptr) {
-            springs.push_back(new Spring(prev, pm, 200.0f, 2.0f));
+            springs.push_back(new Spring(prev, pm, material.stiffness, material.damping));
         }
 
         prev = pm;
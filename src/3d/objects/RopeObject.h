@@ -4,10 +4,12 @@
 #include <vector>
 #include "../core/PointMass.h"
 #include "../core/Spring.h"
+#include "../simulation/Material.h"
 
 class RopeObject {
 public:
-    RopeObject(float startX, float startY, float startZ, int numPoints, float spacing);
+    RopeObject(float startX, float startY, float startZ, int numPoints, float spacing,
+               const Material& material = Material::rope());
     ~RopeObject();
 
     [[nodiscard]] const std::vector<PointMass*>& getPointMasses() const { return pointMasses; }
@@ -0,0 +1,239 @@
+#include "BatchedSimulation.h"
+#include "Simulation.h"
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+#include <unordered_map>
+
+BatchedSimulation::BatchedSimulation(const Simulation& prototype, int variants)
+    : variants(variants), batches((variants + LANES - 1) / LANES) {
+    if (variants < 1) {
+        throw std::runtime_error("BatchedSimulation needs at least one variant");
+    }
+    if (!prototype.getTriangles().empty() || !prototype.getColliders().empty() ||
+        !prototype.getKinematicTargets().empty()) {
+        throw std::runtime_error("BatchedSimulation only batches spring scenes without triangles, colliders or kinematic targets");
+    }
+
+    const auto& pointMasses = prototype.getPointMasses();
+    const auto& springs = prototype.getSprings();
+    nodeCount = (int)pointMasses.size();
+    springCount = (int)springs.size();
+
+    std::unordered_map<const PointMass*, int> indexOf;
+    for (int i = 0; i < nodeCount; ++i) {
+        indexOf[pointMasses[i]] = i;
+        fixed.push_back(pointMasses[i]->isFixed() ? 1 : 0);
+        baseMass.push_back(pointMasses[i]->getMass());
+    }
+    for (const Spring* spring : springs) {
+        springA.push_back(indexOf.at(spring->getPointMass1()));
+        springB.push_back(indexOf.at(spring->getPointMass2()));
+        restLengths.push_back(spring->getRestLength());
+        baseStiffness.push_back(spring->getStiffness());
+        baseDamping.push_back(spring->getDamping());
+    }
+
+    // Every lane, padding lanes included, starts as a copy of the prototype
+    nodes.resize((size_t)batches * nodeCount);
+    springParams.resize((size_t)batches * springCount);
+    restitution.resize(batches);
+    loadX.assign(batches, LaneBlock{});
+    loadY.assign(batches, LaneBlock{});
+    loadZ.assign(batches, LaneBlock{});
+    for (int b = 0; b < batches; ++b) {
+        for (int i = 0; i < nodeCount; ++i) {
+            NodeBlock& n = nodes[(size_t)b * nodeCount + i];
+            Vector3D p = pointMasses[i]->getPosition();
+            Vector3D v = pointMasses[i]->getVelocity();
+            Vector3D a = pointMasses[i]->getAcceleration();
+            for (int l = 0; l < LANES; ++l) {
+                n.x[l] = p.x; n.y[l] = p.y; n.z[l] = p.z;
+                n.vx[l] = v.x; n.vy[l] = v.y; n.vz[l] = v.z;
+                n.ax[l] = a.x; n.ay[l] = a.y; n.az[l] = a.z;
+                n.mass[l] = baseMass[i];
+            }
+        }
+        for (int s = 0; s < springCount; ++s) {
+            SpringBlock& sp = springParams[(size_t)b * springCount + s];
+            std::fill(std::begin(sp.stiffness), std::end(sp.stiffness), baseStiffness[s]);
+            std::fill(std::begin(sp.damping), std::end(sp.damping), baseDamping[s]);
+        }
+        std::fill(std::begin(restitution[b].value), std::end(restitution[b].value), 0.6f);
+    }
+}
+
+void BatchedSimulation::setStiffnessScale(int variant, float scale) {
+    for (int s = 0; s < springCount; ++s) {
+        springParams[(size_t)(variant / LANES) * springCount + s].stiffness[variant % LANES] = baseStiffness[s] * scale;
+    }
+}
+
+void BatchedSimulation::setDampingScale(int variant, float scale) {
+    for (int s = 0; s < springCount; ++s) {
+        springParams[(size_t)(variant / LANES) * springCount + s].damping[variant % LANES] = baseDamping[s] * scale;
+    }
+}
+
+void BatchedSimulation::setMassScale(int variant, float scale) {
+    for (int i = 0; i < nodeCount; ++i) {
+        node(variant, i).mass[variant % LANES] = baseMass[i] * scale;
+    }
+}
+
+void BatchedSimulation::setRestitution(int variant, float r) {
+    restitution[variant / LANES].value[variant % LANES] = r;
+}
+
+void BatchedSimulation::setPosition(int variant, int index, const Vector3D& position) {
+    NodeBlock& n = node(variant, index);
+    const int l = variant % LANES;
+    n.x[l] = position.x; n.y[l] = position.y; n.z[l] = position.z;
+}
+
+void BatchedSimulation::setVelocity(int variant, int index, const Vector3D& velocity) {
+    NodeBlock& n = node(variant, index);
+    const int l = variant % LANES;
+    n.vx[l] = velocity.x; n.vy[l] = velocity.y; n.vz[l] = velocity.z;
+}
+
+Vector3D BatchedSimulation::getPosition(int variant, int index) const {
+    const NodeBlock& n = node(variant, index);
+    const int l = variant % LANES;
+    return {n.x[l], n.y[l], n.z[l]};
+}
+
+Vector3D BatchedSimulation::getVelocity(int variant, int index) const {
+    const NodeBlock& n = node(variant, index);
+    const int l = variant % LANES;
+    return {n.vx[l], n.vy[l], n.vz[l]};
+}
+
+void BatchedSimulation::applyGlobalForce(const Vector3D& force) {
+    for (int b = 0; b < batches; ++b) {
+        for (int l = 0; l < LANES; ++l) {
+            loadX[b].value[l] += force.x;
+            loadY[b].value[l] += force.y;
+            loadZ[b].value[l] += force.z;
+        }
+    }
+}
+
+void BatchedSimulation::applyForce(int variant, const Vector3D& force) {
+    loadX[variant / LANES].value[variant % LANES] += force.x;
+    loadY[variant / LANES].value[variant % LANES] += force.y;
+    loadZ[variant / LANES].value[variant % LANES] += force.z;
+}
+
+void BatchedSimulation::update(float dt) {
+    int steps = std::max(1, (int)std::ceil(dt / fixedSubDt));
+    float subDt = dt / steps;
+
+    // Batches are independent; each runs all its substeps while its blocks are in cache
+    for (int b = 0; b < batches; ++b) {
+        for (int s = 0; s < steps; ++s) {
+            substep(b, subDt);
+        }
+        std::fill(std::begin(loadX[b].value), std::end(loadX[b].value), 0.0f);
+        std::fill(std::begin(loadY[b].value), std::end(loadY[b].value), 0.0f);
+        std::fill(std::begin(loadZ[b].value), std::end(loadZ[b].value), 0.0f);
+    }
+}
+
+void BatchedSimulation::substep(int batch, float dt) {
+    NodeBlock* n = &nodes[(size_t)batch * nodeCount];
+    const SpringBlock* params = &springParams[(size_t)batch * springCount];
+
+    // The frame's load, as in ForceFields::apply
+    const float* lx = loadX[batch].value;
+    const float* ly = loadY[batch].value;
+    const float* lz = loadZ[batch].value;
+    for (int i = 0; i < nodeCount; ++i) {
+        if (fixed[i]) continue;
+        NodeBlock& m = n[i];
+        for (int l = 0; l < LANES; ++l) {
+            m.ax[l] += lx[l] / m.mass[l];
+            m.ay[l] += ly[l] / m.mass[l];
+            m.az[l] += lz[l] / m.mass[l];
+        }
+    }
+
+    // Spring forces in the same order and with the same operations as Spring::applyForces
+    for (int s = 0; s < springCount; ++s) {
+        NodeBlock& a = n[springA[s]];
+        NodeBlock& b = n[springB[s]];
+        const SpringBlock& p = params[s];
+        const float rest = restLengths[s];
+
+        float fx[LANES], fy[LANES], fz[LANES];
+        for (int l = 0; l < LANES; ++l) {
+            float dx = b.x[l] - a.x[l], dy = b.y[l] - a.y[l], dz = b.z[l] - a.z[l];
+            float length = std::sqrt(dx * dx + dy * dy + dz * dz);
+            // Coincident endpoints exert no force: the direction is zeroed. Selecting
+            // values rather than computing under a condition keeps the loop vectorizable.
+            float safe = length > 0.0f ? length : 1.0f;
+            float on = length > 0.0f ? 1.0f : 0.0f;
+            float nx = dx / safe * on, ny = dy / safe * on, nz = dz / safe * on;
+            float spring = p.stiffness[l] * (length - rest);
+            float rvx = b.vx[l] - a.vx[l], rvy = b.vy[l] - a.vy[l], rvz = b.vz[l] - a.vz[l];
+            float damping = p.damping[l] * (rvx * nx + rvy * ny + rvz * nz);
+            fx[l] = nx * spring + nx * damping;
+            fy[l] = ny * spring + ny * damping;
+            fz[l] = nz * spring + nz * damping;
+        }
+        for (int l = 0; l < LANES; ++l) {
+            a.ax[l] += fx[l] / a.mass[l];
+            a.ay[l] += fy[l] / a.mass[l];
+            a.az[l] += fz[l] / a.mass[l];
+        }
+        for (int l = 0; l < LANES; ++l) {
+            b.ax[l] += (fx[l] * -1.0f) / b.mass[l];
+            b.ay[l] += (fy[l] * -1.0f) / b.mass[l];
+            b.az[l] += (fz[l] * -1.0f) / b.mass[l];
+        }
+    }
+
+    // Integration, floor response and safety clamps as in Simulation::stepIsland
+    const float maxSpeed = 30.0f;
+    const float maxDisp = maxSpeed * dt * 1.5f;
+    const float* bounce = restitution[batch].value;
+    // Lane loops below compute both outcomes and select, so they contain no branches
+    const float floorLevel = floorEnabled ? floorY : -INFINITY;
+    for (int i = 0; i < nodeCount; ++i) {
+        NodeBlock& m = n[i];
+        if (fixed[i]) {
+            std::fill(std::begin(m.ax), std::end(m.ax), 0.0f);
+            std::fill(std::begin(m.ay), std::end(m.ay), 0.0f);
+            std::fill(std::begin(m.az), std::end(m.az), 0.0f);
+            continue;
+        }
+        for (int l = 0; l < LANES; ++l) {
+            float vx = m.vx[l] + m.ax[l] * dt;
+            float vy = m.vy[l] + m.ay[l] * dt;
+            float vz = m.vz[l] + m.az[l] * dt;
+            float x = m.x[l] + vx * dt;
+            float y = m.y[l] + vy * dt;
+            float z = m.z[l] + vz * dt;
+
+            bool hit = y < floorLevel;
+            y = hit ? floorLevel + 1e-4f : y;
+            float hvx = vx * 0.9f, hvy = -vy * bounce[l], hvz = vz * 0.9f;
+            float hitSpeed = std::sqrt(hvx * hvx + hvy * hvy + hvz * hvz);
+            float hitLimit = maxSpeed / hitSpeed;
+            float hitScale = hitSpeed > maxSpeed ? hitLimit : 1.0f;
+            vx = hit ? hvx * hitScale : vx;
+            vy = hit ? hvy * hitScale : vy;
+            vz = hit ? hvz * hitScale : vz;
+
+            float speed = std::sqrt(vx * vx + vy * vy + vz * vz);
+            bool clamp = (speed * dt > maxDisp) & (speed > 1e-6f);
+            float limit = maxDisp / (speed * dt);
+            float scale = clamp ? limit : 1.0f;
+            m.vx[l] = vx * scale;
+            m.vy[l] = vy * scale;
+            m.vz[l] = vz * scale;
+            m.x[l] = x; m.y[l] = y; m.z[l] = z;
+            m.ax[l] = 0.0f; m.ay[l] = 0.0f; m.az[l] = 0.0f;
+        }
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef PBD_X_BATCHEDSIMULATION_H
+#define PBD_X_BATCHEDSIMULATION_H
+
+#include <vector>
+#include "../core/Vector3D.h"
+
+class Simulation;
+
+// Many variants of one small spring scene stepped together, one variant per SIMD
+// lane. Topology (springs, rest lengths, pins) is taken once from a prototype
+// Simulation built with createCloth/createRope and shared; positions, velocities,
+// masses, spring constants and restitution are per variant. State is stored as
+// arrays of structures of LANES-wide arrays (AoSoA): every node and spring owns one
+// block per batch of LANES variants, and the kernels loop over the lanes of a block
+// with no cross-lane dependencies, so the compiler maps each loop onto vector
+// registers.
+//
+// Each lane computes exactly what Simulation's fixed substep path computes for that
+// variant with sleeping off. Force fields, triangle constraints, colliders, tearing
+// and the other optional solvers are not batched.
+class BatchedSimulation {
+public:
+    static constexpr int LANES = 8;
+
+    BatchedSimulation(const Simulation& prototype, int variants);
+
+    void update(float dt);
+    // Same semantics as Simulation::applyGlobalForce: a load on every free node for
+    // each substep of the next update
+    void applyGlobalForce(const Vector3D& force);
+    void applyForce(int variant, const Vector3D& force);
+
+    void setFloorEnabled(bool enabled) { floorEnabled = enabled; }
+    void setFloorY(float y) { floorY = y; }
+    void setFixedSubstep(float dt) { fixedSubDt = dt; }
+
+    // Per variant parameters, relative to the prototype's materials
+    void setStiffnessScale(int variant, float scale);
+    void setDampingScale(int variant, float scale);
+    void setMassScale(int variant, float scale);
+    void setRestitution(int variant, float r);
+    // Per variant initial conditions
+    void setPosition(int variant, int node, const Vector3D& position);
+    void setVelocity(int variant, int node, const Vector3D& velocity);
+
+    [[nodiscard]] Vector3D getPosition(int variant, int node) const;
+    [[nodiscard]] Vector3D getVelocity(int variant, int node) const;
+    [[nodiscard]] int getVariantCount() const { return variants; }
+    [[nodiscard]] int getNodeCount() const { return nodeCount; }
+
+private:
+    struct alignas(32) NodeBlock {
+        float x[LANES], y[LANES], z[LANES];
+        float vx[LANES], vy[LANES], vz[LANES];
+        float ax[LANES], ay[LANES], az[LANES];
+        float mass[LANES];
+    };
+    struct alignas(32) SpringBlock {
+        float stiffness[LANES];
+        float damping[LANES];
+    };
+    struct alignas(32) LaneBlock {
+        float value[LANES];
+    };
+
+    void substep(int batch, float dt);
+    [[nodiscard]] NodeBlock& node(int variant, int index) { return nodes[(size_t)(variant / LANES) * nodeCount + index]; }
+    [[nodiscard]] const NodeBlock& node(int variant, int index) const { return nodes[(size_t)(variant / LANES) * nodeCount + index]; }
+
+    int variants;
+    int batches;
+    int nodeCount;
+    int springCount;
+
+    // Shared topology
+    std::vector<int> springA, springB;
+    std::vector<float> restLengths;
+    std::vector<char> fixed;
+    std::vector<float> baseMass, baseStiffness, baseDamping;
+
+    // Per batch state, node or spring major within a batch
+    std::vector<NodeBlock> nodes;
+    std::vector<SpringBlock> springParams;
+    std::vector<LaneBlock> restitution;
+    std::vector<LaneBlock> loadX, loadY, loadZ;
+
+    bool floorEnabled{true};
+    float floorY{-1.0f};
+    float fixedSubDt{0.005f};
+};
+
+#endif //PBD_X_BATCHEDSIMULATION_H
@@ -0,0 +1,32 @@
+#ifndef PBD_X_COLLIDER_H
+#define PBD_X_COLLIDER_H
+
+#include "../core/Vector3D.h"
+
+// Static collision shape; point masses are pushed out and bounce like on the floor
+struct Collider {
+    enum class Shape { Plane, Sphere };
+
+    Shape shape{Shape::Plane};
+    Vector3D point;                   // plane point or sphere center
+    Vector3D normal{0.0f, 1.0f, 0.0f};
+    float radius{0.0f};
+
+    static Collider plane(const Vector3D& point, const Vector3D& normal) {
+        Collider c;
+        c.shape = Shape::Plane;
+        c.point = point;
+        c.normal = normal.normalized();
+        return c;
+    }
+
+    static Collider sphere(const Vector3D& center, float radius) {
+        Collider c;
+        c.shape = Shape::Sphere;
+        c.point = center;
+        c.radius = radius;
+        return c;
+    }
+};
+
+#endif //PBD_X_COLLIDER_H
@@ -0,0 +1,391 @@
+#include "CollisionDetector.h"
+#include "../utils/Parallel.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Points or edges per broadphase block; blocks are spread over threads and their
+// output joined in block order, so the candidate lists match a serial run
+constexpr int QUERIES_PER_BLOCK = 1024;
+
+double elapsedMs(Clock::time_point since) {
+    return std::chrono::duration<double, std::milli>(Clock::now() - since).count();
+}
+
+float inverseMass(const PointMass* pm) {
+    return pm->isFixed() ? 0.0f : 1.0f / pm->getMass();
+}
+
+// Coefficients of f(t) = ((A + tB) x (C + tD)) . (E + tF), the coplanarity polynomial
+// of four linearly moving points
+void coplanarityCubic(const Vector3D& A, const Vector3D& B, const Vector3D& C, const Vector3D& D,
+                      const Vector3D& E, const Vector3D& F, float c[4]) {
+    Vector3D ac = A.cross(C);
+    Vector3D mid = A.cross(D) + B.cross(C);
+    Vector3D bd = B.cross(D);
+    c[0] = ac.dot(E);
+    c[1] = ac.dot(F) + mid.dot(E);
+    c[2] = mid.dot(F) + bd.dot(E);
+    c[3] = bd.dot(F);
+}
+
+float evalCubic(const float c[4], float t) {
+    return ((c[3] * t + c[2]) * t + c[1]) * t + c[0];
+}
+
+// Roots of the cubic in [0, 1], ascending. The interval is cut at the critical points
+// so every piece is monotone, then each sign change is bisected.
+int cubicRoots(const float c[4], float roots[3]) {
+    float cuts[4] = {0.0f, 1.0f, 1.0f, 1.0f};
+    int cutCount = 1;
+    float a = 3.0f * c[3], b = 2.0f * c[2], d = c[1];
+    if (std::fabs(a) > 1e-12f) {
+        float disc = b * b - 4.0f * a * d;
+        if (disc >= 0.0f) {
+            float sq = std::sqrt(disc);
+            float t1 = (-b - sq) / (2.0f * a), t2 = (-b + sq) / (2.0f * a);
+            if (t1 > t2) std::swap(t1, t2);
+            if (t1 > 0.0f && t1 < 1.0f) cuts[cutCount++] = t1;
+            if (t2 > 0.0f && t2 < 1.0f) cuts[cutCount++] = t2;
+        }
+    } else if (std::fabs(b) > 1e-12f) {
+        float t1 = -d / b;
+        if (t1 > 0.0f && t1 < 1.0f) cuts[cutCount++] = t1;
+    }
+    cuts[cutCount++] = 1.0f;
+
+    int found = 0;
+    for (int i = 0; i + 1 < cutCount; ++i) {
+        float lo = cuts[i], hi = cuts[i + 1];
+        float flo = evalCubic(c, lo), fhi = evalCubic(c, hi);
+        if (flo == 0.0f) {
+            roots[found++] = lo;
+            continue;
+        }
+        if ((flo > 0.0f) == (fhi > 0.0f)) continue;
+        for (int iter = 0; iter < 20; ++iter) {
+            float mid = 0.5f * (lo + hi);
+            float fmid = evalCubic(c, mid);
+            if ((fmid > 0.0f) == (flo > 0.0f)) {
+                lo = mid;
+                flo = fmid;
+            } else {
+                hi = mid;
+            }
+        }
+        roots[found++] = 0.5f * (lo + hi);
+    }
+    return found;
+}
+
+Vector3D lerp(const Vector3D& a, const Vector3D& b, float t) {
+    return a + (b - a) * t;
+}
+
+// Barycentric coordinates of p projected onto triangle (a, b, c)
+bool barycentric(const Vector3D& p, const Vector3D& a, const Vector3D& b, const Vector3D& c, float out[3]) {
+    Vector3D v0 = b - a, v1 = c - a, v2 = p - a;
+    float d00 = v0.dot(v0), d01 = v0.dot(v1), d11 = v1.dot(v1);
+    float d20 = v2.dot(v0), d21 = v2.dot(v1);
+    float denom = d00 * d11 - d01 * d01;
+    if (denom < 1e-14f) return false;
+    float v = (d11 * d20 - d01 * d21) / denom;
+    float w = (d00 * d21 - d01 * d20) / denom;
+    out[0] = 1.0f - v - w;
+    out[1] = v;
+    out[2] = w;
+    return true;
+}
+
+// Closest points between segments p1-p2 and q1-q2 as parameters s and u
+void segmentParameters(const Vector3D& p1, const Vector3D& p2, const Vector3D& q1, const Vector3D& q2,
+                       float& s, float& u) {
+    Vector3D d1 = p2 - p1, d2 = q2 - q1, r = p1 - q1;
+    float a = d1.dot(d1), e = d2.dot(d2), f = d2.dot(r);
+    float c = d1.dot(r), b = d1.dot(d2);
+    float denom = a * e - b * b;
+    s = (denom > 1e-14f) ? std::max(0.0f, std::min(1.0f, (b * f - c * e) / denom)) : 0.0f;
+    u = (e > 1e-14f) ? (b * s + f) / e : 0.0f;
+    if (u < 0.0f) {
+        u = 0.0f;
+        s = (a > 1e-14f) ? std::max(0.0f, std::min(1.0f, -c / a)) : 0.0f;
+    } else if (u > 1.0f) {
+        u = 1.0f;
+        s = (a > 1e-14f) ? std::max(0.0f, std::min(1.0f, (b - c) / a)) : 0.0f;
+    }
+}
+
+Vector3D sweptMin(const Vector3D& a, const Vector3D& b, float pad) {
+    return {std::min(a.x, b.x) - pad, std::min(a.y, b.y) - pad, std::min(a.z, b.z) - pad};
+}
+
+Vector3D sweptMax(const Vector3D& a, const Vector3D& b, float pad) {
+    return {std::max(a.x, b.x) + pad, std::max(a.y, b.y) + pad, std::max(a.z, b.z) + pad};
+}
+
+} // namespace
+
+void CollisionDetector::beginStep(const std::vector<PointMass*>& pointMasses) {
+    start.resize(pointMasses.size());
+    for (size_t i = 0; i < pointMasses.size(); ++i) {
+        start[i] = pointMasses[i]->getPosition();
+    }
+}
+
+void CollisionDetector::buildEdges(const std::vector<int>& triangles, int vertexCount) {
+    std::vector<uint64_t> keys;
+    keys.reserve(triangles.size());
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = (uint32_t)triangles[t + k], b = (uint32_t)triangles[t + (k + 1) % 3];
+            if (a > b) std::swap(a, b);
+            keys.push_back(((uint64_t)a << 32) | b);
+        }
+    }
+    std::sort(keys.begin(), keys.end());
+    keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+    edges.clear();
+    edges.reserve(keys.size() * 2);
+    for (uint64_t key : keys) {
+        edges.push_back((int)(key >> 32));
+        edges.push_back((int)(key & 0xffffffffu));
+    }
+
+    triangleEdges.resize(triangles.size());
+    for (size_t t = 0; t + 2 < triangles.size(); t += 3) {
+        for (int k = 0; k < 3; ++k) {
+            uint32_t a = (uint32_t)triangles[t + k], b = (uint32_t)triangles[t + (k + 1) % 3];
+            if (a > b) std::swap(a, b);
+            uint64_t key = ((uint64_t)a << 32) | b;
+            triangleEdges[t + k] = (int)(std::lower_bound(keys.begin(), keys.end(), key) - keys.begin());
+        }
+    }
+
+    // Keys are sorted by their first vertex, then the second, so each vertex's list
+    // comes out sorted once both directions are counted
+    neighborStart.assign(vertexCount + 1, 0);
+    for (size_t e = 0; e < edges.size(); ++e) neighborStart[edges[e] + 1]++;
+    for (int v = 0; v < vertexCount; ++v) neighborStart[v + 1] += neighborStart[v];
+    neighbors.resize(edges.size());
+    std::vector<int> fill(neighborStart.begin(), neighborStart.end() - 1);
+    for (size_t e = 0; e + 1 < edges.size(); e += 2) {
+        neighbors[fill[edges[e]]++] = edges[e + 1];
+        neighbors[fill[edges[e + 1]]++] = edges[e];
+    }
+    for (int v = 0; v < vertexCount; ++v) {
+        std::sort(neighbors.begin() + neighborStart[v], neighbors.begin() + neighborStart[v + 1]);
+    }
+}
+
+bool CollisionDetector::adjacent(int a, int b) const {
+    return std::binary_search(neighbors.begin() + neighborStart[a], neighbors.begin() + neighborStart[a + 1], b);
+}
+
+bool CollisionDetector::inOneRing(int a, int b, int c, int d) const {
+    return a == c || a == d || b == c || b == d || adjacent(a, c) || adjacent(a, d) || adjacent(b, c) ||
+           adjacent(b, d);
+}
+
+void CollisionDetector::push(int vertex, PointMass* pm, const Vector3D& delta, float invDt) {
+    end[vertex] += delta;
+    pm->setPosition(end[vertex]);
+    pm->setVelocity(pm->getVelocity() + delta * invDt);
+    touched.push_back(pm);
+}
+
+void CollisionDetector::resolve(const std::vector<PointMass*>& pointMasses, const std::vector<int>& triangles, float dt,
+                                const std::vector<uint8_t>& activeIslands) {
+    touched.clear();
+    const int n = (int)pointMasses.size();
+    if (triangles.empty() || (int)start.size() != n) return;
+
+    active.resize(n);
+    bool anyActive = false;
+    for (int i = 0; i < n; ++i) {
+        int id = pointMasses[i]->getIslandId();
+        active[i] = id < 0 || id >= (int)activeIslands.size() || activeIslands[id];
+        anyActive |= active[i] != 0;
+    }
+    // Nothing moves, so nothing new can touch
+    if (!anyActive) return;
+
+    end.resize(n);
+    for (int i = 0; i < n; ++i) {
+        end[i] = pointMasses[i]->getPosition();
+    }
+
+    // Refit every step; rebuild when the topology changed or refitting has let the
+    // boxes grow too loose
+    auto t0 = Clock::now();
+    if (bvh.empty() || bvh.triangleCount() != triangles.size() / 3 || bvh.needsRebuild() ||
+        (int)neighborStart.size() != n + 1) {
+        bvh.build(triangles, start, end, thickness);
+        buildEdges(triangles, n);
+        stats.rebuilds++;
+    } else {
+        bvh.refit(triangles, start, end, thickness);
+    }
+    stats.refitMs += elapsedMs(t0);
+
+    // Broadphase: swept point and edge boxes against the tree, for the points and edges
+    // that may move. Resting ones are still found as the triangle or second edge.
+    t0 = Clock::now();
+    auto gather = [this](int count, std::vector<std::pair<int, int>>& out, auto&& queryOne) {
+        const int blocks = (count + QUERIES_PER_BLOCK - 1) / QUERIES_PER_BLOCK;
+        if ((int)blockPairs.size() < blocks) blockPairs.resize(blocks);
+        Parallel::forRange(blocks, 1, [&](int first, int last) {
+            for (int b = first; b < last; ++b) {
+                std::vector<std::pair<int, int>>& pairs = blockPairs[b];
+                pairs.clear();
+                const int stop = std::min(count, (b + 1) * QUERIES_PER_BLOCK);
+                for (int i = b * QUERIES_PER_BLOCK; i < stop; ++i) queryOne(i, pairs);
+            }
+        });
+        out.clear();
+        for (int b = 0; b < blocks; ++b) out.insert(out.end(), blockPairs[b].begin(), blockPairs[b].end());
+    };
+
+    gather(n, candidates, [&](int v, std::vector<std::pair<int, int>>& pairs) {
+        if (!active[v]) return;
+        bvh.query(sweptMin(start[v], end[v], thickness), sweptMax(start[v], end[v], thickness), [&](int t) {
+            const int* tri = &triangles[t * 3];
+            if (tri[0] != v && tri[1] != v && tri[2] != v) pairs.emplace_back(v, t);
+        });
+    });
+
+    // Edge pairs are found through the triangles around the second edge, and kept once
+    // per pair: from the lower edge, or from the moving one when the other rests
+    const int edgeCount = (int)(edges.size() / 2);
+    edgeLo.resize(edgeCount);
+    edgeHi.resize(edgeCount);
+    for (int e = 0; e < edgeCount; ++e) {
+        int a = edges[e * 2], b = edges[e * 2 + 1];
+        edgeLo[e] = sweptMin(sweptMin(start[a], end[a], thickness), sweptMin(start[b], end[b], thickness), 0.0f);
+        edgeHi[e] = sweptMax(sweptMax(start[a], end[a], thickness), sweptMax(start[b], end[b], thickness), 0.0f);
+    }
+    gather(edgeCount, edgePairs, [&](int e, std::vector<std::pair<int, int>>& pairs) {
+        int a = edges[e * 2], b = edges[e * 2 + 1];
+        if (!active[a] && !active[b]) return;
+        const size_t first = pairs.size();
+        bvh.query(edgeLo[e], edgeHi[e], [&](int t) {
+            for (int k = 0; k < 3; ++k) {
+                int f = triangleEdges[t * 3 + k];
+                if (f == e) continue;
+                int c = edges[f * 2], d = edges[f * 2 + 1];
+                if (f < e && (active[c] || active[d])) continue;
+                const Vector3D &lo = edgeLo[f], &hi = edgeHi[f];
+                if (lo.x > edgeHi[e].x || hi.x < edgeLo[e].x || lo.y > edgeHi[e].y || hi.y < edgeLo[e].y ||
+                    lo.z > edgeHi[e].z || hi.z < edgeLo[e].z) {
+                    continue;
+                }
+                if (inOneRing(a, b, c, d)) continue;
+                pairs.emplace_back(e, f);
+            }
+        });
+        // Each edge borders up to two triangles, so a pair can come up twice
+        std::sort(pairs.begin() + first, pairs.end());
+        pairs.erase(std::unique(pairs.begin() + first, pairs.end()), pairs.end());
+    });
+    stats.traversalMs += elapsedMs(t0);
+
+    // Narrowphase
+    t0 = Clock::now();
+    const float invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+    for (const auto& candidate : candidates) {
+        int v = candidate.first;
+        const int* tri = &triangles[candidate.second * 3];
+        int a = tri[0], b = tri[1], c = tri[2];
+
+        float coeffs[4];
+        coplanarityCubic(start[b] - start[a], (end[b] - end[a]) - (start[b] - start[a]),
+                         start[c] - start[a], (end[c] - end[a]) - (start[c] - start[a]),
+                         start[v] - start[a], (end[v] - end[a]) - (start[v] - start[a]), coeffs);
+        float roots[4];
+        int rootCount = cubicRoots(coeffs, roots);
+        // Also test the end configuration so resting contacts keep their thickness
+        roots[rootCount++] = 1.0f;
+
+        for (int r = 0; r < rootCount; ++r) {
+            float t = roots[r];
+            Vector3D pa = lerp(start[a], end[a], t), pb = lerp(start[b], end[b], t), pc = lerp(start[c], end[c], t);
+            Vector3D pp = lerp(start[v], end[v], t);
+            float bary[3];
+            if (!barycentric(pp, pa, pb, pc, bary)) continue;
+            if (bary[0] < -1e-3f || bary[1] < -1e-3f || bary[2] < -1e-3f) continue;
+            Vector3D onTriangle = pa * bary[0] + pb * bary[1] + pc * bary[2];
+            if ((pp - onTriangle).magnitude() > thickness) continue;
+
+            // Keep the point on the side of the triangle it started on
+            Vector3D normal = (start[b] - start[a]).cross(start[c] - start[a]).normalized();
+            float side = (start[v] - start[a]).dot(normal);
+            if (side < 0.0f) normal = normal * -1.0f;
+            Vector3D endOnTriangle = end[a] * bary[0] + end[b] * bary[1] + end[c] * bary[2];
+            float depth = thickness - (end[v] - endOnTriangle).dot(normal);
+            if (depth <= 0.0f) break;
+
+            float wp = inverseMass(pointMasses[v]);
+            float wa = inverseMass(pointMasses[a]), wb = inverseMass(pointMasses[b]), wc = inverseMass(pointMasses[c]);
+            float denom = wp + bary[0] * bary[0] * wa + bary[1] * bary[1] * wb + bary[2] * bary[2] * wc;
+            if (denom <= 0.0f) break;
+            float lambda = depth / denom;
+
+            if (wp > 0.0f) push(v, pointMasses[v], normal * (lambda * wp), invDt);
+            if (wa > 0.0f) push(a, pointMasses[a], normal * (-lambda * bary[0] * wa), invDt);
+            if (wb > 0.0f) push(b, pointMasses[b], normal * (-lambda * bary[1] * wb), invDt);
+            if (wc > 0.0f) push(c, pointMasses[c], normal * (-lambda * bary[2] * wc), invDt);
+            stats.pointTriangleContacts++;
+            break;
+        }
+    }
+
+    for (const auto& pair : edgePairs) {
+        int p1 = edges[pair.first * 2], p2 = edges[pair.first * 2 + 1];
+        int q1 = edges[pair.second * 2], q2 = edges[pair.second * 2 + 1];
+        float coeffs[4];
+        coplanarityCubic(start[p2] - start[p1], (end[p2] - end[p1]) - (start[p2] - start[p1]),
+                         start[q2] - start[q1], (end[q2] - end[q1]) - (start[q2] - start[q1]),
+                         start[q1] - start[p1], (end[q1] - end[p1]) - (start[q1] - start[p1]), coeffs);
+        float roots[4];
+        int rootCount = cubicRoots(coeffs, roots);
+        roots[rootCount++] = 1.0f;
+
+        for (int r = 0; r < rootCount; ++r) {
+            float t = roots[r];
+            Vector3D a1 = lerp(start[p1], end[p1], t), a2 = lerp(start[p2], end[p2], t);
+            Vector3D b1 = lerp(start[q1], end[q1], t), b2 = lerp(start[q2], end[q2], t);
+            float s, u;
+            segmentParameters(a1, a2, b1, b2, s, u);
+            // Endpoint contacts belong to the point-triangle test
+            if (s <= 0.0f || s >= 1.0f || u <= 0.0f || u >= 1.0f) continue;
+            if ((lerp(b1, b2, u) - lerp(a1, a2, s)).magnitude() > thickness) continue;
+
+            Vector3D normal = lerp(start[q1], start[q2], u) - lerp(start[p1], start[p2], s);
+            if (normal.magnitude() < 1e-9f) {
+                normal = (start[p2] - start[p1]).cross(start[q2] - start[q1]);
+            }
+            normal = normal.normalized();
+            float depth = thickness - (lerp(end[q1], end[q2], u) - lerp(end[p1], end[p2], s)).dot(normal);
+            if (depth <= 0.0f) break;
+
+            float w1 = inverseMass(pointMasses[p1]), w2 = inverseMass(pointMasses[p2]);
+            float w3 = inverseMass(pointMasses[q1]), w4 = inverseMass(pointMasses[q2]);
+            float denom = (1 - s) * (1 - s) * w1 + s * s * w2 + (1 - u) * (1 - u) * w3 + u * u * w4;
+            if (denom <= 0.0f) break;
+            float lambda = depth / denom;
+
+            if (w1 > 0.0f) push(p1, pointMasses[p1], normal * (-lambda * (1 - s) * w1), invDt);
+            if (w2 > 0.0f) push(p2, pointMasses[p2], normal * (-lambda * s * w2), invDt);
+            if (w3 > 0.0f) push(q1, pointMasses[q1], normal * (lambda * (1 - u) * w3), invDt);
+            if (w4 > 0.0f) push(q2, pointMasses[q2], normal * (lambda * u * w4), invDt);
+            stats.edgeEdgeContacts++;
+            break;
+        }
+    }
+    stats.narrowphaseMs += elapsedMs(t0);
+}
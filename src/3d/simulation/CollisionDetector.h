@@ -0,0 +1,65 @@
+#ifndef PBD_X_COLLISIONDETECTOR_H
+#define PBD_X_COLLISIONDETECTOR_H
+
+#include <cstdint>
+#include <vector>
+#include "../core/PointMass.h"
+#include "TriangleBVH.h"
+
+// Accumulated cost and outcome of continuous collision handling
+struct CollisionStats {
+    double refitMs{0.0};
+    double traversalMs{0.0};
+    double narrowphaseMs{0.0};
+    int rebuilds{0};
+    int pointTriangleContacts{0};
+    int edgeEdgeContacts{0};
+};
+
+// Continuous point-triangle and edge-edge collision detection over the simulation's
+// surface triangles, for self- and inter-object contact. Positions are captured at the start
+// of a step; resolve() sweeps each primitive from there to its current position.
+class CollisionDetector {
+public:
+    void setThickness(float t) { thickness = t; }
+    [[nodiscard]] float getThickness() const { return thickness; }
+
+    void beginStep(const std::vector<PointMass*>& pointMasses);
+    // activeIslands flags, per island id, the islands that may move or be moved this
+    // step. Points and edges of the others are not swept, only hit.
+    void resolve(const std::vector<PointMass*>& pointMasses, const std::vector<int>& triangles, float dt,
+                 const std::vector<uint8_t>& activeIslands);
+
+    // Point masses moved by the last resolve(), so their islands can be woken
+    [[nodiscard]] const std::vector<PointMass*>& getTouched() const { return touched; }
+    [[nodiscard]] const CollisionStats& getStats() const { return stats; }
+    void resetStats() { stats = CollisionStats(); }
+    void invalidate() { bvh.clear(); edges.clear(); triangleEdges.clear(); neighborStart.clear(); }
+
+private:
+    void buildEdges(const std::vector<int>& triangles, int vertexCount);
+    // Edges (a, b) and (c, d) lie in one triangle's one-ring: they share a vertex or an
+    // edge joins them. Such pairs stay apart through the mesh itself.
+    [[nodiscard]] bool inOneRing(int a, int b, int c, int d) const;
+    [[nodiscard]] bool adjacent(int a, int b) const;
+    void push(int vertex, PointMass* pm, const Vector3D& delta, float invDt);
+
+    TriangleBVH bvh;
+    std::vector<Vector3D> start, end;
+    std::vector<int> edges;          // unique triangle edges, 2 vertex indices each
+    std::vector<int> triangleEdges;  // 3 edge indices per triangle
+    // Mesh neighbors of each vertex, sorted, in CSR form
+    std::vector<int> neighborStart;
+    std::vector<int> neighbors;
+    std::vector<Vector3D> edgeLo, edgeHi;
+    std::vector<uint8_t> active;
+    std::vector<std::pair<int, int>> candidates;  // point, triangle
+    std::vector<std::pair<int, int>> edgePairs;   // edge, edge
+    // Broadphase output per block of points or edges, joined in block order
+    std::vector<std::vector<std::pair<int, int>>> blockPairs;
+    std::vector<PointMass*> touched;
+    float thickness{0.01f};
+    CollisionStats stats;
+};
+
+#endif //PBD_X_COLLISIONDETECTOR_H
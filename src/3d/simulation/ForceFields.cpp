@@ -0,0 +1,311 @@
+#include "ForceFields.h"
+#include <algorithm>
+#include <cmath>
+#include <random>
+
+void ForceFields::addUniform(const Vector3D& force) {
+    uniform += force;
+    ++version;
+}
+
+void ForceFields::addWind(const Vector3D& velocity, float coefficient) {
+    windX.push_back(velocity.x);
+    windY.push_back(velocity.y);
+    windZ.push_back(velocity.z);
+    windCoefficient.push_back(coefficient);
+    ++version;
+}
+
+void ForceFields::addDrag(float linear, float quadratic) {
+    // Drag terms are additive, so any number of drag fields collapse into one
+    dragLinear += linear;
+    dragQuadratic += quadratic;
+    ++version;
+}
+
+void ForceFields::addVortex(const Vector3D& center, const Vector3D& axis, float strength, float coreRadius) {
+    Vector3D unit = axis.normalized();
+    vortexX.push_back(center.x);
+    vortexY.push_back(center.y);
+    vortexZ.push_back(center.z);
+    axisX.push_back(unit.x);
+    axisY.push_back(unit.y);
+    axisZ.push_back(unit.z);
+    vortexStrength.push_back(strength);
+    vortexCore.push_back(coreRadius);
+    ++version;
+}
+
+void ForceFields::addTurbulence(float strength, float cellSize, unsigned seed, int resolution) {
+    const int n = std::max(4, resolution);
+    const size_t cells = (size_t)n * n * n;
+    auto at = [n](int i, int j, int k) {
+        return ((size_t)((k + n) % n) * n + (size_t)((j + n) % n)) * n + (size_t)((i + n) % n);
+    };
+
+    // Random vector potential, smoothed once so the curl is not pure lattice noise
+    std::mt19937 random(seed);
+    std::uniform_real_distribution<float> uniformValue(-1.0f, 1.0f);
+    std::vector<float> raw[3], potential[3];
+    for (int c = 0; c < 3; ++c) {
+        raw[c].resize(cells);
+        potential[c].assign(cells, 0.0f);
+        for (float& v : raw[c]) v = uniformValue(random);
+    }
+    for (int c = 0; c < 3; ++c) {
+        for (int k = 0; k < n; ++k) {
+            for (int j = 0; j < n; ++j) {
+                for (int i = 0; i < n; ++i) {
+                    float sum = 0.0f;
+                    for (int dk = -1; dk <= 1; ++dk)
+                        for (int dj = -1; dj <= 1; ++dj)
+                            for (int di = -1; di <= 1; ++di) sum += raw[c][at(i + di, j + dj, k + dk)];
+                    potential[c][at(i, j, k)] = sum / 27.0f;
+                }
+            }
+        }
+    }
+
+    // Curl by central differences on the periodic lattice, normalized to unit RMS
+    Tile tile;
+    tile.resolution = n;
+    tile.strength = strength;
+    tile.invCellSize = 1.0f / cellSize;
+    tile.x.resize(cells);
+    tile.y.resize(cells);
+    tile.z.resize(cells);
+    double sumSq = 0.0;
+    for (int k = 0; k < n; ++k) {
+        for (int j = 0; j < n; ++j) {
+            for (int i = 0; i < n; ++i) {
+                auto d = [&](int c, int di, int dj, int dk) {
+                    return 0.5f * (potential[c][at(i + di, j + dj, k + dk)] - potential[c][at(i - di, j - dj, k - dk)]);
+                };
+                size_t idx = at(i, j, k);
+                tile.x[idx] = d(2, 0, 1, 0) - d(1, 0, 0, 1);
+                tile.y[idx] = d(0, 0, 0, 1) - d(2, 1, 0, 0);
+                tile.z[idx] = d(1, 1, 0, 0) - d(0, 0, 1, 0);
+                sumSq += tile.x[idx] * tile.x[idx] + tile.y[idx] * tile.y[idx] + tile.z[idx] * tile.z[idx];
+            }
+        }
+    }
+    const float norm = sumSq > 0.0 ? (float)(1.0 / std::sqrt(sumSq / cells)) : 0.0f;
+    for (size_t idx = 0; idx < cells; ++idx) {
+        tile.x[idx] *= norm;
+        tile.y[idx] *= norm;
+        tile.z[idx] *= norm;
+    }
+    tiles.push_back(std::move(tile));
+    ++version;
+}
+
+void ForceFields::setAerodynamics(const Vector3D& velocity, float density, float drag, float lift) {
+    airVelocity = velocity;
+    airDensity = density;
+    dragCoefficient = drag;
+    liftCoefficient = lift;
+    ++version;
+}
+
+void ForceFields::clear() {
+    uniform = Vector3D();
+    windX.clear(); windY.clear(); windZ.clear(); windCoefficient.clear();
+    dragLinear = dragQuadratic = 0.0f;
+    vortexX.clear(); vortexY.clear(); vortexZ.clear();
+    axisX.clear(); axisY.clear(); axisZ.clear();
+    vortexStrength.clear(); vortexCore.clear();
+    tiles.clear();
+    airDensity = 0.0f;
+    ++version;
+}
+
+bool ForceFields::empty() const {
+    return uniform.x == 0.0f && uniform.y == 0.0f && uniform.z == 0.0f && windCoefficient.empty() &&
+           dragLinear == 0.0f && dragQuadratic == 0.0f && vortexStrength.empty() && tiles.empty() &&
+           airDensity == 0.0f;
+}
+
+Vector3D ForceFields::sampleTile(const Tile& tile, const Vector3D& position) const {
+    const int n = tile.resolution;
+    const float u[3] = {position.x * tile.invCellSize, position.y * tile.invCellSize, position.z * tile.invCellSize};
+    int lo[3], hi[3];
+    float t[3];
+    for (int a = 0; a < 3; ++a) {
+        float cell = std::floor(u[a]);
+        t[a] = u[a] - cell;
+        int i = (int)cell % n;
+        lo[a] = i < 0 ? i + n : i;
+        hi[a] = lo[a] + 1 == n ? 0 : lo[a] + 1;
+    }
+
+    Vector3D result;
+    for (int corner = 0; corner < 8; ++corner) {
+        const int i = (corner & 1) ? hi[0] : lo[0];
+        const int j = (corner & 2) ? hi[1] : lo[1];
+        const int k = (corner & 4) ? hi[2] : lo[2];
+        const float w = ((corner & 1) ? t[0] : 1.0f - t[0]) * ((corner & 2) ? t[1] : 1.0f - t[1]) *
+                        ((corner & 4) ? t[2] : 1.0f - t[2]);
+        const size_t idx = ((size_t)k * n + j) * n + i;
+        result.x += w * tile.x[idx];
+        result.y += w * tile.y[idx];
+        result.z += w * tile.z[idx];
+    }
+    return result * tile.strength;
+}
+
+Vector3D ForceFields::evaluate(const Vector3D& p, const Vector3D& v) const {
+    Vector3D force = uniform;
+
+    for (size_t w = 0; w < windCoefficient.size(); ++w) {
+        force.x += windCoefficient[w] * (windX[w] - v.x);
+        force.y += windCoefficient[w] * (windY[w] - v.y);
+        force.z += windCoefficient[w] * (windZ[w] - v.z);
+    }
+
+    if (dragLinear != 0.0f || dragQuadratic != 0.0f) {
+        const float speed = std::sqrt(v.x * v.x + v.y * v.y + v.z * v.z);
+        const float drag = dragLinear + dragQuadratic * speed;
+        force.x -= drag * v.x;
+        force.y -= drag * v.y;
+        force.z -= drag * v.z;
+    }
+
+    for (size_t f = 0; f < vortexStrength.size(); ++f) {
+        float rx = p.x - vortexX[f], ry = p.y - vortexY[f], rz = p.z - vortexZ[f];
+        const float along = rx * axisX[f] + ry * axisY[f] + rz * axisZ[f];
+        rx -= along * axisX[f];
+        ry -= along * axisY[f];
+        rz -= along * axisZ[f];
+        const float scale = vortexStrength[f] / (rx * rx + ry * ry + rz * rz + vortexCore[f] * vortexCore[f]);
+        force.x += scale * (axisY[f] * rz - axisZ[f] * ry);
+        force.y += scale * (axisZ[f] * rx - axisX[f] * rz);
+        force.z += scale * (axisX[f] * ry - axisY[f] * rx);
+    }
+
+    for (const Tile& tile : tiles) {
+        force += sampleTile(tile, p);
+    }
+    return force;
+}
+
+void ForceFields::apply(const std::vector<PointMass*>& pointMasses, const Vector3D& load) const {
+    if (empty()) {
+        // Gravity-only frames skip the field evaluation entirely
+        if (load.x == 0.0f && load.y == 0.0f && load.z == 0.0f) return;
+        for (PointMass* pm : pointMasses) {
+            if (!pm->isFixed()) pm->applyForce(load);
+        }
+        return;
+    }
+    for (PointMass* pm : pointMasses) {
+        if (pm->isFixed()) continue;
+        pm->applyForce(load + evaluate(pm->getPosition(), pm->getVelocity()));
+    }
+}
+
+void ForceFields::apply(const std::vector<PointMass*>& pointMasses, const std::vector<int>& surface,
+                        const Vector3D& load, ForceScratch& scratch) const {
+    if (airDensity == 0.0f || surface.empty()) {
+        apply(pointMasses, load);
+        return;
+    }
+
+    // Gather the island into flat arrays for the triangle pass
+    const size_t n = pointMasses.size();
+    scratch.x.resize(n); scratch.y.resize(n); scratch.z.resize(n);
+    scratch.vx.resize(n); scratch.vy.resize(n); scratch.vz.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        Vector3D p = pointMasses[i]->getPosition();
+        Vector3D v = pointMasses[i]->getVelocity();
+        scratch.x[i] = p.x; scratch.y[i] = p.y; scratch.z[i] = p.z;
+        scratch.vx[i] = v.x; scratch.vy[i] = v.y; scratch.vz[i] = v.z;
+    }
+    scratch.fx.assign(n, 0.0f);
+    scratch.fy.assign(n, 0.0f);
+    scratch.fz.assign(n, 0.0f);
+    accumulateAerodynamics(surface, scratch);
+
+    // One force per particle: load, fields and its share of the surface forces
+    const bool fields = uniform.x != 0.0f || uniform.y != 0.0f || uniform.z != 0.0f || !windCoefficient.empty() ||
+                        dragLinear != 0.0f || dragQuadratic != 0.0f || !vortexStrength.empty() || !tiles.empty();
+    for (size_t i = 0; i < n; ++i) {
+        PointMass* pm = pointMasses[i];
+        if (pm->isFixed()) continue;
+        Vector3D force = load + Vector3D(scratch.fx[i], scratch.fy[i], scratch.fz[i]);
+        if (fields) {
+            force += evaluate({scratch.x[i], scratch.y[i], scratch.z[i]}, {scratch.vx[i], scratch.vy[i], scratch.vz[i]});
+        }
+        pm->applyForce(force);
+    }
+}
+
+void ForceFields::accumulateAerodynamics(const std::vector<int>& surface, ForceScratch& s) const {
+    // 1/2 rho, and 1/2 again since the cross product is twice the area; a third of the
+    // force goes to each vertex
+    const float drag = 0.25f * airDensity * dragCoefficient / 3.0f;
+    const float lift = 0.25f * airDensity * liftCoefficient / 3.0f;
+
+    // Triangles go through in chunks: gather into local planes, compute, scatter. Local
+    // arrays cannot alias, so the compute loop vectorizes without runtime checks.
+    constexpr int CHUNK = 64;
+    const int triangles = (int)surface.size() / 3;
+    for (int first = 0; first < triangles; first += CHUNK) {
+        const int count = std::min(CHUNK, triangles - first);
+        const int* v = &surface[(size_t)first * 3];
+        float e1x[CHUNK], e1y[CHUNK], e1z[CHUNK], e2x[CHUNK], e2y[CHUNK], e2z[CHUNK];
+        float uxs[CHUNK], uys[CHUNK], uzs[CHUNK];
+        float tx[CHUNK], ty[CHUNK], tz[CHUNK];
+
+        // Edges and velocity relative to the air
+        for (int t = 0; t < count; ++t) {
+            const int a = v[t * 3], b = v[t * 3 + 1], c = v[t * 3 + 2];
+            e1x[t] = s.x[b] - s.x[a]; e1y[t] = s.y[b] - s.y[a]; e1z[t] = s.z[b] - s.z[a];
+            e2x[t] = s.x[c] - s.x[a]; e2y[t] = s.y[c] - s.y[a]; e2z[t] = s.z[c] - s.z[a];
+            uxs[t] = (s.vx[a] + s.vx[b] + s.vx[c]) * (1.0f / 3.0f) - airVelocity.x;
+            uys[t] = (s.vy[a] + s.vy[b] + s.vy[c]) * (1.0f / 3.0f) - airVelocity.y;
+            uzs[t] = (s.vz[a] + s.vz[b] + s.vz[c]) * (1.0f / 3.0f) - airVelocity.z;
+        }
+
+        // Normals, areas and forces. Degenerate triangles and still air select zero
+        // instead of branching.
+        for (int t = 0; t < count; ++t) {
+            // Cross product: direction of the normal, length twice the area
+            const float cx = e1y[t] * e2z[t] - e1z[t] * e2y[t];
+            const float cy = e1z[t] * e2x[t] - e1x[t] * e2z[t];
+            const float cz = e1x[t] * e2y[t] - e1y[t] * e2x[t];
+            const float doubleArea = std::sqrt(cx * cx + cy * cy + cz * cz);
+            const float ux = uxs[t], uy = uys[t], uz = uzs[t];
+            const float speedSq = ux * ux + uy * uy + uz * uz;
+            const float speed = std::sqrt(speedSq);
+
+            // 2A (n.u) without dividing by the area
+            const float flux = cx * ux + cy * uy + cz * uz;
+            const float dragScale = -drag * std::fabs(flux);
+
+            // Lift along p, the part of n perpendicular to u; |p| is the sine of the angle
+            // between them, so lift vanishes both edge-on and face-on: 2A |u| (n.u) p
+            const bool valid = (doubleArea > 0.0f) & (speed > 1e-6f);
+            const float safeArea = valid ? doubleArea : 1.0f;
+            const float safeSpeedSq = valid ? speedSq : 1.0f;
+            const float along = flux / (safeArea * safeSpeedSq);
+            const float px = cx / safeArea - along * ux;
+            const float py = cy / safeArea - along * uy;
+            const float pz = cz / safeArea - along * uz;
+            const float liftScale = valid ? -lift * flux * speed : 0.0f;
+
+            tx[t] = dragScale * ux + liftScale * px;
+            ty[t] = dragScale * uy + liftScale * py;
+            tz[t] = dragScale * uz + liftScale * pz;
+        }
+
+        // Shared vertices keep the scatter sequential
+        for (int t = 0; t < count; ++t) {
+            for (int k = 0; k < 3; ++k) {
+                const int i = v[t * 3 + k];
+                s.fx[i] += tx[t];
+                s.fy[i] += ty[t];
+                s.fz[i] += tz[t];
+            }
+        }
+    }
+}
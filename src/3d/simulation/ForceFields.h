@@ -0,0 +1,82 @@
+#ifndef PBD_X_FORCEFIELDS_H
+#define PBD_X_FORCEFIELDS_H
+
+#include <vector>
+#include "../core/PointMass.h"
+
+// Persistent external force fields, evaluated for every free particle in every
+// substep. Fields are kept in one array per kind, so the fused pass runs over the
+// particles once and over each kind's parameters as plain arrays, and adds a single
+// summed force per particle.
+//
+// Surfaces also feel aerodynamic lift and drag: a pass over the triangles computes
+// each normal and area and the force of the air on the triangle from its velocity
+// relative to the air, split evenly among its vertices and added in the same sum.
+
+// Per-island buffers reused by the fused pass, so stepping allocates nothing
+struct ForceScratch {
+    // Particle state and summed surface force
+    std::vector<float> x, y, z, vx, vy, vz;
+    std::vector<float> fx, fy, fz;
+};
+
+class ForceFields {
+public:
+    // Same force on every particle (e.g. gravity scaled by mass)
+    void addUniform(const Vector3D& force);
+    // Air moving at velocity: coefficient * (velocity - particle velocity)
+    void addWind(const Vector3D& velocity, float coefficient);
+    // -(linear + quadratic * |v|) * v
+    void addDrag(float linear, float quadratic);
+    // Swirl around an axis through center: strength * (axis x r) / (|r|^2 + core^2),
+    // with r the offset perpendicular to the axis
+    void addVortex(const Vector3D& center, const Vector3D& axis, float strength, float coreRadius);
+    // Divergence-free turbulence: the curl of a random periodic potential, tabulated
+    // once on a resolution^3 tile of cellSize cells and sampled trilinearly, so the
+    // field repeats every resolution * cellSize
+    void addTurbulence(float strength, float cellSize, unsigned seed = 1, int resolution = 32);
+    // Thin-plate aerodynamics on surface triangles in air moving at airVelocity. With u
+    // the triangle velocity relative to the air, n its normal and A its area, drag is
+    // -1/2 rho Cd A |n.u| u and lift -1/2 rho Cl A |u| (n.u) p, where p = n - (n.u) u/|u|^2
+    // is the part of n perpendicular to u. A density of zero turns it off.
+    void setAerodynamics(const Vector3D& airVelocity, float density, float dragCoefficient, float liftCoefficient);
+    void clear();
+
+    [[nodiscard]] bool empty() const;
+    // Bumped on every change, so the simulation can wake sleeping islands
+    [[nodiscard]] int getVersion() const { return version; }
+
+    [[nodiscard]] Vector3D evaluate(const Vector3D& position, const Vector3D& velocity) const;
+    // The fused pass: load plus every field, applied to each free point mass
+    void apply(const std::vector<PointMass*>& pointMasses, const Vector3D& load) const;
+    // The same with aerodynamics on surface, triples of indices into pointMasses
+    void apply(const std::vector<PointMass*>& pointMasses, const std::vector<int>& surface, const Vector3D& load,
+               ForceScratch& scratch) const;
+
+private:
+    struct Tile {
+        int resolution;
+        float strength;
+        float invCellSize;
+        std::vector<float> x, y, z;
+    };
+
+    Vector3D sampleTile(const Tile& tile, const Vector3D& position) const;
+    void accumulateAerodynamics(const std::vector<int>& surface, ForceScratch& scratch) const;
+
+    Vector3D uniform;
+    std::vector<float> windX, windY, windZ, windCoefficient;
+    float dragLinear{0.0f};
+    float dragQuadratic{0.0f};
+    std::vector<float> vortexX, vortexY, vortexZ;
+    std::vector<float> axisX, axisY, axisZ;
+    std::vector<float> vortexStrength, vortexCore;
+    std::vector<Tile> tiles;
+    Vector3D airVelocity;
+    float airDensity{0.0f};
+    float dragCoefficient{1.0f};
+    float liftCoefficient{1.0f};
+    int version{0};
+};
+
+#endif //PBD_X_FORCEFIELDS_H
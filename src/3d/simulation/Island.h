@@ -0,0 +1,107 @@
+#ifndef PBD_X_ISLAND_H
+#define PBD_X_ISLAND_H
+
+#include <vector>
+#include "../core/PointMass.h"
+#include "../core/Spring.h"
+#include "TriangleConstraints.h"
+#include "MultigridSolver.h"
+#include "ForceFields.h"
+#include "KinematicTargets.h"
+#include "PickingBVH.h"
+
+// Long-range attachment: the particle may be at most maxDistance from its anchor, the
+// nearest pinned particle along the spring graph
+struct Tether {
+    PointMass* particle;
+    // Null once a torn spring cut the geodesic path, until the tethers are rebuilt
+    PointMass* anchor;
+    float maxDistance;
+    // Tether of the previous particle on the path, or -1 when that is the anchor.
+    // Tethers are stored in path order, so the parent always comes first.
+    int parent;
+};
+
+// Energy, momentum, strain and contact reductions taken inside the spring and
+// integration loops of a substep. Energies and momentum are of the free particles at
+// the start of that substep; sums are in doubles and in a fixed order, so they do not
+// depend on how islands are scheduled.
+struct Diagnostics {
+    double kineticEnergy{0.0};
+    double springEnergy{0.0};
+    // Potential of the uniform applyGlobalForce load, e.g. gravity, relative to the floor height
+    double loadEnergy{0.0};
+    double momentumX{0.0};
+    double momentumY{0.0};
+    double momentumZ{0.0};
+    double freeMass{0.0};
+    // Largest stretch over rest length and the sum of strain magnitudes
+    float maxStrain{0.0f};
+    double strainSum{0.0};
+    int springs{0};
+    // Particles pushed out of the floor or a static collider
+    int contacts{0};
+    // Largest particle speed after integration
+    float maxSpeed{0.0f};
+
+    void add(const Diagnostics& other);
+};
+
+inline void Diagnostics::add(const Diagnostics& other) {
+    kineticEnergy += other.kineticEnergy;
+    springEnergy += other.springEnergy;
+    loadEnergy += other.loadEnergy;
+    momentumX += other.momentumX;
+    momentumY += other.momentumY;
+    momentumZ += other.momentumZ;
+    freeMass += other.freeMass;
+    maxStrain = maxStrain > other.maxStrain ? maxStrain : other.maxStrain;
+    strainSum += other.strainSum;
+    springs += other.springs;
+    contacts += other.contacts;
+    maxSpeed = maxSpeed > other.maxSpeed ? maxSpeed : other.maxSpeed;
+}
+
+// A connected component of the spring graph. Islands are integrated or put to
+// sleep as a whole; a sleeping island costs update() only a check of its pins.
+struct Island {
+    std::vector<PointMass*> pointMasses;
+    std::vector<Spring*> springs;
+    // Area and dihedral bending constraints of the triangle cloth model
+    ConstraintBatch constraints;
+    std::vector<Tether> tethers;
+    // Some tethers were dropped by a tear; the island's are rebuilt at the next frame
+    bool tethersStale{false};
+    KinematicBatch kinematics;
+    // Surface triangles for aerodynamics, as triples of indices into pointMasses
+    std::vector<int> surface;
+    ForceScratch forceScratch;
+    MultigridSolver strainSolver;
+    bool sleeping{false};
+    // Pinned members when the island fell asleep; any change wakes it
+    std::vector<PointMass*> sleepPins;
+    // Time the island has continuously stayed below the sleep energy threshold
+    float calmTime{0.0f};
+    // Stepping bounds derived from topology at rebuild time
+    float minRestLength{0.0f};
+    float maxRestLength{0.0f};
+    float maxStiffnessPerMass{0.0f};
+    // Peak speed and local error estimate from the most recent substep
+    float maxSpeed{0.0f};
+    float stepError{0.0f};
+    // Reductions from the last substep of the most recent frame it was awake for
+    Diagnostics diagnostics;
+    // Substeps taken this frame under multirate stepping
+    int substeps{1};
+    // Time stepped so far this frame, where its kinematic targets are on their paths
+    float frameElapsed{0.0f};
+    // World-space bounds, refreshed while awake and frozen while asleep, and the same
+    // for every run of PickingBVH::CHUNK consecutive point masses
+    Vector3D boundsMin;
+    Vector3D boundsMax;
+    std::vector<Vector3D> chunkMin, chunkMax;
+    // Built on the first pick that reaches the island
+    PickingBVH pickTree;
+};
+
+#endif //PBD_X_ISLAND_H
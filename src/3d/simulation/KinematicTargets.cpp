@@ -0,0 +1,176 @@
+#include "KinematicTargets.h"
+#include <algorithm>
+#include <cmath>
+
+Vector3D KinematicPath::evaluate(float time) const {
+    if (script) return script(time);
+    if (positions.empty()) return Vector3D();
+    const size_t n = std::min(times.size(), positions.size());
+    if (n < 2) return positions.front();
+
+    const float start = times.front();
+    const float end = times[n - 1];
+    if (loop && end > start) {
+        time = start + std::fmod(time - start, end - start);
+        if (time < start) time += end - start;
+    }
+    if (time <= start) return positions.front();
+    if (time >= end) return positions[n - 1];
+
+    // times[k] <= time < times[k + 1]
+    const size_t k = std::upper_bound(times.begin(), times.begin() + n, time) - times.begin() - 1;
+    const float span = times[k + 1] - times[k];
+    const float u = (time - times[k]) / span;
+    const Vector3D& p0 = positions[k];
+    const Vector3D& p1 = positions[k + 1];
+    switch (interpolation) {
+        case Interpolation::Step:
+            return p0;
+        case Interpolation::Linear:
+            return p0 + (p1 - p0) * u;
+        case Interpolation::Smooth: {
+            // Cubic Hermite basis with the key tangents scaled to the span
+            const float u2 = u * u;
+            const float u3 = u2 * u;
+            return p0 * (2.0f * u3 - 3.0f * u2 + 1.0f) + tangent(k) * (span * (u3 - 2.0f * u2 + u)) +
+                   p1 * (3.0f * u2 - 2.0f * u3) + tangent(k + 1) * (span * (u3 - u2));
+        }
+    }
+    return p0;
+}
+
+bool KinematicPath::isValid() const {
+    if (script) return true;
+    if (times.empty() || times.size() != positions.size()) return false;
+    for (size_t k = 1; k < times.size(); ++k) {
+        if (times[k] <= times[k - 1]) return false;
+    }
+    return true;
+}
+
+Vector3D KinematicPath::tangent(size_t key) const {
+    // Central difference over the neighboring keys, across the seam when looping
+    const size_t n = std::min(times.size(), positions.size());
+    const float period = times[n - 1] - times.front();
+    Vector3D before = positions[key], after = positions[key];
+    float tBefore = times[key], tAfter = times[key];
+    if (key > 0) {
+        before = positions[key - 1];
+        tBefore = times[key - 1];
+    } else if (loop) {
+        before = positions[n - 2];
+        tBefore = times[n - 2] - period;
+    }
+    if (key + 1 < n) {
+        after = positions[key + 1];
+        tAfter = times[key + 1];
+    } else if (loop) {
+        after = positions[1];
+        tAfter = times[1] + period;
+    }
+    return tAfter > tBefore ? (after - before) / (tAfter - tBefore) : Vector3D();
+}
+
+int KinematicTargets::find(int id) const {
+    auto found = slots.find(id);
+    return found == slots.end() ? -1 : found->second;
+}
+
+void KinematicTargets::set(int id, int path, const Vector3D& offset) {
+    auto [found, added] = slots.emplace(id, (int)ids.size());
+    if (added) {
+        ids.push_back(id);
+        pathIndices.push_back(path);
+        offsets.push_back(offset);
+    } else {
+        pathIndices[found->second] = path;
+        offsets[found->second] = offset;
+    }
+}
+
+bool KinematicTargets::remove(int id) {
+    auto found = slots.find(id);
+    if (found == slots.end()) return false;
+    const int target = found->second;
+    slots.erase(found);
+    const int last = (int)ids.size() - 1;
+    if (target != last) {
+        ids[target] = ids[last];
+        pathIndices[target] = pathIndices[last];
+        offsets[target] = offsets[last];
+        slots[ids[target]] = target;
+    }
+    ids.pop_back();
+    pathIndices.pop_back();
+    offsets.pop_back();
+    return true;
+}
+
+void KinematicTargets::clear() {
+    paths.clear();
+    ids.clear();
+    pathIndices.clear();
+    offsets.clear();
+    slots.clear();
+}
+
+void KinematicBatch::add(PointMass* particle, int path, const Vector3D& offset) {
+    auto slot = std::find(paths.begin(), paths.end(), path);
+    if (slot == paths.end()) slot = paths.insert(slot, path);
+    particles.push_back(particle);
+    pathSlots.push_back((int)(slot - paths.begin()));
+    offsets.push_back(offset);
+}
+
+void KinematicBatch::remove(const PointMass* particle) {
+    auto found = std::find(particles.begin(), particles.end(), particle);
+    if (found == particles.end()) return;
+    const size_t i = found - particles.begin();
+    particles[i] = particles.back();
+    pathSlots[i] = pathSlots.back();
+    offsets[i] = offsets.back();
+    particles.pop_back();
+    pathSlots.pop_back();
+    offsets.pop_back();
+}
+
+void KinematicBatch::clear() {
+    particles.clear();
+    pathSlots.clear();
+    offsets.clear();
+    paths.clear();
+    to.clear();
+    velocities.clear();
+}
+
+void moveKinematicTargets(KinematicBatch& batch, const std::vector<KinematicPath>& paths, float t0, float t1) {
+    const size_t pathCount = batch.paths.size();
+    batch.to.resize(pathCount);
+    batch.velocities.resize(pathCount);
+    const float invDt = t1 > t0 ? 1.0f / (t1 - t0) : 0.0f;
+    for (size_t p = 0; p < pathCount; ++p) {
+        const KinematicPath& path = paths[batch.paths[p]];
+        batch.to[p] = path.evaluate(t1);
+        batch.velocities[p] = path.isContinuous() ? (batch.to[p] - path.evaluate(t0)) * invDt : Vector3D();
+    }
+
+    for (size_t i = 0; i < batch.particles.size(); ++i) {
+        const int p = batch.pathSlots[i];
+        batch.particles[i]->setPosition(batch.to[p] + batch.offsets[i]);
+        batch.particles[i]->setVelocity(batch.velocities[p]);
+    }
+}
+
+bool kinematicTargetsMoved(KinematicBatch& batch, const std::vector<KinematicPath>& paths, float time,
+                           float tolerance) {
+    const size_t pathCount = batch.paths.size();
+    batch.to.resize(pathCount);
+    for (size_t p = 0; p < pathCount; ++p) {
+        batch.to[p] = paths[batch.paths[p]].evaluate(time);
+    }
+    for (size_t i = 0; i < batch.particles.size(); ++i) {
+        Vector3D target = batch.to[batch.pathSlots[i]] + batch.offsets[i];
+        if ((batch.particles[i]->getPosition() - target).magnitude() > tolerance) return true;
+    }
+    return false;
+}
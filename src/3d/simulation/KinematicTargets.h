@@ -0,0 +1,84 @@
+#ifndef PBD_X_KINEMATICTARGETS_H
+#define PBD_X_KINEMATICTARGETS_H
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include "../core/PointMass.h"
+
+// Trajectory of a kinematic target: keyframed positions at increasing times,
+// interpolated in between and held before the first and after the last key. A
+// looping path repeats with the period of its keys, so its last key should equal
+// its first. A scripted path is a function of simulation time instead.
+struct KinematicPath {
+    enum class Interpolation { Step, Linear, Smooth };
+
+    std::vector<float> times;
+    std::vector<Vector3D> positions;
+    // Smooth is a Catmull-Rom spline through the keys
+    Interpolation interpolation{Interpolation::Linear};
+    bool loop{false};
+    std::function<Vector3D(float)> script;
+
+    [[nodiscard]] Vector3D evaluate(float time) const;
+    // A script, or at least one key with a position per key and increasing times
+    [[nodiscard]] bool isValid() const;
+    // Step paths jump between keys, so the particles they carry are not given the
+    // velocity of the jump
+    [[nodiscard]] bool isContinuous() const { return script || interpolation != Interpolation::Step; }
+
+private:
+    [[nodiscard]] Vector3D tangent(size_t key) const;
+};
+
+// Pinned particles driven along paths, stored flat and keyed by point mass id in
+// the owning simulation. A target follows its path at a fixed offset.
+struct KinematicTargets {
+    std::vector<KinematicPath> paths;
+    std::vector<int> ids;
+    std::vector<int> pathIndices;
+    std::vector<Vector3D> offsets;
+    // Index of each point mass id's target
+    std::unordered_map<int, int> slots;
+
+    // Index of the target of a point mass, or -1
+    [[nodiscard]] int find(int id) const;
+    // Give a point mass a target on path, or move its target there
+    void set(int id, int path, const Vector3D& offset);
+    // Drop the target of a point mass; the last target takes its index. Returns
+    // whether it had one.
+    bool remove(int id);
+    void clear();
+    [[nodiscard]] bool empty() const { return ids.empty(); }
+};
+
+// Per-island copy of its targets, kept apart from the island's point masses, with
+// the paths they use renumbered so each is evaluated once per substep.
+struct KinematicBatch {
+    std::vector<PointMass*> particles;
+    std::vector<int> pathSlots;
+    std::vector<Vector3D> offsets;
+    // Indices into KinematicTargets::paths
+    std::vector<int> paths;
+
+    // Each path's position at the end of the substep and velocity over it, reused
+    // every substep
+    std::vector<Vector3D> to, velocities;
+
+    // Paths stay numbered once added, so removing a particle leaves its path's slot
+    void add(PointMass* particle, int path, const Vector3D& offset);
+    void remove(const PointMass* particle);
+    void clear();
+    [[nodiscard]] bool empty() const { return particles.empty(); }
+};
+
+// The batched pass run before forces are evaluated in each substep from t0 to t1:
+// every path is evaluated at both ends, then every target is moved to its end
+// position and given the path's velocity over the substep, which spring damping sees.
+void moveKinematicTargets(KinematicBatch& batch, const std::vector<KinematicPath>& paths, float t0, float t1);
+// Whether a target is further than tolerance from its path at time, e.g. so that a
+// sleeping island is woken when its targets start moving again
+[[nodiscard]] bool kinematicTargetsMoved(KinematicBatch& batch, const std::vector<KinematicPath>& paths, float time,
+                                         float tolerance);
+
+#endif //PBD_X_KINEMATICTARGETS_H
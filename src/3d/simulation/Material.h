@@ -0,0 +1,21 @@
+#ifndef PBD_X_MATERIAL_H
+#define PBD_X_MATERIAL_H
+
+// Mass and spring constants used when building a body
+struct Material {
+    float mass{1.0f};
+    float stiffness{100.0f};      // structural springs
+    float shearStiffness{30.0f};  // cloth diagonals
+    float bendStiffness{20.0f};   // skip-one and mesh bending springs
+    float damping{1.0f};
+
+    // Ropes are stiffer and more damped than cloth by default
+    static Material rope() {
+        Material m;
+        m.stiffness = 200.0f;
+        m.damping = 2.0f;
+        return m;
+    }
+};
+
+#endif //PBD_X_MATERIAL_H
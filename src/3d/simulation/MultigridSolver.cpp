@@ -0,0 +1,516 @@
+#include "MultigridSolver.h"
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdint>
+#include <queue>
+
+namespace {
+
+// Coarsest levels are solved by smoothing alone once they get this small
+constexpr int MIN_COARSE_NODES = 16;
+// Over-relaxation of the averaged Jacobi corrections
+constexpr float RELAXATION = 1.5f;
+// A coarse constraint whose way around a tear is longer than this many times its rest
+// length is disabled rather than lengthened
+constexpr float MAX_DETOUR = 4.0f;
+
+} // namespace
+
+void MultigridSolver::clear() {
+    vertices.clear();
+    vertexOrder.clear();
+    levels.clear();
+    disabledCoarseConstraints = 0;
+}
+
+void MultigridSolver::initFineLevel(const std::vector<PointMass*>& pointMasses, const std::vector<Spring*>& springs) {
+    clear();
+    vertices = pointMasses;
+
+    vertexOrder.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        vertexOrder[i] = {vertices[i], (int)i};
+    }
+    std::sort(vertexOrder.begin(), vertexOrder.end());
+
+    levels.emplace_back();
+    Level& fine = levels.back();
+    for (Spring* spring : springs) {
+        int a = vertexIndex(spring->getPointMass1());
+        int b = vertexIndex(spring->getPointMass2());
+        if (a < 0 || b < 0) continue;
+        fine.constraintA.push_back(a);
+        fine.constraintB.push_back(b);
+        fine.restLengths.push_back(spring->getRestLength());
+    }
+    fine.mass.resize(vertices.size());
+    for (size_t i = 0; i < vertices.size(); ++i) {
+        fine.mass[i] = vertices[i]->getMass();
+    }
+    buildAdjacency(fine);
+}
+
+void MultigridSolver::buildAdjacency(Level& level) {
+    const int n = (int)level.mass.size();
+    level.adjacencyStart.assign(n + 1, 0);
+    for (size_t c = 0; c < level.constraintA.size(); ++c) {
+        level.adjacencyStart[level.constraintA[c] + 1]++;
+        level.adjacencyStart[level.constraintB[c] + 1]++;
+    }
+    for (int i = 0; i < n; ++i) {
+        level.adjacencyStart[i + 1] += level.adjacencyStart[i];
+    }
+    level.adjacency.resize(level.adjacencyStart[n]);
+    level.adjacencyRest.resize(level.adjacencyStart[n]);
+    level.adjacencyConstraint.resize(level.adjacencyStart[n]);
+    std::vector<int> fill(level.adjacencyStart.begin(), level.adjacencyStart.end() - 1);
+    for (size_t c = 0; c < level.constraintA.size(); ++c) {
+        int a = level.constraintA[c], b = level.constraintB[c];
+        level.adjacency[fill[a]] = b;
+        level.adjacencyRest[fill[a]] = level.restLengths[c];
+        level.adjacencyConstraint[fill[a]++] = (int)c;
+        level.adjacency[fill[b]] = a;
+        level.adjacencyRest[fill[b]] = level.restLengths[c];
+        level.adjacencyConstraint[fill[b]++] = (int)c;
+    }
+}
+
+int MultigridSolver::vertexIndex(const PointMass* pm) const {
+    auto it = std::lower_bound(vertexOrder.begin(), vertexOrder.end(), std::make_pair(pm, INT32_MIN));
+    return (it != vertexOrder.end() && it->first == pm) ? it->second : -1;
+}
+
+void MultigridSolver::setRestLength(Level& level, int c, float restLength) {
+    // An unreachable rest length is never active in a sweep, never on a shortest path
+    level.restLengths[c] = restLength;
+    for (int end : {level.constraintA[c], level.constraintB[c]}) {
+        for (int k = level.adjacencyStart[end]; k < level.adjacencyStart[end + 1]; ++k) {
+            if (level.adjacencyConstraint[k] == c) level.adjacencyRest[k] = restLength;
+        }
+    }
+}
+
+void MultigridSolver::localDistances(const Level& level, const std::vector<int>& sources, float limit,
+                                     std::vector<float>& distance, std::vector<int>& visited) {
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int s : sources) {
+        if (distance[s] == 0.0f) continue;
+        if (distance[s] == FLT_MAX) visited.push_back(s);
+        distance[s] = 0.0f;
+        queue.emplace(0.0f, s);
+    }
+    while (!queue.empty()) {
+        auto [d, u] = queue.top();
+        queue.pop();
+        if (d > distance[u]) continue;
+        for (int k = level.adjacencyStart[u]; k < level.adjacencyStart[u + 1]; ++k) {
+            int v = level.adjacency[k];
+            float nd = d + level.adjacencyRest[k];
+            if (nd <= limit && nd < distance[v]) {
+                if (distance[v] == FLT_MAX) visited.push_back(v);
+                distance[v] = nd;
+                queue.emplace(nd, v);
+            }
+        }
+    }
+}
+
+bool MultigridSolver::removeConstraint(const PointMass* a, const PointMass* b) {
+    if (levels.empty()) return false;
+    const int ia = vertexIndex(a), ib = vertexIndex(b);
+    if (ia < 0 || ib < 0) return false;
+
+    Level& fine = levels[0];
+    int removed = -1;
+    for (int k = fine.adjacencyStart[ia]; k < fine.adjacencyStart[ia + 1] && removed < 0; ++k) {
+        const int c = fine.adjacencyConstraint[k];
+        if (fine.adjacency[k] == ib && fine.restLengths[c] != FLT_MAX) removed = c;
+    }
+    if (removed < 0) return false;
+    setRestLength(fine, removed, FLT_MAX);
+
+    // A coarse geodesic can only have crossed a changed constraint of the level below if
+    // its source representative lies within its rest length of the change. Those
+    // candidates are measured again around the tear; the ones that grew are the changes
+    // the next level looks for.
+    std::vector<int> changed = {removed}, grown, sources, candidates, visited;
+    std::vector<float> distance;
+    auto reset = [&distance, &visited]() {
+        for (int v : visited) distance[v] = FLT_MAX;
+        visited.clear();
+    };
+    for (size_t l = 1; l < levels.size() && !changed.empty(); ++l) {
+        const Level& above = levels[l - 1];
+        Level& level = levels[l];
+        distance.assign(above.mass.size(), FLT_MAX);
+
+        float reach = 0.0f;
+        for (float rest : level.restLengths) {
+            if (rest != FLT_MAX) reach = std::max(reach, rest);
+        }
+        sources.clear();
+        for (int c : changed) {
+            sources.push_back(above.constraintA[c]);
+            sources.push_back(above.constraintB[c]);
+        }
+        localDistances(above, sources, reach, distance, visited);
+        candidates.clear();
+        for (int v : visited) {
+            const int p = above.coarseNode[v];
+            if (p < 0) continue;
+            for (int k = level.adjacencyStart[p]; k < level.adjacencyStart[p + 1]; ++k) {
+                const int c = level.adjacencyConstraint[k];
+                if (level.restLengths[c] != FLT_MAX && distance[v] <= level.restLengths[c]) candidates.push_back(c);
+            }
+        }
+        reset();
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end()), candidates.end());
+
+        grown.clear();
+        for (int c : candidates) {
+            const float rest = level.restLengths[c];
+            sources.assign(1, level.representative[level.constraintA[c]]);
+            localDistances(above, sources, rest * MAX_DETOUR, distance, visited);
+            const float detour = distance[level.representative[level.constraintB[c]]];
+            reset();
+            // The same path summed again; a different one of equal length may round apart
+            if (detour <= rest * (1.0f + 1e-5f)) continue;
+            setRestLength(level, c, detour);
+            if (detour == FLT_MAX) disabledCoarseConstraints++;
+            grown.push_back(c);
+        }
+        changed.swap(grown);
+    }
+    return true;
+}
+
+float MultigridSolver::disabledFraction() const {
+    size_t coarse = 0;
+    for (size_t l = 1; l < levels.size(); ++l) coarse += levels[l].restLengths.size();
+    return coarse > 0 ? (float)disabledCoarseConstraints / (float)coarse : 0.0f;
+}
+
+void MultigridSolver::geodesicRestLengths(const Level& fine, Level& coarse) {
+    const int coarseCount = (int)coarse.representative.size();
+    std::vector<int> byStart(coarseCount + 1, 0);
+    for (int a : coarse.constraintA) byStart[a + 1]++;
+    for (int i = 0; i < coarseCount; ++i) byStart[i + 1] += byStart[i];
+    std::vector<int> order(coarse.constraintA.size());
+    std::vector<int> fill(byStart.begin(), byStart.end() - 1);
+    for (size_t c = 0; c < coarse.constraintA.size(); ++c) {
+        order[fill[coarse.constraintA[c]]++] = (int)c;
+    }
+
+    coarse.restLengths.assign(coarse.constraintA.size(), FLT_MAX);
+    std::vector<float> distance(fine.mass.size(), FLT_MAX);
+    std::vector<int> visited;
+    std::vector<int> targets;
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+
+    // Dijkstra from each coarse node's representative, stopped once every neighbour's
+    // representative is settled; the searches stay local
+    for (int p = 0; p < coarseCount; ++p) {
+        if (byStart[p] == byStart[p + 1]) continue;
+        targets.clear();
+        for (int k = byStart[p]; k < byStart[p + 1]; ++k) {
+            targets.push_back(coarse.representative[coarse.constraintB[order[k]]]);
+        }
+        int pending = (int)targets.size();
+
+        int source = coarse.representative[p];
+        distance[source] = 0.0f;
+        visited.push_back(source);
+        queue.emplace(0.0f, source);
+        while (!queue.empty() && pending > 0) {
+            auto [d, u] = queue.top();
+            queue.pop();
+            if (d > distance[u]) continue;
+            pending -= (int)std::count(targets.begin(), targets.end(), u);
+            for (int k = fine.adjacencyStart[u]; k < fine.adjacencyStart[u + 1]; ++k) {
+                int v = fine.adjacency[k];
+                float nd = d + fine.adjacencyRest[k];
+                if (nd < distance[v]) {
+                    if (distance[v] == FLT_MAX) visited.push_back(v);
+                    distance[v] = nd;
+                    queue.emplace(nd, v);
+                }
+            }
+        }
+
+        for (int k = byStart[p]; k < byStart[p + 1]; ++k) {
+            int c = order[k];
+            coarse.restLengths[c] = distance[coarse.representative[coarse.constraintB[c]]];
+        }
+        for (int v : visited) distance[v] = FLT_MAX;
+        visited.clear();
+        queue = decltype(queue)();
+    }
+}
+
+void MultigridSolver::buildGrid(const std::vector<PointMass*>& pointMasses, const std::vector<Spring*>& springs,
+                                int width, int height, int maxLevels) {
+    initFineLevel(pointMasses, springs);
+
+    int w = width, h = height;
+    while ((int)levels.size() < maxLevels && w >= 3 && h >= 3) {
+        // Keep every other row and column; odd sizes keep their last row and column too
+        const int cw = (w + 1) / 2, ch = (h + 1) / 2;
+        if (cw * ch < MIN_COARSE_NODES) break;
+        const int fineLevel = (int)levels.size() - 1;
+        levels.emplace_back();
+        Level& fine = levels[fineLevel];
+        Level& coarse = levels.back();
+
+        coarse.representative.resize(cw * ch);
+        for (int y = 0; y < ch; ++y) {
+            for (int x = 0; x < cw; ++x) {
+                coarse.representative[y * cw + x] = std::min(2 * y, h - 1) * w + std::min(2 * x, w - 1);
+            }
+        }
+        fine.coarseNode.assign(w * h, -1);
+        for (int j = 0; j < cw * ch; ++j) fine.coarseNode[coarse.representative[j]] = j;
+        for (int y = 0; y < ch; ++y) {
+            for (int x = 0; x < cw; ++x) {
+                int i = y * cw + x;
+                auto link = [&coarse, i](int j) {
+                    coarse.constraintA.push_back(i);
+                    coarse.constraintB.push_back(j);
+                };
+                if (x + 1 < cw) link(i + 1);
+                if (y + 1 < ch) link(i + cw);
+                if (x + 1 < cw && y + 1 < ch) link(i + cw + 1);
+                if (x > 0 && y + 1 < ch) link(i + cw - 1);
+            }
+        }
+
+        // Bilinear prolongation: a fine node between coarse rows/columns takes half of each
+        auto spans = [](int f, int coarseSize, int& c0, int& c1, float& t) {
+            c0 = f / 2;
+            c1 = std::min(c0 + 1, coarseSize - 1);
+            t = (f % 2 == 1 && c1 != c0) ? 0.5f : 0.0f;
+        };
+        fine.prolongStart.assign(1, 0);
+        coarse.mass.assign(cw * ch, 0.0f);
+        for (int y = 0; y < h; ++y) {
+            int y0, y1;
+            float ty;
+            spans(y, ch, y0, y1, ty);
+            for (int x = 0; x < w; ++x) {
+                int x0, x1;
+                float tx;
+                spans(x, cw, x0, x1, tx);
+                const int corner[4] = {y0 * cw + x0, y0 * cw + x1, y1 * cw + x0, y1 * cw + x1};
+                const float weight[4] = {(1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty};
+                for (int k = 0; k < 4; ++k) {
+                    if (weight[k] <= 0.0f) continue;
+                    fine.prolongIndex.push_back(corner[k]);
+                    fine.prolongWeight.push_back(weight[k]);
+                    coarse.mass[corner[k]] += weight[k] * fine.mass[y * w + x];
+                }
+                fine.prolongStart.push_back((int)fine.prolongIndex.size());
+            }
+        }
+
+        geodesicRestLengths(fine, coarse);
+        buildAdjacency(coarse);
+        w = cw;
+        h = ch;
+    }
+}
+
+void MultigridSolver::buildAggregated(const std::vector<PointMass*>& pointMasses, const std::vector<Spring*>& springs,
+                                      int maxLevels) {
+    initFineLevel(pointMasses, springs);
+
+    while ((int)levels.size() < maxLevels) {
+        const int fineLevel = (int)levels.size() - 1;
+        const int n = (int)levels[fineLevel].mass.size();
+        if (n <= MIN_COARSE_NODES) break;
+
+        // Greedy aggregation: an unassigned node seeds an aggregate with all of its
+        // unassigned neighbours
+        std::vector<int> aggregate(n, -1);
+        std::vector<int> seeds;
+        {
+            const Level& fine = levels[fineLevel];
+            for (int i = 0; i < n; ++i) {
+                if (aggregate[i] >= 0) continue;
+                aggregate[i] = (int)seeds.size();
+                for (int k = fine.adjacencyStart[i]; k < fine.adjacencyStart[i + 1]; ++k) {
+                    if (aggregate[fine.adjacency[k]] < 0) aggregate[fine.adjacency[k]] = (int)seeds.size();
+                }
+                seeds.push_back(i);
+            }
+        }
+        // Stop when the graph no longer shrinks, e.g. a cloud of unconnected particles
+        if ((int)seeds.size() * 4 > n * 3) break;
+
+        levels.emplace_back();
+        Level& fine = levels[fineLevel];
+        Level& coarse = levels.back();
+        coarse.representative = seeds;
+        fine.coarseNode.assign(n, -1);
+        for (size_t j = 0; j < seeds.size(); ++j) fine.coarseNode[seeds[j]] = (int)j;
+        coarse.mass.assign(seeds.size(), 0.0f);
+        fine.prolongStart.resize(n + 1);
+        fine.prolongIndex.resize(n);
+        fine.prolongWeight.assign(n, 1.0f);
+        for (int i = 0; i < n; ++i) {
+            fine.prolongStart[i] = i;
+            fine.prolongIndex[i] = aggregate[i];
+            coarse.mass[aggregate[i]] += fine.mass[i];
+        }
+        fine.prolongStart[n] = n;
+
+        // Aggregates are linked wherever a finer constraint crosses between them
+        std::vector<uint64_t> keys;
+        for (size_t c = 0; c < fine.constraintA.size(); ++c) {
+            uint32_t a = (uint32_t)aggregate[fine.constraintA[c]], b = (uint32_t)aggregate[fine.constraintB[c]];
+            if (a == b) continue;
+            if (a > b) std::swap(a, b);
+            keys.push_back(((uint64_t)a << 32) | b);
+        }
+        std::sort(keys.begin(), keys.end());
+        keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+        for (uint64_t key : keys) {
+            coarse.constraintA.push_back((int)(key >> 32));
+            coarse.constraintB.push_back((int)(key & 0xffffffffu));
+        }
+
+        geodesicRestLengths(fine, coarse);
+        buildAdjacency(coarse);
+    }
+}
+
+void MultigridSolver::solve(float dt, float maxStretch, int cycles, int smoothingIterations) {
+    if (levels.empty()) return;
+
+    Level& fine = levels[0];
+    const int n = (int)vertices.size();
+    fine.x.resize(n); fine.y.resize(n); fine.z.resize(n); fine.invMass.resize(n);
+    fine.sx.resize(n); fine.sy.resize(n); fine.sz.resize(n);
+    for (int i = 0; i < n; ++i) {
+        auto pos = vertices[i]->getPosition();
+        fine.x[i] = fine.sx[i] = pos.x;
+        fine.y[i] = fine.sy[i] = pos.y;
+        fine.z[i] = fine.sz[i] = pos.z;
+        fine.invMass[i] = vertices[i]->isFixed() ? 0.0f : 1.0f / fine.mass[i];
+    }
+
+    // Pins can change between solves; a coarse node touching a pinned node is pinned
+    for (size_t l = 1; l < levels.size(); ++l) {
+        Level& above = levels[l - 1];
+        Level& level = levels[l];
+        const int m = (int)level.mass.size();
+        level.invMass.resize(m);
+        for (int j = 0; j < m; ++j) level.invMass[j] = 1.0f / level.mass[j];
+        for (int i = 0; i < (int)above.mass.size(); ++i) {
+            if (above.invMass[i] > 0.0f) continue;
+            for (int k = above.prolongStart[i]; k < above.prolongStart[i + 1]; ++k) {
+                level.invMass[above.prolongIndex[k]] = 0.0f;
+            }
+        }
+    }
+
+    for (int c = 0; c < cycles; ++c) {
+        vCycle(0, maxStretch, smoothingIterations);
+    }
+
+    // Carry the corrections into the velocities as the other projections do
+    const float invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+    for (int i = 0; i < n; ++i) {
+        if (fine.invMass[i] == 0.0f) continue;
+        Vector3D delta(fine.x[i] - fine.sx[i], fine.y[i] - fine.sy[i], fine.z[i] - fine.sz[i]);
+        PointMass* pm = vertices[i];
+        pm->setPosition(Vector3D(fine.x[i], fine.y[i], fine.z[i]));
+        pm->setVelocity(pm->getVelocity() + delta * invDt);
+    }
+}
+
+void MultigridSolver::vCycle(int l, float maxStretch, int smoothingIterations) {
+    Level& fine = levels[l];
+    smooth(fine, maxStretch, smoothingIterations);
+    if (l + 1 >= (int)levels.size()) return;
+
+    // Restrict by injection: a coarse node sits where its representative is
+    Level& coarse = levels[l + 1];
+    const int m = (int)coarse.mass.size();
+    coarse.x.resize(m); coarse.y.resize(m); coarse.z.resize(m);
+    coarse.sx.resize(m); coarse.sy.resize(m); coarse.sz.resize(m);
+    for (int j = 0; j < m; ++j) {
+        int r = coarse.representative[j];
+        coarse.x[j] = coarse.sx[j] = fine.x[r];
+        coarse.y[j] = coarse.sy[j] = fine.y[r];
+        coarse.z[j] = coarse.sz[j] = fine.z[r];
+    }
+
+    vCycle(l + 1, maxStretch, smoothingIterations);
+
+    const int n = (int)fine.mass.size();
+    for (int i = 0; i < n; ++i) {
+        if (fine.invMass[i] == 0.0f) continue;
+        for (int k = fine.prolongStart[i]; k < fine.prolongStart[i + 1]; ++k) {
+            int j = fine.prolongIndex[k];
+            float w = fine.prolongWeight[k];
+            fine.x[i] += w * (coarse.x[j] - coarse.sx[j]);
+            fine.y[i] += w * (coarse.y[j] - coarse.sy[j]);
+            fine.z[i] += w * (coarse.z[j] - coarse.sz[j]);
+        }
+    }
+
+    smooth(fine, maxStretch, smoothingIterations);
+}
+
+void MultigridSolver::smooth(Level& level, float maxStretch, int iterations) {
+    const int n = (int)level.mass.size();
+    const int constraints = (int)level.restLengths.size();
+    const float limitScale = 1.0f + maxStretch;
+
+    for (int it = 0; it < iterations; ++it) {
+        level.dx.assign(n, 0.0f); level.dy.assign(n, 0.0f); level.dz.assign(n, 0.0f);
+        level.count.assign(n, 0.0f);
+
+        for (int c = 0; c < constraints; ++c) {
+            const int a = level.constraintA[c], b = level.constraintB[c];
+            float ex = level.x[b] - level.x[a], ey = level.y[b] - level.y[a], ez = level.z[b] - level.z[a];
+            float len = std::sqrt(ex * ex + ey * ey + ez * ez);
+            float limit = level.restLengths[c] * limitScale;
+            float wa = level.invMass[a], wb = level.invMass[b];
+            if (len <= limit || len < 1e-9f || wa + wb == 0.0f) continue;
+
+            float s = (len - limit) / (len * (wa + wb));
+            ex *= s; ey *= s; ez *= s;
+            level.dx[a] += wa * ex; level.dy[a] += wa * ey; level.dz[a] += wa * ez;
+            level.dx[b] -= wb * ex; level.dy[b] -= wb * ey; level.dz[b] -= wb * ez;
+            level.count[a] += 1.0f;
+            level.count[b] += 1.0f;
+        }
+
+        for (int i = 0; i < n; ++i) {
+            if (level.count[i] == 0.0f) continue;
+            float inv = RELAXATION / level.count[i];
+            level.x[i] += level.dx[i] * inv;
+            level.y[i] += level.dy[i] * inv;
+            level.z[i] += level.dz[i] * inv;
+        }
+    }
+}
+
+float MultigridSolver::residual(float maxStretch) const {
+    if (levels.empty() || levels[0].restLengths.empty()) return 0.0f;
+    const Level& fine = levels[0];
+    double sum = 0.0;
+    size_t active = 0;
+    for (size_t c = 0; c < fine.restLengths.size(); ++c) {
+        if (fine.restLengths[c] == FLT_MAX) continue;  // torn
+        float len = (vertices[fine.constraintB[c]]->getPosition() - vertices[fine.constraintA[c]]->getPosition()).magnitude();
+        float over = std::max(0.0f, len / fine.restLengths[c] - (1.0f + maxStretch));
+        sum += (double)over * over;
+        active++;
+    }
+    return active > 0 ? (float)std::sqrt(sum / active) : 0.0f;
+}
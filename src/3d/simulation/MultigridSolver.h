@@ -0,0 +1,91 @@
+#ifndef PBD_X_MULTIGRIDSOLVER_H
+#define PBD_X_MULTIGRIDSOLVER_H
+
+#include <vector>
+#include "../core/PointMass.h"
+#include "../core/Spring.h"
+
+// Strain limiting of an island's springs, solved on a hierarchy of distance
+// constraints. Level 0 holds the springs themselves; every coarser level keeps a
+// subset of the nodes above it (every other row and column of a cloth grid, or one
+// seed per aggregate on irregular meshes) linked by constraints whose rest length is
+// the geodesic rest distance through the finer level. Constraints are unilateral:
+// they only shorten edges stretched past (1 + maxStretch) times their rest length.
+//
+// A V-cycle smooths with Jacobi sweeps, injects positions into the coarser level,
+// recurses, and prolongates the coarse corrections back down (bilinearly on grids,
+// piecewise constant on aggregates), so sag across the whole cloth is removed in a
+// few cycles instead of one spring per sweep. With a single level this is the flat
+// Jacobi solver.
+class MultigridSolver {
+public:
+    // vertices must be the width x height grid in row-major order
+    void buildGrid(const std::vector<PointMass*>& vertices, const std::vector<Spring*>& springs,
+                   int width, int height, int maxLevels);
+    // Greedy aggregation over the spring graph, for meshes without grid structure
+    void buildAggregated(const std::vector<PointMass*>& vertices, const std::vector<Spring*>& springs,
+                         int maxLevels);
+    void clear();
+    // Drop the level 0 constraint of a torn spring between a and b. Coarse constraints
+    // whose geodesic ran across it get the rest length of the detour around the tear,
+    // level by level, or are disabled when there is no short detour. Returns false when
+    // a and b are not constrained together.
+    bool removeConstraint(const PointMass* a, const PointMass* b);
+
+    void solve(float dt, float maxStretch, int cycles, int smoothingIterations);
+
+    // Root mean square of the relative overstretch of the level 0 constraints
+    [[nodiscard]] float residual(float maxStretch) const;
+    [[nodiscard]] bool empty() const { return levels.empty(); }
+    [[nodiscard]] int levelCount() const { return (int)levels.size(); }
+    [[nodiscard]] size_t nodeCount(int level) const { return levels[level].mass.size(); }
+    // Share of the coarse constraints (levels above 0) disabled by removeConstraint
+    [[nodiscard]] float disabledFraction() const;
+
+private:
+    struct Level {
+        std::vector<int> constraintA, constraintB;
+        std::vector<float> restLengths;
+        std::vector<float> mass;
+        // Adjacency over this level's constraints, CSR
+        std::vector<int> adjacencyStart, adjacency;
+        std::vector<float> adjacencyRest;
+        std::vector<int> adjacencyConstraint;
+        // Node of the finer level each node stands for (unused on level 0), and the
+        // inverse: the coarser node each node stands for, or -1
+        std::vector<int> representative;
+        std::vector<int> coarseNode;
+        // Prolongation to this level from the next coarser one, CSR: node i receives
+        // the sum of prolongWeight[k] * correction[prolongIndex[k]]
+        std::vector<int> prolongStart, prolongIndex;
+        std::vector<float> prolongWeight;
+
+        // Solver state
+        std::vector<float> x, y, z, invMass;
+        std::vector<float> sx, sy, sz;  // positions on entry, for the coarse correction
+        std::vector<float> dx, dy, dz, count;
+    };
+
+    void initFineLevel(const std::vector<PointMass*>& vertices, const std::vector<Spring*>& springs);
+    static void buildAdjacency(Level& level);
+    [[nodiscard]] int vertexIndex(const PointMass* pm) const;
+    // FLT_MAX disables the constraint
+    static void setRestLength(Level& level, int c, float restLength);
+    // Shortest path lengths on a level from the sources, settled only up to limit; nodes
+    // left at FLT_MAX were not reached. distance must be all FLT_MAX on entry, and every
+    // node written is listed in visited for the caller to reset.
+    static void localDistances(const Level& level, const std::vector<int>& sources, float limit,
+                               std::vector<float>& distance, std::vector<int>& visited);
+    // Rest length of every coarse constraint from shortest paths on the finer level
+    static void geodesicRestLengths(const Level& fine, Level& coarse);
+    void vCycle(int level, float maxStretch, int smoothingIterations);
+    static void smooth(Level& level, float maxStretch, int iterations);
+
+    std::vector<PointMass*> vertices;
+    // Vertices sorted by address with their index, to look up the ends of torn springs
+    std::vector<std::pair<const PointMass*, int>> vertexOrder;
+    std::vector<Level> levels;
+    int disabledCoarseConstraints{0};
+};
+
+#endif //PBD_X_MULTIGRIDSOLVER_H
@@ -0,0 +1,220 @@
+#include "PickingBVH.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+constexpr int LEAF_CHUNKS = 2;
+
+float surfaceArea(const Vector3D& lo, const Vector3D& hi) {
+    Vector3D d = hi - lo;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+} // namespace
+
+void PickingBVH::clear() {
+    nodes.clear();
+    order.clear();
+    triangleStart.clear();
+    triangles.clear();
+    reach = 0.0f;
+    builtArea = 0.0f;
+    currentArea = 0.0f;
+}
+
+void PickingBVH::build(const std::vector<Vector3D>& chunkMin, const std::vector<Vector3D>& chunkMax,
+                       const std::vector<int>& surface, float triangleReach) {
+    clear();
+    const int count = (int)chunkMin.size();
+    if (count == 0) return;
+    reach = triangleReach;
+
+    std::vector<Vector3D> centers(count);
+    order.resize(count);
+    for (int c = 0; c < count; ++c) {
+        order[c] = c;
+        centers[c] = (chunkMin[c] + chunkMax[c]) * 0.5f;
+    }
+
+    // Bucket the triangles by the chunk of their first vertex
+    triangleStart.assign(count + 1, 0);
+    for (size_t t = 0; t + 2 < surface.size(); t += 3) {
+        triangleStart[surface[t] / CHUNK + 1]++;
+    }
+    for (int c = 0; c < count; ++c) {
+        triangleStart[c + 1] += triangleStart[c];
+    }
+    triangles.resize(triangleStart[count]);
+    std::vector<int> fill(triangleStart.begin(), triangleStart.end() - 1);
+    for (size_t t = 0; t + 2 < surface.size(); t += 3) {
+        triangles[fill[surface[t] / CHUNK]++] = (int)t;
+    }
+
+    nodes.reserve(2 * count / LEAF_CHUNKS + 1);
+    buildNode(0, count, centers);
+    refit(chunkMin, chunkMax);
+    builtArea = currentArea;
+}
+
+int PickingBVH::buildNode(int first, int count, const std::vector<Vector3D>& centers) {
+    int index = (int)nodes.size();
+    nodes.emplace_back();
+    if (count <= LEAF_CHUNKS) {
+        nodes[index].first = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // Median split along the longest axis of the chunk centers
+    Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int i = first; i < first + count; ++i) {
+        const Vector3D& c = centers[order[i]];
+        lo.x = std::min(lo.x, c.x); lo.y = std::min(lo.y, c.y); lo.z = std::min(lo.z, c.z);
+        hi.x = std::max(hi.x, c.x); hi.y = std::max(hi.y, c.y); hi.z = std::max(hi.z, c.z);
+    }
+    Vector3D extent = hi - lo;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto key = [&centers, axis](int c) {
+        const Vector3D& p = centers[c];
+        return axis == 0 ? p.x : (axis == 1 ? p.y : p.z);
+    };
+
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&key](int a, int b) { return key(a) < key(b); });
+
+    int left = buildNode(first, half, centers);
+    int right = buildNode(first + half, count - half, centers);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void PickingBVH::refit(const std::vector<Vector3D>& chunkMin, const std::vector<Vector3D>& chunkMax) {
+    // Children are created after their parent, so a backward sweep sees them first
+    const Vector3D pad(reach, reach, reach);
+    currentArea = 0.0f;
+    for (int n = (int)nodes.size() - 1; n >= 0; --n) {
+        Node& node = nodes[n];
+        Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        if (node.left < 0) {
+            for (int i = node.first; i < node.first + node.count; ++i) {
+                const Vector3D& cLo = chunkMin[order[i]];
+                const Vector3D& cHi = chunkMax[order[i]];
+                lo.x = std::min(lo.x, cLo.x); lo.y = std::min(lo.y, cLo.y); lo.z = std::min(lo.z, cLo.z);
+                hi.x = std::max(hi.x, cHi.x); hi.y = std::max(hi.y, cHi.y); hi.z = std::max(hi.z, cHi.z);
+            }
+            lo -= pad;
+            hi += pad;
+        } else {
+            const Node& l = nodes[node.left];
+            const Node& r = nodes[node.right];
+            lo = Vector3D(std::min(l.lo.x, r.lo.x), std::min(l.lo.y, r.lo.y), std::min(l.lo.z, r.lo.z));
+            hi = Vector3D(std::max(l.hi.x, r.hi.x), std::max(l.hi.y, r.hi.y), std::max(l.hi.z, r.hi.z));
+        }
+        node.lo = lo;
+        node.hi = hi;
+        currentArea += surfaceArea(lo, hi);
+    }
+}
+
+float PickingBVH::enter(const Vector3D& lo, const Vector3D& hi, const Vector3D& origin,
+                        const Vector3D& inverseDirection) {
+    // Slab test. Along an axis the ray is parallel to, the inverse is infinite and the
+    // slab distances infinite too, except for 0 * inf when the origin is on a face.
+    float t[6];
+    const float los[3] = {lo.x, lo.y, lo.z}, his[3] = {hi.x, hi.y, hi.z};
+    const float o[3] = {origin.x, origin.y, origin.z};
+    const float inv[3] = {inverseDirection.x, inverseDirection.y, inverseDirection.z};
+    for (int axis = 0; axis < 3; ++axis) {
+        float a = (los[axis] - o[axis]) * inv[axis];
+        float b = (his[axis] - o[axis]) * inv[axis];
+        if (std::isnan(a) || std::isnan(b)) {
+            a = -FLT_MAX;
+            b = FLT_MAX;
+        }
+        t[axis * 2] = std::min(a, b);
+        t[axis * 2 + 1] = std::max(a, b);
+    }
+    float near = std::max(std::max(t[0], t[2]), t[4]);
+    float far = std::min(std::min(t[1], t[3]), t[5]);
+    if (far < 0.0f || near > far) return FLT_MAX;
+    return std::max(near, 0.0f);
+}
+
+void PickingBVH::raycast(const std::vector<PointMass*>& particles, const std::vector<int>& surface,
+                         const Vector3D& origin, const Vector3D& direction, float radius, PickHit& hit) const {
+    if (nodes.empty()) return;
+    const Vector3D inverse(1.0f / direction.x, 1.0f / direction.y, 1.0f / direction.z);
+    const Vector3D pad(radius, radius, radius);
+    int stack[64];
+    int top = 0;
+    stack[top++] = 0;
+    while (top > 0) {
+        const Node& node = nodes[stack[--top]];
+        if (enter(node.lo - pad, node.hi + pad, origin, inverse) >= hit.distance) continue;
+        if (node.left < 0) {
+            pickLeaf(node, particles, surface, origin, direction, radius, hit);
+        } else if (top < 63) {
+            stack[top++] = node.left;
+            stack[top++] = node.right;
+        }
+    }
+}
+
+void PickingBVH::pickLeaf(const Node& node, const std::vector<PointMass*>& particles, const std::vector<int>& surface,
+                          const Vector3D& origin, const Vector3D& direction, float radius, PickHit& hit) const {
+    const float radiusSq = radius * radius;
+    for (int i = node.first; i < node.first + node.count; ++i) {
+        const int chunk = order[i];
+        const int end = std::min((int)particles.size(), (chunk + 1) * CHUNK);
+        for (int p = chunk * CHUNK; p < end; ++p) {
+            PointMass* pm = particles[p];
+            if (pm->isFixed()) continue;
+            Vector3D d = pm->getPosition() - origin;
+            float t = d.dot(direction);
+            if (t < 0.0f || t >= hit.distance || d.dot(d) - t * t > radiusSq) continue;
+            hit.pointMass = pm;
+            hit.distance = t;
+            hit.point = pm->getPosition();
+        }
+
+        for (int k = triangleStart[chunk]; k < triangleStart[chunk + 1]; ++k) {
+            const int* v = &surface[triangles[k]];
+            const Vector3D a = particles[v[0]]->getPosition();
+            const Vector3D e1 = particles[v[1]]->getPosition() - a;
+            const Vector3D e2 = particles[v[2]]->getPosition() - a;
+            // Moller-Trumbore
+            Vector3D p = direction.cross(e2);
+            float det = e1.dot(p);
+            if (std::fabs(det) < 1e-12f) continue;
+            float inverseDet = 1.0f / det;
+            Vector3D s = origin - a;
+            float u = s.dot(p) * inverseDet;
+            if (u < 0.0f || u > 1.0f) continue;
+            Vector3D q = s.cross(e1);
+            float w = direction.dot(q) * inverseDet;
+            if (w < 0.0f || u + w > 1.0f) continue;
+            float t = e2.dot(q) * inverseDet;
+            if (t < 0.0f || t >= hit.distance) continue;
+
+            Vector3D point = origin + direction * t;
+            PointMass* nearest = nullptr;
+            float best = FLT_MAX;
+            for (int corner = 0; corner < 3; ++corner) {
+                PointMass* pm = particles[v[corner]];
+                Vector3D offset = pm->getPosition() - point;
+                float distanceSq = offset.dot(offset);
+                if (!pm->isFixed() && distanceSq < best) {
+                    best = distanceSq;
+                    nearest = pm;
+                }
+            }
+            if (!nearest) continue;
+            hit.pointMass = nearest;
+            hit.distance = t;
+            hit.point = point;
+        }
+    }
+}
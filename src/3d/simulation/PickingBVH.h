@@ -0,0 +1,67 @@
+#ifndef PBD_X_PICKINGBVH_H
+#define PBD_X_PICKINGBVH_H
+
+#include <cfloat>
+#include <vector>
+#include "../core/PointMass.h"
+
+// Result of a pick: the particle to grab, how far along the ray it was found and
+// where. For a surface hit the point is on the triangle and the particle is its
+// nearest free vertex.
+struct PickHit {
+    PointMass* pointMass{nullptr};
+    float distance{FLT_MAX};
+    Vector3D point;
+};
+
+// Bounding volume hierarchy for ray picks on one island. Its leaves are runs of CHUNK
+// consecutive island particles, whose boxes the solver already refreshes every frame
+// with the island bounds, together with the surface triangles that start in them. The
+// tree is built once per island topology and refit from those boxes when queried, so
+// a pick reads only the particles and triangles of the leaves the ray passes through.
+class PickingBVH {
+public:
+    static constexpr int CHUNK = 32;
+
+    // surface holds triples of island-local particle indices; a triangle may reach up
+    // to reach beyond the box of the chunk holding its first vertex
+    void build(const std::vector<Vector3D>& chunkMin, const std::vector<Vector3D>& chunkMax,
+               const std::vector<int>& surface, float reach);
+    void refit(const std::vector<Vector3D>& chunkMin, const std::vector<Vector3D>& chunkMax);
+    void clear();
+
+    [[nodiscard]] bool empty() const { return nodes.empty(); }
+    [[nodiscard]] bool needsRebuild(float ratio = 2.0f) const { return builtArea > 0.0f && currentArea > ratio * builtArea; }
+    [[nodiscard]] size_t chunkCount() const { return order.size(); }
+
+    // Nearest hit along the unit ray that is closer than hit.distance: a free particle
+    // within radius of the ray, or a surface triangle the ray crosses
+    void raycast(const std::vector<PointMass*>& particles, const std::vector<int>& surface, const Vector3D& origin,
+                 const Vector3D& direction, float radius, PickHit& hit) const;
+
+    // Entry distance of the ray into [lo, hi], or FLT_MAX when it misses
+    [[nodiscard]] static float enter(const Vector3D& lo, const Vector3D& hi, const Vector3D& origin,
+                                     const Vector3D& inverseDirection);
+
+private:
+    struct Node {
+        Vector3D lo, hi;
+        int left{-1}, right{-1};  // children, or -1 for a leaf
+        int first{0}, count{0};   // leaf range in the chunk order
+    };
+
+    int buildNode(int first, int count, const std::vector<Vector3D>& centers);
+    void pickLeaf(const Node& node, const std::vector<PointMass*>& particles, const std::vector<int>& surface,
+                  const Vector3D& origin, const Vector3D& direction, float radius, PickHit& hit) const;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    // Surface triangles of each chunk, as offsets into the surface triples
+    std::vector<int> triangleStart;
+    std::vector<int> triangles;
+    float reach{0.0f};
+    float builtArea{0.0f};
+    float currentArea{0.0f};
+};
+
+#endif //PBD_X_PICKINGBVH_H
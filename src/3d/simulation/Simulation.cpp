@@ -1,5 +1,14 @@
 #include "Simulation.h"
+#include "../utils/MeshLoader.h"
 #include <iostream>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <new>
+#include <queue>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
 
 Simulation::Simulation() {
 }
@@ -9,67 +18,485 @@ Simulation::~Simulation() {
 }
 
 void Simulation::update(float dt) {
-    // Use sub-stepping to reduce penetration impulse magnitudes and improve stability
-    const float maxSubDt = 0.005f; // 5 ms
-    int steps = std::max(1, (int)std::ceil(dt / maxSubDt));
-    float subDt = dt / steps;
+    ensureIslands();
+    // Pins are usually set directly on point masses, bypassing setFixed(); they are
+    // only looked for when some point mass was pinned or unpinned since the last frame
+    const unsigned long long pinVersion = PointMass::getPinVersion();
+    const bool pinsTouched = pinVersion != seenPinVersion;
+    seenPinVersion = pinVersion;
+    if (longRangeAttachments) ensureTethers(pinsTouched);
+    if (strainLimiting) ensureStrainSolvers();
+    if (sleepingEnabled && pinsTouched) wakeRepinnedIslands();
+
+    // A change in the external load (e.g. wind toggled) invalidates every rest state
+    const bool loadChanged = (frameForce - lastFrameForce).magnitude() > 1e-6f;
+    if (loadChanged || forceFields.getVersion() != forceFieldVersion) {
+        wakeAll();
+    }
+    forceFieldVersion = forceFields.getVersion();
+    if (!kinematics.empty()) prepareKinematicTargets(dt);
+    // lastFrameForce is the load of this frame, applied in every substep
+    lastFrameForce = frameForce;
+    frameForce = Vector3D();
+
+    stepStats.substeps = 0;
+    stepStats.islandSubsteps = 0;
+    stepStats.smallestSubDt = 0.0f;
+    stepStats.largestSubDt = 0.0f;
+    stepStats.maxError = 0.0f;
+    stepStats.overToleranceSteps = 0;
+    stepStats.clampedVelocities = 0;
+    stepStats.tornSprings = 0;
+    stepStats.subDts.clear();
+    stepStats.diagnostics = Diagnostics();
+    stepStats.blowUp = false;
+
+    if (multirateStepping) {
+        updateMultirate(dt);
+    } else if (adaptiveStepping) {
+        updateAdaptive(dt);
+    } else {
+        // Use sub-stepping to reduce penetration impulse magnitudes and improve stability
+        int steps = std::max(1, (int)std::ceil(dt / fixedSubDt));
+        float subDt = dt / steps;
+
+        for (int s = 0; s < steps; ++s) {
+            substep(subDt, s == steps - 1, dt);
+        }
+    }
+
+    time += dt;
+    if (diagnosticsEnabled) gatherDiagnostics(loadChanged);
+
+    if (!sleepingEnabled) return;
+
+    wakeTouchedIslands();
+
+    for (Island& island : islands) {
+        if (island.sleeping || island.calmTime < sleepDelay) continue;
+        island.sleeping = true;
+        island.sleepPins.clear();
+        for (PointMass* pm : island.pointMasses) {
+            pm->setVelocity(Vector3D(0, 0, 0));
+            pm->clearAcceleration();
+            if (pm->isFixed()) island.sleepPins.push_back(pm);
+        }
+        Diagnostics& d = island.diagnostics;
+        d.kineticEnergy = d.momentumX = d.momentumY = d.momentumZ = 0.0;
+        d.maxSpeed = 0.0f;
+    }
+}
+
+void Simulation::gatherDiagnostics(bool loadChanged) {
+    // Island order, so the totals are the same however islands were stepped
+    Diagnostics& total = stepStats.diagnostics;
+    for (const Island& island : islands) total.add(island.diagnostics);
+
+    // The load potential can be negative below the floor height, hence the magnitude
+    const double energy = total.kineticEnergy + total.springEnergy + total.loadEnergy;
+    const bool finite = std::isfinite(energy) && std::isfinite(total.momentumX) && std::isfinite(total.momentumY) &&
+                        std::isfinite(total.momentumZ);
+    const bool grew = energy - lastTotalEnergy > (blowUpFactor - 1.0f) * std::fabs(lastTotalEnergy) &&
+                      energy > blowUpEnergyPerMass * total.freeMass;
+    stepStats.blowUp = !finite || (!loadChanged && grew);
+    lastTotalEnergy = finite ? energy : 0.0;
+}
+
+void Simulation::updateAdaptive(float dt) {
+    float remaining = dt;
+    while (remaining > 0.0f) {
+        float h = std::min(nextSubDt, stableSubDt());
+        h = std::max(h, minSubDt);
+        // Take the rest of the frame if it fits, and split evenly rather than leave a sliver
+        if (h >= remaining) {
+            h = remaining;
+        } else if (remaining - h < 0.25f * h) {
+            h = 0.5f * remaining;
+        }
+        remaining -= h;
+        const bool lastStep = remaining <= 0.0f;
+
+        substep(h, lastStep, dt);
+
+        // Grow or shrink the next step from the embedded error estimate; the step just
+        // taken stands either way
+        float error = 0.0f;
+        for (const Island& island : islands) {
+            if (!island.sleeping) error = std::max(error, island.stepError);
+        }
+        if (error > stepTolerance) stepStats.overToleranceSteps++;
+        float factor = (error > 0.0f) ? 0.9f * std::sqrt(stepTolerance / error) : 2.0f;
+        factor = std::max(0.3f, std::min(factor, 2.0f));
+        nextSubDt = std::max(minSubDt, std::min(h * factor, maxSubDt));
+        stepStats.maxError = std::max(stepStats.maxError, error);
+    }
+}
+
+float Simulation::stableSubDt() const {
+    float bound = maxSubDt;
+    for (const Island& island : islands) {
+        if (island.sleeping) continue;
+        bound = std::min(bound, islandStableSubDt(island));
+    }
+    return bound;
+}
+
+float Simulation::islandStableSubDt(const Island& island) const {
+    // CFL-style bound: no particle may travel more than a fraction of its shortest
+    // spring per substep. The oscillation bound keeps explicit springs stable.
+    float bound = maxSubDt;
+    if (island.maxSpeed > 1e-6f && island.minRestLength > 0.0f) {
+        bound = std::min(bound, courantNumber * island.minRestLength / island.maxSpeed);
+    }
+    if (island.maxStiffnessPerMass > 0.0f) {
+        bound = std::min(bound, courantNumber * 2.0f / std::sqrt(island.maxStiffnessPerMass));
+    }
+    return bound;
+}
+
+void Simulation::updateMultirate(float dt) {
+    // Each island picks its own substep count; islands whose bounds touch are coupled
+    // and advance together at the finer of their rates. All meet at the frame boundary.
+    const int n = (int)islands.size();
+    std::vector<int> group(n);
+    for (int i = 0; i < n; ++i) {
+        group[i] = i;
+        Island& island = islands[i];
+        float h = std::max(minSubDt, islandStableSubDt(island));
+        island.substeps = std::max(1, (int)std::ceil(dt / h));
+    }
+
+    auto find = [&group](int i) {
+        while (group[i] != i) {
+            group[i] = group[group[i]];
+            i = group[i];
+        }
+        return i;
+    };
+
+    // Only awake islands are coupled; the group's rate is taken after all unions
+    islandFlags.resize(n);
+    for (int i = 0; i < n; ++i) islandFlags[i] = !islands[i].sleeping;
+    findTouchingIslands(islandFlags, touchingIslands);
+    for (const auto& [i, j] : touchingIslands) {
+        if (!islandFlags[i] || !islandFlags[j]) continue;
+        int a = find(i);
+        int b = find(j);
+        if (a != b) group[b] = a;
+    }
+
+    // Islands run different substep counts, so collisions are swept over the whole frame
+    if (continuousCollision) collisions.beginStep(pointMasses);
+
+    std::vector<int> groupSubsteps(n, 0);
+    for (int i = 0; i < n; ++i) {
+        int root = find(i);
+        groupSubsteps[root] = std::max(groupSubsteps[root], islands[i].substeps);
+    }
+
+    for (int i = 0; i < n; ++i) {
+        Island& island = islands[i];
+        if (island.sleeping) continue;
+        int steps = groupSubsteps[find(i)];
+        island.substeps = steps;
+        float h = dt / steps;
+        for (int s = 0; s < steps; ++s) {
+            stepIsland(island, h, s == steps - 1, dt);
+        }
+
+        stepStats.islandSubsteps += steps;
+        if (steps > stepStats.substeps) stepStats.substeps = steps;
+        if (stepStats.smallestSubDt == 0.0f || h < stepStats.smallestSubDt) stepStats.smallestSubDt = h;
+        stepStats.largestSubDt = std::max(stepStats.largestSubDt, h);
+        stepStats.subDts.push_back(h);
+    }
+
+    if (continuousCollision) resolveCollisions(dt);
+}
+
+bool Simulation::boundsTouch(const Island& a, const Island& b) const {
+    return a.boundsMin.x - contactMargin <= b.boundsMax.x && a.boundsMax.x + contactMargin >= b.boundsMin.x &&
+           a.boundsMin.y - contactMargin <= b.boundsMax.y && a.boundsMax.y + contactMargin >= b.boundsMin.y &&
+           a.boundsMin.z - contactMargin <= b.boundsMax.z && a.boundsMax.z + contactMargin >= b.boundsMin.z;
+}
+
+void Simulation::findTouchingIslands(const std::vector<uint8_t>& moving, std::vector<std::pair<int, int>>& pairs) {
+    pairs.clear();
+    const int n = (int)islands.size();
+    sweepOrder.resize(n);
+    for (int i = 0; i < n; ++i) sweepOrder[i] = i;
+    std::sort(sweepOrder.begin(), sweepOrder.end(), [this](int a, int b) {
+        float ax = islands[a].boundsMin.x, bx = islands[b].boundsMin.x;
+        return ax < bx || (ax == bx && a < b);
+    });
+    // Islands starting past the end of this one along x, margin included, are out of
+    // reach, and so is every island after them in the sorted order
+    for (int k = 0; k < n; ++k) {
+        const int i = sweepOrder[k];
+        const float reach = islands[i].boundsMax.x + contactMargin;
+        for (int m = k + 1; m < n && islands[sweepOrder[m]].boundsMin.x <= reach; ++m) {
+            const int j = sweepOrder[m];
+            if (!moving[i] && !moving[j]) continue;
+            if (boundsTouch(islands[i], islands[j])) pairs.emplace_back(std::min(i, j), std::max(i, j));
+        }
+    }
+}
+
+void Simulation::substep(float subDt, bool lastStep, float frameDt) {
+    if (continuousCollision) collisions.beginStep(pointMasses);
+
+    for (Island& island : islands) {
+        if (island.sleeping) continue;
+        stepIsland(island, subDt, lastStep, frameDt);
+        stepStats.islandSubsteps++;
+    }
+
+    if (continuousCollision) resolveCollisions(subDt);
+
+    stepStats.substeps++;
+    stepStats.subDts.push_back(subDt);
+    if (stepStats.substeps == 1 || subDt < stepStats.smallestSubDt) stepStats.smallestSubDt = subDt;
+    stepStats.largestSubDt = std::max(stepStats.largestSubDt, subDt);
+}
+
+void Simulation::stepIsland(Island& island, float subDt, bool lastStep, float frameDt) {
     const float maxSpeed = 30.0f; // cap speed to avoid runaway
+    // The adaptive stepper resolves impacts by shrinking the step instead of clamping
+    const bool clampVelocities = !adaptiveStepping;
+
+    if (!island.kinematics.empty()) {
+        const double start = time + island.frameElapsed;
+        island.frameElapsed += subDt;
+        moveKinematicTargets(island.kinematics, kinematics.paths, (float)start, (float)(time + island.frameElapsed));
+    }
+
+    // External forces are evaluated every substep, since update() clears accelerations
+    forceFields.apply(island.pointMasses, island.surface, lastFrameForce, island.forceScratch);
+    if (grabbed && grabbed->getIslandId() == (int)(&island - islands.data())) {
+        Vector3D pull = (grabTarget - grabbed->getPosition()) * grabStiffness - grabbed->getVelocity() * grabDamping;
+        grabbed->applyForce(pull * grabbed->getMass());
+    }
 
-    for (int s = 0; s < steps; ++s) {
-        for (Spring* spring : springs) {
-            spring->applyForces();
+    // Diagnostics ride along with the last substep, like the sleep bookkeeping
+    const bool diagnose = diagnosticsEnabled && lastStep;
+    Diagnostics diagnostics;
+
+    for (size_t i = 0; i < island.springs.size(); ++i) {
+        Spring* spring = island.springs[i];
+        float length = spring->applyForces();
+        if (tearingEnabled && length > spring->getRestLength() * (1.0f + tearStrain)) {
+            tornSprings.push_back((int)i);
+        }
+        if (diagnose) {
+            float rest = spring->getRestLength();
+            float stretch = length - rest;
+            diagnostics.springEnergy += 0.5 * spring->getStiffness() * stretch * stretch;
+            if (rest > 0.0f) {
+                float strain = stretch / rest;
+                diagnostics.strainSum += std::fabs(strain);
+                diagnostics.maxStrain = std::max(diagnostics.maxStrain, strain);
+            }
         }
+    }
 
-        for (PointMass* pm : pointMasses) {
-            pm->update(subDt);
-
-            if (floorEnabled && !pm->isFixed()) {
-                auto pos = pm->getPosition();
-                if (pos.y < floorY) {
-                    // move slightly above floor to avoid penetration-driven spring explosions
-                    pos.y = floorY + 1e-4f;
-                    pm->setPosition(pos);
-                    auto vel = pm->getVelocity();
-                    vel.y = -vel.y * restitution;
-                    vel.x *= 0.9f;
-                    vel.z *= 0.9f;
-                    // clamp overall speed to avoid explosion from large impulses
-                    float speed = std::sqrt(vel.x*vel.x + vel.y*vel.y + vel.z*vel.z);
-                    if (speed > maxSpeed) {
-                        float sc = maxSpeed / speed;
-                        vel.x *= sc; vel.y *= sc; vel.z *= sc;
-                    }
-                    pm->setVelocity(vel);
+    // Remove torn springs back to front so the recorded island slots stay valid
+    for (auto it = tornSprings.rbegin(); it != tornSprings.rend(); ++it) {
+        Spring* spring = island.springs[*it];
+        island.springs[*it] = island.springs.back();
+        island.springs.pop_back();
+        removeSpring(island, spring);
+    }
+    tornSprings.clear();
+
+    float maxEnergy = 0.0f;
+    float maxSpeedSq = 0.0f;
+    float maxDeltaV = 0.0f;
+    // Bounds of the current chunk, closed every PickingBVH::CHUNK point masses
+    Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX);
+    Vector3D hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    Vector3D islandLo = lo;
+    Vector3D islandHi = hi;
+    const size_t count = island.pointMasses.size();
+
+    for (size_t i = 0; i < count; ++i) {
+        PointMass* pm = island.pointMasses[i];
+        Vector3D velBefore = pm->getVelocity();
+        if (diagnose && !pm->isFixed()) {
+            double m = pm->getMass();
+            Vector3D p = pm->getPosition();
+            diagnostics.kineticEnergy += 0.5 * m * velBefore.dot(velBefore);
+            diagnostics.loadEnergy -= (double)lastFrameForce.x * p.x + (double)lastFrameForce.y * (p.y - floorY) +
+                                      (double)lastFrameForce.z * p.z;
+            diagnostics.momentumX += m * velBefore.x;
+            diagnostics.momentumY += m * velBefore.y;
+            diagnostics.momentumZ += m * velBefore.z;
+            diagnostics.freeMass += m;
+        }
+        pm->update(subDt);
+
+        if (floorEnabled && !pm->isFixed()) {
+            auto pos = pm->getPosition();
+            if (pos.y < floorY) {
+                diagnostics.contacts++;
+                // move slightly above floor to avoid penetration-driven spring explosions
+                pos.y = floorY + 1e-4f;
+                pm->setPosition(pos);
+                auto vel = pm->getVelocity();
+                vel.y = -vel.y * restitution;
+                vel.x *= 0.9f;
+                vel.z *= 0.9f;
+                // clamp overall speed to avoid explosion from large impulses
+                float speed = std::sqrt(vel.x*vel.x + vel.y*vel.y + vel.z*vel.z);
+                if (clampVelocities && speed > maxSpeed) {
+                    float sc = maxSpeed / speed;
+                    vel.x *= sc; vel.y *= sc; vel.z *= sc;
+                    stepStats.clampedVelocities++;
                 }
+                pm->setVelocity(vel);
             }
+        }
+        if (!colliders.empty() && !pm->isFixed() && collideStatic(pm)) {
+            diagnostics.contacts++;
+        }
 
-            // Safety clamp on per-substep displacement produced by velocity
-            auto vel = pm->getVelocity();
-            float speed = std::sqrt(vel.x*vel.x + vel.y*vel.y + vel.z*vel.z);
-            float maxDisp = maxSpeed * subDt * 1.5f;
-            if (speed * subDt > maxDisp && speed > 1e-6f) {
-                float scale = (maxDisp / (speed * subDt));
-                vel.x *= scale; vel.y *= scale; vel.z *= scale;
-                pm->setVelocity(vel);
+        // Safety clamp on per-substep displacement produced by velocity
+        auto vel = pm->getVelocity();
+        float speedSq = vel.x*vel.x + vel.y*vel.y + vel.z*vel.z;
+        float speed = std::sqrt(speedSq);
+        float maxDisp = maxSpeed * subDt * 1.5f;
+        if (clampVelocities && speed * subDt > maxDisp && speed > 1e-6f) {
+            float scale = (maxDisp / (speed * subDt));
+            vel.x *= scale; vel.y *= scale; vel.z *= scale;
+            pm->setVelocity(vel);
+            speedSq *= scale * scale;
+            stepStats.clampedVelocities++;
+        }
+
+        maxSpeedSq = std::max(maxSpeedSq, speedSq);
+        maxDeltaV = std::max(maxDeltaV, (vel - velBefore).magnitude());
+
+        // Sleep bookkeeping rides along with the last substep
+        if (lastStep) {
+            maxEnergy = std::max(maxEnergy, 0.5f * speedSq);
+            auto pos = pm->getPosition();
+            lo.x = std::min(lo.x, pos.x); lo.y = std::min(lo.y, pos.y); lo.z = std::min(lo.z, pos.z);
+            hi.x = std::max(hi.x, pos.x); hi.y = std::max(hi.y, pos.y); hi.z = std::max(hi.z, pos.z);
+            if ((i + 1) % PickingBVH::CHUNK == 0 || i + 1 == count) {
+                island.chunkMin[i / PickingBVH::CHUNK] = lo;
+                island.chunkMax[i / PickingBVH::CHUNK] = hi;
+                islandLo.x = std::min(islandLo.x, lo.x); islandLo.y = std::min(islandLo.y, lo.y); islandLo.z = std::min(islandLo.z, lo.z);
+                islandHi.x = std::max(islandHi.x, hi.x); islandHi.y = std::max(islandHi.y, hi.y); islandHi.z = std::max(islandHi.z, hi.z);
+                lo = Vector3D(FLT_MAX, FLT_MAX, FLT_MAX);
+                hi = Vector3D(-FLT_MAX, -FLT_MAX, -FLT_MAX);
             }
         }
     }
+
+    if (!island.constraints.empty()) {
+        projectTriangleConstraints(island.constraints, subDt, areaStiffness, dihedralStiffness);
+    }
+    if (strainLimiting && !island.strainSolver.empty()) {
+        island.strainSolver.solve(subDt, maxStretch, solverCycles, smoothingIterations);
+    }
+    if (longRangeAttachments && !island.tethers.empty()) {
+        projectTethers(island);
+    }
+
+    island.maxSpeed = std::sqrt(maxSpeedSq);
+    if (diagnose) {
+        diagnostics.springs = (int)island.springs.size();
+        diagnostics.maxSpeed = island.maxSpeed;
+        island.diagnostics = diagnostics;
+    }
+    // Embedded estimate: symplectic Euler advances positions with v(n+1) while the
+    // trapezoidal rule would use the mean velocity; they differ by h/2 * |dv|.
+    island.stepError = 0.5f * subDt * maxDeltaV;
+
+    if (lastStep) {
+        island.boundsMin = islandLo;
+        island.boundsMax = islandHi;
+        if (sleepingEnabled) {
+            island.calmTime = (maxEnergy < sleepThreshold) ? island.calmTime + frameDt : 0.0f;
+        }
+    }
 }
 
 void Simulation::addPointMass(PointMass* pointMass) {
+    pointMassIds.push_back((int)pointMassSlots.size());
+    pointMassSlots.push_back((int)pointMasses.size());
     pointMasses.push_back(pointMass);
+    islandsDirty = true;
+    storageVersion++;
 }
 
 void Simulation::addSpring(Spring* spring) {
+    spring->setIndex((int)springs.size());
     springs.push_back(spring);
+    islandsDirty = true;
+}
+
+bool Simulation::collideStatic(PointMass* pm) {
+    // Same response as the floor: bounce the normal velocity, damp the tangential part
+    bool contact = false;
+    for (const Collider& collider : colliders) {
+        Vector3D pos = pm->getPosition();
+        Vector3D normal;
+        float depth;
+        if (collider.shape == Collider::Shape::Plane) {
+            normal = collider.normal;
+            depth = -(pos - collider.point).dot(normal);
+        } else {
+            Vector3D offset = pos - collider.point;
+            float distance = offset.magnitude();
+            if (distance >= collider.radius) continue;
+            normal = distance > 1e-6f ? offset / distance : Vector3D(0.0f, 1.0f, 0.0f);
+            depth = collider.radius - distance;
+        }
+        if (depth <= 0.0f) continue;
+
+        pm->setPosition(pos + normal * (depth + 1e-4f));
+        Vector3D vel = pm->getVelocity();
+        float vn = vel.dot(normal);
+        if (vn < 0.0f) {
+            Vector3D tangent = vel - normal * vn;
+            pm->setVelocity(tangent * 0.9f - normal * (vn * restitution));
+        }
+        contact = true;
+    }
+    return contact;
+}
+
+void Simulation::removeSpring(Island& island, Spring* spring) {
+    // Swap-remove from the flat store and detach from both endpoints; the island
+    // keeps its other members, so no solver structure is rebuilt mid-run
+    int slot = spring->getIndex();
+    springs[slot] = springs.back();
+    springs[slot]->setIndex(slot);
+    springs.pop_back();
+
+    spring->getPointMass1()->removeSpring(spring);
+    spring->getPointMass2()->removeSpring(spring);
+    stepStats.tornSprings++;
+    // The strain solver must not hold the torn spring together
+    island.strainSolver.removeConstraint(spring->getPointMass1(), spring->getPointMass2());
+    // Nor may a tether along a path through it, in the rest of this frame
+    if (longRangeAttachments) dropTethersThrough(island, spring->getPointMass1(), spring->getPointMass2());
+
+    if (tearListener) {
+        tearListener(spring->getPointMass1(), spring->getPointMass2());
+    }
+    delete spring;
 }
 
-void Simulation::createCloth(float startX, float startY, float startZ, int width, int height, float spacing) {
+void Simulation::createCloth(float startX, float startY, float startZ, int width, int height, float spacing,
+                             const Material& material) {
+    const int base = (int)pointMasses.size();
+    gridPatches.push_back({base, width, height});
     std::vector<std::vector<PointMass*>> grid(height, std::vector<PointMass*>(width));
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
-            PointMass* pm = new PointMass(1.0f, startX + x * spacing, startY + y * spacing, startZ);
+            PointMass* pm = new PointMass(material.mass, startX + x * spacing, startY + y * spacing, startZ);
 
             if (y == 0 && (x == 0 || x == width - 1)) {
                 pm->setFixed(true);
@@ -80,8 +507,8 @@ void Simulation::createCloth(float startX, float startY, float startZ, int width
         }
     }
 
-    float stiffness = 100.0f;
-    float damping = 1.0f;
+    const float stiffness = material.stiffness;
+    const float damping = material.damping;
 
     for (int y = 0; y < height; y++) {
         for (int x = 0; x < width; x++) {
@@ -93,25 +520,29 @@ void Simulation::createCloth(float startX, float startY, float startZ, int width
             }
 
             if (x < width - 1 && y < height - 1) {
-                addSpring(new Spring(grid[y][x], grid[y+1][x+1], stiffness * 0.3f, damping));
-                addSpring(new Spring(grid[y][x+1], grid[y+1][x], stiffness * 0.3f, damping));
+                addSpring(new Spring(grid[y][x], grid[y+1][x+1], material.shearStiffness, damping));
+                addSpring(new Spring(grid[y][x+1], grid[y+1][x], material.shearStiffness, damping));
+                // The air needs a surface; the springs stay the model of the cloth
+                int i00 = base + y * width + x, i10 = i00 + 1, i01 = i00 + width, i11 = i01 + 1;
+                surfaceTriangles.insert(surfaceTriangles.end(), {i00, i10, i11, i00, i11, i01});
             }
 
             if (x < width - 2) {
-                addSpring(new Spring(grid[y][x], grid[y][x+2], stiffness * 0.2f, damping));
+                addSpring(new Spring(grid[y][x], grid[y][x+2], material.bendStiffness, damping));
             }
             if (y < height - 2) {
-                addSpring(new Spring(grid[y][x], grid[y+2][x], stiffness * 0.2f, damping));
+                addSpring(new Spring(grid[y][x], grid[y+2][x], material.bendStiffness, damping));
             }
         }
     }
 }
 
-void Simulation::createRope(float startX, float startY, float startZ, int numPoints, float spacing) {
+void Simulation::createRope(float startX, float startY, float startZ, int numPoints, float spacing,
+                            const Material& material) {
     PointMass* prev = nullptr;
 
     for (int i = 0; i < numPoints; i++) {
-        PointMass* pm = new PointMass(1.0f, startX, startY + i * spacing, startZ);
+        PointMass* pm = new PointMass(material.mass, startX, startY + i * spacing, startZ);
 
         if (i == 0) {
             pm->setFixed(true);
@@ -120,28 +551,777 @@ void Simulation::createRope(float startX, float startY, float startZ, int numPoi
         addPointMass(pm);
 
         if (prev != nullptr) {
-            addSpring(new Spring(prev, pm, 200.0f, 2.0f));
+            addSpring(new Spring(prev, pm, material.stiffness, material.damping));
         }
 
         prev = pm;
     }
 }
 
-void Simulation::clear() {
+void Simulation::createMesh(const MeshData& mesh, float startX, float startY, float startZ, float scale,
+                            bool triangleModel, const Material& material) {
+    const int base = (int)pointMasses.size();
+    const int vertices = mesh.vertexCount();
+    pointMasses.reserve(pointMasses.size() + vertices);
+    springs.reserve(springs.size() + (mesh.edges.size() + mesh.bendEdges.size()) / 2);
+    triangles.reserve(triangles.size() + mesh.triangles.size());
+
+    for (int i = 0; i < vertices; i++) {
+        addPointMass(new PointMass(material.mass,
+                                   startX + mesh.positions[i * 3] * scale,
+                                   startY + mesh.positions[i * 3 + 1] * scale,
+                                   startZ + mesh.positions[i * 3 + 2] * scale));
+    }
+
+    const float stiffness = material.stiffness;
+    const float bendStiffness = material.bendStiffness;
+    const float damping = material.damping;
+
+    for (size_t e = 0; e + 1 < mesh.edges.size(); e += 2) {
+        addSpring(new Spring(pointMasses[base + mesh.edges[e]], pointMasses[base + mesh.edges[e + 1]], stiffness, damping));
+    }
+    for (int index : mesh.triangles) {
+        triangles.push_back(base + index);
+        surfaceTriangles.push_back(base + index);
+    }
+
+    if (!triangleModel) {
+        for (size_t e = 0; e + 1 < mesh.bendEdges.size(); e += 2) {
+            addSpring(new Spring(pointMasses[base + mesh.bendEdges[e]], pointMasses[base + mesh.bendEdges[e + 1]], bendStiffness, damping));
+        }
+        return;
+    }
+
+    for (size_t t = 0; t + 2 < mesh.triangles.size(); t += 3) {
+        triangleConstraints.addTriangle(pointMasses, base + mesh.triangles[t], base + mesh.triangles[t + 1], base + mesh.triangles[t + 2]);
+    }
+    for (size_t h = 0; h + 3 < mesh.hinges.size(); h += 4) {
+        triangleConstraints.addHinge(pointMasses, base + mesh.hinges[h], base + mesh.hinges[h + 1],
+                                     base + mesh.hinges[h + 2], base + mesh.hinges[h + 3]);
+    }
+    islandsDirty = true;
+}
+
+void Simulation::createTriangleCloth(float startX, float startY, float startZ, int width, int height, float spacing,
+                                     const Material& material) {
+    MeshData mesh;
+    mesh.positions.reserve(width * height * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            mesh.positions.push_back(x * spacing);
+            mesh.positions.push_back(y * spacing);
+            mesh.positions.push_back(0.0f);
+        }
+    }
+
+    // Alternate the diagonal so the cloth has no preferred folding direction
+    for (int y = 0; y < height - 1; y++) {
+        for (int x = 0; x < width - 1; x++) {
+            int i00 = y * width + x, i10 = i00 + 1, i01 = i00 + width, i11 = i01 + 1;
+            if ((x + y) % 2 == 0) {
+                mesh.triangles.insert(mesh.triangles.end(), {i00, i10, i11, i00, i11, i01});
+            } else {
+                mesh.triangles.insert(mesh.triangles.end(), {i00, i10, i01, i10, i11, i01});
+            }
+        }
+    }
+    MeshLoader::buildEdges(mesh);
+
+    const int base = (int)pointMasses.size();
+    createMesh(mesh, startX, startY, startZ, 1.0f, true, material);
+    gridPatches.push_back({base, width, height});
+
+    if (width > 0 && height > 0) {
+        pointMasses[base]->setFixed(true);
+        pointMasses[base + width - 1]->setFixed(true);
+    }
+}
+
+void Simulation::reserve(size_t pointMassCount, size_t springCount) {
+    pointMasses.reserve(pointMasses.size() + pointMassCount);
+    pointMassIds.reserve(pointMassIds.size() + pointMassCount);
+    pointMassSlots.reserve(pointMassSlots.size() + pointMassCount);
+    springs.reserve(springs.size() + springCount);
+}
+
+void Simulation::reorderSpatially(SpaceFillingCurve curve) {
+    const int n = (int)pointMasses.size();
+    if (n < 2) return;
+
+    std::vector<Vector3D> positions(n);
+    for (int i = 0; i < n; ++i) {
+        positions[i] = pointMasses[i]->getPosition();
+    }
+    relocatePointMasses(SpaceFilling::order(positions, curve), true);
+}
+
+void Simulation::packPointMasses() {
+    if (isPacked()) return;
+    std::vector<int> order(pointMasses.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = (int)i;
+    relocatePointMasses(order, false);
+}
+
+void Simulation::relocatePointMasses(const std::vector<int>& order, bool sortTopology) {
+    const int n = (int)pointMasses.size();
+    std::vector<int> slotOf(n);
+    for (int k = 0; k < n; ++k) {
+        slotOf[order[k]] = k;
+    }
+
+    // Build every replacement in one new block before freeing anything, so they sit
+    // in the new order in contiguous memory
+    auto* block = static_cast<PointMass*>(::operator new(sizeof(PointMass) * std::max(n, 1)));
+    std::vector<PointMass*> relocated(n);
+    std::vector<int> ids(n);
+    for (int k = 0; k < n; ++k) {
+        const PointMass* old = pointMasses[order[k]];
+        Vector3D p = old->getPosition();
+        PointMass* pm = new (block + k) PointMass(old->getMass(), p.x, p.y, p.z);
+        pm->setVelocity(old->getVelocity());
+        pm->applyForce(old->getAcceleration() * old->getMass());
+        pm->setFixed(old->isFixed());
+        relocated[k] = pm;
+        ids[k] = pointMassIds[order[k]];
+        pointMassSlots[ids[k]] = k;
+    }
+
+    // Springs sorted by their lower endpoint, keeping each spring's orientation
+    std::unordered_map<const PointMass*, int> oldSlot;
+    oldSlot.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        oldSlot[pointMasses[i]] = i;
+    }
+    struct Edge {
+        int a, b;
+        const Spring* spring;
+    };
+    std::vector<Edge> edges;
+    edges.reserve(springs.size());
+    for (const Spring* spring : springs) {
+        edges.push_back({slotOf[oldSlot[spring->getPointMass1()]], slotOf[oldSlot[spring->getPointMass2()]], spring});
+    }
+    if (sortTopology) {
+        std::stable_sort(edges.begin(), edges.end(), [](const Edge& x, const Edge& y) {
+            return std::make_pair(std::min(x.a, x.b), std::max(x.a, x.b)) < std::make_pair(std::min(y.a, y.b), std::max(y.a, y.b));
+        });
+    }
+    std::vector<Spring*> rebuilt;
+    rebuilt.reserve(edges.size());
+    for (const Edge& e : edges) {
+        rebuilt.push_back(new Spring(relocated[e.a], relocated[e.b], e.spring->getStiffness(), e.spring->getDamping(),
+                                     e.spring->getRestLength()));
+    }
+
+    for (Spring* spring : springs) delete spring;
+    releasePointMasses();
+    pointMassBlock = block;
+    pointMassBlockSize = n;
+    pointMasses = std::move(relocated);
+    pointMassIds = std::move(ids);
+    springs.clear();
+    for (Spring* spring : rebuilt) addSpring(spring);
+
+    // Triangles and constraints follow their lowest vertex; the rest data moves along
+    auto sortGroups = [&slotOf, sortTopology](std::vector<int>& vertices, int size, std::vector<float>* rest) {
+        const int groups = (int)vertices.size() / size;
+        for (int& v : vertices) v = slotOf[v];
+        if (!sortTopology) return;
+        std::vector<int> perm(groups);
+        std::vector<int> lowest(groups);
+        for (int g = 0; g < groups; ++g) {
+            perm[g] = g;
+            lowest[g] = *std::min_element(vertices.begin() + g * size, vertices.begin() + (g + 1) * size);
+        }
+        std::stable_sort(perm.begin(), perm.end(), [&lowest](int x, int y) { return lowest[x] < lowest[y]; });
+        std::vector<int> sorted;
+        sorted.reserve(vertices.size());
+        std::vector<float> sortedRest;
+        for (int g : perm) {
+            sorted.insert(sorted.end(), vertices.begin() + g * size, vertices.begin() + (g + 1) * size);
+            if (rest) sortedRest.push_back((*rest)[g]);
+        }
+        vertices = std::move(sorted);
+        if (rest) *rest = std::move(sortedRest);
+    };
+    sortGroups(triangles, 3, nullptr);
+    sortGroups(surfaceTriangles, 3, nullptr);
+    sortGroups(triangleConstraints.areaVertices, 3, &triangleConstraints.restAreas);
+    sortGroups(triangleConstraints.bendVertices, 4, &triangleConstraints.restAngles);
+
+    // Everything holding point mass pointers is rebuilt lazily
+    tetherAnchors.clear();
+    grabbed = nullptr;
+    islands.clear();
+    islandsDirty = true;
+    storageVersion++;
+}
+
+void Simulation::releasePointMasses() {
+    // Members of the packed block are destroyed in place and freed with it
     for (PointMass* pm : pointMasses) {
-        delete pm;
+        if (pm >= pointMassBlock && pm < pointMassBlock + pointMassBlockSize) {
+            pm->~PointMass();
+        } else {
+            delete pm;
+        }
     }
+    ::operator delete(pointMassBlock);
+    pointMassBlock = nullptr;
+    pointMassBlockSize = 0;
+}
+
+void Simulation::clear() {
+    releasePointMasses();
     for (Spring* spring : springs) {
         delete spring;
     }
     pointMasses.clear();
+    pointMassIds.clear();
+    pointMassSlots.clear();
     springs.clear();
+    triangles.clear();
+    surfaceTriangles.clear();
+    triangleConstraints.clear();
+    gridPatches.clear();
+    colliders.clear();
+    forceFields.clear();
+    kinematics.clear();
+    time = 0.0;
+    grabbed = nullptr;
+    islands.clear();
+    islandsDirty = true;
+    // The anchors point at the freed point masses
+    tetherAnchors.clear();
+    pinnedScratch.clear();
+    tethersDirty = true;
+    storageVersion++;
+}
+
+void Simulation::resetSettings() {
+    const Simulation defaults;
+    areaStiffness = defaults.areaStiffness;
+    dihedralStiffness = defaults.dihedralStiffness;
+    floorEnabled = defaults.floorEnabled;
+    floorY = defaults.floorY;
+    restitution = defaults.restitution;
+    fixedSubDt = defaults.fixedSubDt;
+    setSleepingEnabled(defaults.sleepingEnabled);
+    sleepThreshold = defaults.sleepThreshold;
+    sleepDelay = defaults.sleepDelay;
+    adaptiveStepping = defaults.adaptiveStepping;
+    multirateStepping = defaults.multirateStepping;
+    stepTolerance = defaults.stepTolerance;
+    courantNumber = defaults.courantNumber;
+    minSubDt = defaults.minSubDt;
+    maxSubDt = defaults.maxSubDt;
+    nextSubDt = defaults.nextSubDt;
+    tearingEnabled = defaults.tearingEnabled;
+    tearStrain = defaults.tearStrain;
+    longRangeAttachments = defaults.longRangeAttachments;
+    tetherSlack = defaults.tetherSlack;
+    tethersDirty = true;
+    strainLimiting = defaults.strainLimiting;
+    multigrid = defaults.multigrid;
+    maxStretch = defaults.maxStretch;
+    solverCycles = defaults.solverCycles;
+    smoothingIterations = defaults.smoothingIterations;
+    strainSolversDirty = true;
+    continuousCollision = defaults.continuousCollision;
+    collisions.setThickness(defaults.collisions.getThickness());
 }
 
 void Simulation::applyGlobalForce(const Vector3D& force) {
-    for (PointMass* pm : pointMasses) {
-        if (!pm->isFixed()) {
-            pm->applyForce(force);
+    frameForce += force;
+}
+
+void Simulation::setFixed(PointMass* pointMass, bool fixed) {
+    pointMass->setFixed(fixed);
+    // What the springs added while it was pinned was never integrated
+    if (!fixed) pointMass->clearAcceleration();
+    ensureIslands();
+    int id = pointMass->getIslandId();
+    if (id >= 0 && id < (int)islands.size()) {
+        wakeIsland(islands[id]);
+    }
+}
+
+int Simulation::addKinematicPath(const KinematicPath& path) {
+    if (!path.isValid()) {
+        throw std::runtime_error("A kinematic path needs a script or one position per key at increasing times");
+    }
+    kinematics.paths.push_back(path);
+    return (int)kinematics.paths.size() - 1;
+}
+
+void Simulation::setKinematicPath(int path, const KinematicPath& replacement) {
+    if (path < 0 || path >= (int)kinematics.paths.size()) {
+        throw std::out_of_range("No kinematic path " + std::to_string(path));
+    }
+    if (!replacement.isValid()) {
+        throw std::runtime_error("A kinematic path needs a script or one position per key at increasing times");
+    }
+    // The islands it drives follow, waking if asleep, from the next update
+    kinematics.paths[path] = replacement;
+}
+
+void Simulation::attachToPath(int pointMassId, int path) {
+    if (path < 0 || path >= (int)kinematics.paths.size()) {
+        throw std::out_of_range("No kinematic path " + std::to_string(path));
+    }
+    if (pointMassId < 0 || pointMassId >= (int)pointMassSlots.size()) {
+        throw std::out_of_range("No point mass with id " + std::to_string(pointMassId));
+    }
+    ensureIslands();
+    PointMass* pm = getPointMassById(pointMassId);
+    Vector3D offset = pm->getPosition() - kinematics.paths[path].evaluate((float)time);
+    kinematics.set(pointMassId, path, offset);
+    pm->setFixed(true);
+    // Only the particle's own island carries the target
+    Island& island = islands[pm->getIslandId()];
+    island.kinematics.remove(pm);
+    island.kinematics.add(pm, path, offset);
+    wakeIsland(island);
+}
+
+void Simulation::detachFromPath(int pointMassId) {
+    if (!kinematics.remove(pointMassId)) return;
+    ensureIslands();
+    // Springs keep adding to a pinned particle's acceleration, which is never integrated
+    PointMass* pm = getPointMassById(pointMassId);
+    pm->setFixed(false);
+    pm->clearAcceleration();
+    Island& island = islands[pm->getIslandId()];
+    island.kinematics.remove(pm);
+    wakeIsland(island);
+}
+
+PickHit Simulation::pick(const Vector3D& origin, const Vector3D& direction, float radius) {
+    ensureIslands();
+    PickHit hit;
+    const float length = direction.magnitude();
+    if (length <= 0.0f) return hit;
+    const Vector3D dir = direction / length;
+    const Vector3D inverse(1.0f / dir.x, 1.0f / dir.y, 1.0f / dir.z);
+
+    for (Island& island : islands) {
+        // A surface triangle reaches at most an edge beyond its first vertex's chunk;
+        // edges are allowed to stretch to twice their rest length
+        const float reach = island.surface.empty() ? 0.0f : 2.0f * island.maxRestLength;
+        const Vector3D pad(radius + reach, radius + reach, radius + reach);
+        if (PickingBVH::enter(island.boundsMin - pad, island.boundsMax + pad, origin, inverse) >= hit.distance) continue;
+
+        // Chunks drift apart as the body deforms; rebuild once refitting has doubled the boxes
+        PickingBVH& tree = island.pickTree;
+        if (!tree.empty()) tree.refit(island.chunkMin, island.chunkMax);
+        if (tree.empty() || tree.needsRebuild()) tree.build(island.chunkMin, island.chunkMax, island.surface, reach);
+        tree.raycast(island.pointMasses, island.surface, origin, dir, radius, hit);
+    }
+    return hit;
+}
+
+void Simulation::grab(PointMass* pointMass, const Vector3D& target) {
+    grabbed = pointMass;
+    setGrabTarget(target);
+}
+
+void Simulation::setGrabTarget(const Vector3D& target) {
+    grabTarget = target;
+    if (!grabbed) return;
+    ensureIslands();
+    int id = grabbed->getIslandId();
+    if (id >= 0 && id < (int)islands.size()) wakeIsland(islands[id]);
+}
+
+void Simulation::setSleepingEnabled(bool enabled) {
+    sleepingEnabled = enabled;
+    if (!enabled) wakeAll();
+}
+
+void Simulation::wakeAll() {
+    for (Island& island : islands) {
+        wakeIsland(island);
+    }
+}
+
+const std::vector<Island>& Simulation::getIslands() {
+    ensureIslands();
+    return islands;
+}
+
+int Simulation::getAwakeIslandCount() {
+    ensureIslands();
+    int count = 0;
+    for (const Island& island : islands) {
+        if (!island.sleeping) count++;
+    }
+    return count;
+}
+
+void Simulation::ensureIslands() {
+    if (islandsDirty) {
+        rebuildIslands();
+        islandsDirty = false;
+    }
+}
+
+void Simulation::rebuildIslands() {
+    // Topology changed; the collision tree is rebuilt on its next use and the
+    // tethers and strain solvers, which live in the islands, are recomputed
+    collisions.invalidate();
+    tethersDirty = true;
+    strainSolversDirty = true;
+
+    // Union-find over the spring graph, using the island id as scratch index storage
+    const int n = (int)pointMasses.size();
+    std::vector<int> parent(n);
+    for (int i = 0; i < n; ++i) {
+        parent[i] = i;
+        pointMasses[i]->setIslandId(i);
+    }
+
+    auto find = [&parent](int i) {
+        while (parent[i] != i) {
+            parent[i] = parent[parent[i]];
+            i = parent[i];
+        }
+        return i;
+    };
+
+    for (Spring* spring : springs) {
+        int a = find(spring->getPointMass1()->getIslandId());
+        int b = find(spring->getPointMass2()->getIslandId());
+        if (a != b) parent[b] = a;
+    }
+
+    // Map each root to a dense island index; islands start awake
+    std::vector<int> rootToIsland(n, -1);
+    islands.clear();
+    for (int i = 0; i < n; ++i) {
+        int root = find(i);
+        if (rootToIsland[root] < 0) {
+            rootToIsland[root] = (int)islands.size();
+            islands.emplace_back();
+        }
+        parent[i] = root;
+    }
+
+    // parent[] becomes each point mass's index within its island
+    for (int i = 0; i < n; ++i) {
+        int id = rootToIsland[parent[i]];
+        pointMasses[i]->setIslandId(id);
+        parent[i] = (int)islands[id].pointMasses.size();
+        islands[id].pointMasses.push_back(pointMasses[i]);
+    }
+
+    // Triangles torn apart into different islands no longer form a surface
+    for (size_t t = 0; t + 2 < surfaceTriangles.size(); t += 3) {
+        const int id = pointMasses[surfaceTriangles[t]]->getIslandId();
+        if (pointMasses[surfaceTriangles[t + 1]]->getIslandId() != id ||
+            pointMasses[surfaceTriangles[t + 2]]->getIslandId() != id) {
+            continue;
+        }
+        for (int k = 0; k < 3; ++k) {
+            islands[id].surface.push_back(parent[surfaceTriangles[t + k]]);
+        }
+    }
+
+    for (Spring* spring : springs) {
+        Island& island = islands[spring->getPointMass1()->getIslandId()];
+        island.springs.push_back(spring);
+        if (island.minRestLength <= 0.0f || spring->getRestLength() < island.minRestLength) {
+            island.minRestLength = spring->getRestLength();
+        }
+        island.maxRestLength = std::max(island.maxRestLength, spring->getRestLength());
+    }
+
+    // Split the triangle constraints per island, renumbered to island-local vertices
+    std::vector<int> localIndex(n, -1);
+    auto local = [&](int vertex) {
+        Island& island = islands[pointMasses[vertex]->getIslandId()];
+        if (localIndex[vertex] < 0) {
+            localIndex[vertex] = (int)island.constraints.vertices.size();
+            island.constraints.vertices.push_back(pointMasses[vertex]);
+        }
+        return localIndex[vertex];
+    };
+    const TriangleConstraints& tc = triangleConstraints;
+    for (size_t t = 0; t < tc.restAreas.size(); ++t) {
+        ConstraintBatch& batch = islands[pointMasses[tc.areaVertices[t * 3]]->getIslandId()].constraints;
+        batch.areaA.push_back(local(tc.areaVertices[t * 3]));
+        batch.areaB.push_back(local(tc.areaVertices[t * 3 + 1]));
+        batch.areaC.push_back(local(tc.areaVertices[t * 3 + 2]));
+        batch.restAreas.push_back(tc.restAreas[t]);
+    }
+    for (size_t h = 0; h < tc.restAngles.size(); ++h) {
+        ConstraintBatch& batch = islands[pointMasses[tc.bendVertices[h * 4]]->getIslandId()].constraints;
+        batch.bendA.push_back(local(tc.bendVertices[h * 4]));
+        batch.bendB.push_back(local(tc.bendVertices[h * 4 + 1]));
+        batch.bendC.push_back(local(tc.bendVertices[h * 4 + 2]));
+        batch.bendD.push_back(local(tc.bendVertices[h * 4 + 3]));
+        batch.restAngles.push_back(tc.restAngles[h]);
+    }
+
+    // Stiffest node per island: sum of attached spring stiffness over its mass
+    for (Island& island : islands) {
+        for (PointMass* pm : island.pointMasses) {
+            float k = 0.0f;
+            for (Spring* spring : pm->getSprings()) {
+                k += spring->getStiffness();
+            }
+            island.maxStiffnessPerMass = std::max(island.maxStiffnessPerMass, k / pm->getMass());
+        }
+    }
+
+    // Kinematic targets go to the island of their particle, with the paths it uses
+    // numbered per island
+    for (size_t t = 0; t < kinematics.ids.size(); ++t) {
+        PointMass* pm = pointMasses[pointMassSlots[kinematics.ids[t]]];
+        KinematicBatch& batch = islands[pm->getIslandId()].kinematics;
+        batch.add(pm, kinematics.pathIndices[t], kinematics.offsets[t]);
+    }
+
+    for (Island& island : islands) {
+        const size_t count = island.pointMasses.size();
+        const size_t chunks = (count + PickingBVH::CHUNK - 1) / PickingBVH::CHUNK;
+        island.chunkMin.assign(chunks, Vector3D(FLT_MAX, FLT_MAX, FLT_MAX));
+        island.chunkMax.assign(chunks, Vector3D(-FLT_MAX, -FLT_MAX, -FLT_MAX));
+        Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX);
+        Vector3D hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (size_t i = 0; i < count; ++i) {
+            auto pos = island.pointMasses[i]->getPosition();
+            Vector3D& cLo = island.chunkMin[i / PickingBVH::CHUNK];
+            Vector3D& cHi = island.chunkMax[i / PickingBVH::CHUNK];
+            cLo.x = std::min(cLo.x, pos.x); cLo.y = std::min(cLo.y, pos.y); cLo.z = std::min(cLo.z, pos.z);
+            cHi.x = std::max(cHi.x, pos.x); cHi.y = std::max(cHi.y, pos.y); cHi.z = std::max(cHi.z, pos.z);
+            lo.x = std::min(lo.x, pos.x); lo.y = std::min(lo.y, pos.y); lo.z = std::min(lo.z, pos.z);
+            hi.x = std::max(hi.x, pos.x); hi.y = std::max(hi.y, pos.y); hi.z = std::max(hi.z, pos.z);
+        }
+        island.boundsMin = lo;
+        island.boundsMax = hi;
+    }
+}
+
+void Simulation::resolveCollisions(float dt) {
+    // Spring cloths have no triangles of their own, so the air's surface is swept: it
+    // holds every triangle plus a triangulation of each spring cloth
+    // Sleeping islands are swept only while an awake one is near enough to reach them
+    islandFlags.resize(islands.size());
+    for (size_t i = 0; i < islands.size(); ++i) islandFlags[i] = !islands[i].sleeping;
+    findTouchingIslands(islandFlags, touchingIslands);
+    for (const auto& pair : touchingIslands) islandFlags[pair.first] = islandFlags[pair.second] = 1;
+    collisions.resolve(pointMasses, surfaceTriangles, dt, islandFlags);
+    for (PointMass* pm : collisions.getTouched()) {
+        // The floor is a half-space, so clamping in the integration loop cannot be
+        // tunneled through; only a contact push can leave a point below it
+        if (floorEnabled && !pm->isFixed() && pm->getPosition().y < floorY) {
+            Vector3D pos = pm->getPosition();
+            pos.y = floorY + 1e-4f;
+            pm->setPosition(pos);
+        }
+        // A contact pushed into a sleeping island has to wake it
+        int id = pm->getIslandId();
+        if (id >= 0 && id < (int)islands.size() && islands[id].sleeping) wakeIsland(islands[id]);
+    }
+}
+
+void Simulation::ensureTethers(bool pinsTouched) {
+    bool pinsChanged = false;
+    if (tethersDirty || pinsTouched) {
+        pinnedScratch.clear();
+        for (PointMass* pm : pointMasses) {
+            if (pm->isFixed()) pinnedScratch.push_back(pm);
+        }
+        pinsChanged = pinnedScratch != tetherAnchors;
+    }
+    if (pinsChanged) {
+        // A pin that came or went bypassing setFixed() still has to wake its island
+        for (const auto* pins : {&tetherAnchors, &pinnedScratch}) {
+            for (PointMass* pm : *pins) {
+                int id = pm->getIslandId();
+                if (id >= 0 && id < (int)islands.size() && islands[id].sleeping) wakeIsland(islands[id]);
+            }
+        }
+    }
+    if (tethersDirty || pinsChanged) {
+        tetherAnchors.swap(pinnedScratch);
+        rebuildTethers();
+        tethersDirty = false;
+        return;
+    }
+    // Geodesic distances grew where springs tore during the last frame
+    for (Island& island : islands) {
+        if (island.tethersStale) rebuildTethers(island);
+    }
+}
+
+void Simulation::ensureStrainSolvers() {
+    if (!strainSolversDirty) return;
+    strainSolversDirty = false;
+    const int maxLevels = multigrid ? 16 : 1;
+
+    // Islands that are exactly one cloth grid get the geometric hierarchy
+    std::vector<bool> built(islands.size(), false);
+    for (const GridPatch& patch : gridPatches) {
+        const int count = patch.width * patch.height;
+        if (count == 0 || patch.first + count > (int)pointMassSlots.size()) continue;
+        const int id = getPointMassById(patch.first)->getIslandId();
+        if (id < 0 || built[id] || (int)islands[id].pointMasses.size() != count) continue;
+        std::vector<PointMass*> grid(count);
+        for (int k = 0; k < count; ++k) {
+            grid[k] = getPointMassById(patch.first + k);
+        }
+        if (!std::all_of(grid.begin(), grid.end(), [id](PointMass* pm) { return pm->getIslandId() == id; })) continue;
+        islands[id].strainSolver.buildGrid(grid, islands[id].springs, patch.width, patch.height, maxLevels);
+        built[id] = true;
+    }
+
+    for (size_t i = 0; i < islands.size(); ++i) {
+        Island& island = islands[i];
+        if (built[i]) continue;
+        if (island.springs.empty()) {
+            island.strainSolver.clear();
+        } else {
+            island.strainSolver.buildAggregated(island.pointMasses, island.springs, maxLevels);
         }
     }
 }
+
+void Simulation::rebuildTethers() {
+    // Springs never cross islands, so each island's tethers are independent
+    for (Island& island : islands) {
+        rebuildTethers(island);
+    }
+}
+
+void Simulation::rebuildTethers(Island& island) {
+    // Multi-source Dijkstra from the island's pinned particles over its spring graph,
+    // weighted by rest length; each particle remembers which pin reached it first
+    const std::vector<PointMass*>& members = island.pointMasses;
+    const int n = (int)members.size();
+    std::unordered_map<PointMass*, int> index;
+    index.reserve(n);
+    for (int i = 0; i < n; ++i) {
+        index[members[i]] = i;
+    }
+
+    std::vector<float> distance(n, FLT_MAX);
+    std::vector<int> anchor(n, -1);
+    std::vector<int> previous(n, -1);
+    // Particles as Dijkstra settles them, so every path is listed after its prefix
+    std::vector<int> settled;
+    settled.reserve(n);
+    using Entry = std::pair<float, int>;
+    std::priority_queue<Entry, std::vector<Entry>, std::greater<Entry>> queue;
+    for (int i = 0; i < n; ++i) {
+        if (!members[i]->isFixed()) continue;
+        distance[i] = 0.0f;
+        anchor[i] = i;
+        queue.emplace(0.0f, i);
+    }
+
+    while (!queue.empty()) {
+        auto [d, i] = queue.top();
+        queue.pop();
+        if (d > distance[i]) continue;
+        settled.push_back(i);
+        PointMass* pm = members[i];
+        for (Spring* spring : pm->getSprings()) {
+            PointMass* other = spring->getPointMass1() == pm ? spring->getPointMass2() : spring->getPointMass1();
+            auto found = index.find(other);
+            if (found == index.end()) continue;
+            int j = found->second;
+            float nd = d + spring->getRestLength();
+            if (nd < distance[j]) {
+                distance[j] = nd;
+                anchor[j] = anchor[i];
+                previous[j] = i;
+                queue.emplace(nd, j);
+            }
+        }
+    }
+
+    island.tethers.clear();
+    island.tethersStale = false;
+    std::vector<int> tetherOf(n, -1);
+    for (int i : settled) {
+        if (anchor[i] == i || members[i]->isFixed()) continue;
+        tetherOf[i] = (int)island.tethers.size();
+        island.tethers.push_back({members[i], members[anchor[i]], distance[i] * (1.0f + tetherSlack),
+                                  tetherOf[previous[i]]});
+    }
+}
+
+void Simulation::dropTethersThrough(Island& island, const PointMass* a, const PointMass* b) {
+    // A path runs through the spring when one end is the previous particle of the
+    // other; every path that extends it is cut too, and parents come first
+    tetherCut.assign(island.tethers.size(), 0);
+    for (size_t k = 0; k < island.tethers.size(); ++k) {
+        Tether& tether = island.tethers[k];
+        const PointMass* before = tether.parent >= 0 ? island.tethers[tether.parent].particle : tether.anchor;
+        const bool throughSpring = (tether.particle == a && before == b) || (tether.particle == b && before == a);
+        if (!throughSpring && (tether.parent < 0 || !tetherCut[tether.parent])) continue;
+        tetherCut[k] = 1;
+        tether.anchor = nullptr;
+        island.tethersStale = true;
+    }
+}
+
+void Simulation::projectTethers(Island& island) {
+    // Unilateral: only pull a particle back when it is beyond its tether, and drop the
+    // outward part of its velocity so it does not rebound off the limit
+    for (const Tether& tether : island.tethers) {
+        if (!tether.anchor) continue;
+        Vector3D offset = tether.particle->getPosition() - tether.anchor->getPosition();
+        float length = offset.magnitude();
+        if (length <= tether.maxDistance || length < 1e-9f) continue;
+
+        Vector3D direction = offset / length;
+        tether.particle->setPosition(tether.anchor->getPosition() + direction * tether.maxDistance);
+        Vector3D vel = tether.particle->getVelocity();
+        float outward = vel.dot(direction);
+        if (outward > 0.0f) {
+            tether.particle->setVelocity(vel - direction * outward);
+        }
+    }
+}
+
+void Simulation::wakeRepinnedIslands() {
+    for (Island& island : islands) {
+        if (!island.sleeping) continue;
+        pinnedScratch.clear();
+        for (PointMass* pm : island.pointMasses) {
+            if (pm->isFixed()) pinnedScratch.push_back(pm);
+        }
+        if (pinnedScratch != island.sleepPins) wakeIsland(island);
+    }
+}
+
+void Simulation::wakeIsland(Island& island) {
+    island.sleeping = false;
+    island.calmTime = 0.0f;
+}
+
+void Simulation::prepareKinematicTargets(float dt) {
+    for (Island& island : islands) {
+        island.frameElapsed = 0.0f;
+        if (island.sleeping && !island.kinematics.empty() &&
+            kinematicTargetsMoved(island.kinematics, kinematics.paths, (float)(time + dt), 1e-5f)) {
+            wakeIsland(island);
+        }
+    }
+}
+
+void Simulation::wakeTouchedIslands() {
+    // Broadphase on island bounds: a moving island overlapping a sleeping one wakes it.
+    // Islands woken here move from the next frame on, and wake their neighbors then.
+    islandFlags.resize(islands.size());
+    for (size_t i = 0; i < islands.size(); ++i) {
+        islandFlags[i] = !islands[i].sleeping && islands[i].calmTime <= 0.0f;
+    }
+    findTouchingIslands(islandFlags, touchingIslands);
+    for (const auto& [i, j] : touchingIslands) {
+        if (islandFlags[i] && islands[j].sleeping) wakeIsland(islands[j]);
+        if (islandFlags[j] && islands[i].sleeping) wakeIsland(islands[i]);
+    }
+}
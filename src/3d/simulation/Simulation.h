@@ -2,8 +2,44 @@
 #define PBD_X_SIMULATION_H
 
 #include <vector>
+#include <functional>
 #include "../core/PointMass.h"
 #include "../core/Spring.h"
+#include "Island.h"
+#include "TriangleConstraints.h"
+#include "CollisionDetector.h"
+#include "Collider.h"
+#include "ForceFields.h"
+#include "KinematicTargets.h"
+#include "PickingBVH.h"
+#include "Material.h"
+#include "SpaceFillingCurve.h"
+
+struct MeshData;
+
+// Per-frame report of the substeps taken by update()
+struct StepStats {
+    // Most substeps taken by any island this frame
+    int substeps{0};
+    // Substeps summed over awake islands; the actual integration cost
+    int islandSubsteps{0};
+    float smallestSubDt{0.0f};
+    float largestSubDt{0.0f};
+    // Largest embedded error estimate seen this frame (adaptive mode only)
+    float maxError{0.0f};
+    // Adaptive substeps whose error estimate exceeded the tolerance; they are kept,
+    // and only the next substep shrinks
+    int overToleranceSteps{0};
+    // Number of velocities altered by the safety clamps (fixed mode only)
+    int clampedVelocities{0};
+    // Springs removed by tearing this frame
+    int tornSprings{0};
+    std::vector<float> subDts;
+    // Totals over all islands, sleeping ones included, when diagnostics are enabled
+    Diagnostics diagnostics;
+    // A diagnostic is not finite, or the total energy grew past the blow-up limits
+    bool blowUp{false};
+};
 
 class Simulation {
 public:
@@ -13,25 +49,308 @@ public:
     void update(float dt);
     void setFloorEnabled(bool enabled) { floorEnabled = enabled; }
     void setFloorY(float y) { floorY = y; }
+    [[nodiscard]] bool isFloorEnabled() const { return floorEnabled; }
+    [[nodiscard]] float getFloorY() const { return floorY; }
     void setRestitution(float r) { restitution = r; }
+    // Substep length used when neither adaptive nor multirate stepping is on
+    void setFixedSubstep(float dt) { fixedSubDt = dt; }
+    void addCollider(const Collider& collider) { colliders.push_back(collider); }
+    [[nodiscard]] const std::vector<Collider>& getColliders() const { return colliders; }
     void addPointMass(PointMass* pointMass);
     void addSpring(Spring* spring);
 
-    void createCloth(float startx, float starty, float startz, int width, int height, float spacing);
-    void createRope(float startx, float starty, float startz, int numPoints, float spacing);
+    void createCloth(float startx, float starty, float startz, int width, int height, float spacing,
+                     const Material& material = Material());
+    void createRope(float startx, float starty, float startz, int numPoints, float spacing,
+                    const Material& material = Material::rope());
+    // Build a soft body from an imported triangle mesh: one point mass per vertex, a
+    // structural spring per edge and a bending spring across each interior edge
+    // With triangleModel the bending springs are replaced by per-triangle area and
+    // per-edge dihedral bending constraints projected after each substep.
+    void createMesh(const MeshData& mesh, float startx, float starty, float startz, float scale = 1.0f,
+                    bool triangleModel = false, const Material& material = Material());
+    // Cloth grid using the triangle model: three springs per node instead of six
+    void createTriangleCloth(float startx, float starty, float startz, int width, int height, float spacing,
+                             const Material& material = Material());
+    // Pre-size the flat stores before building many bodies
+    void reserve(size_t pointMassCount, size_t springCount);
+
+    // Renumber point masses along a space-filling curve through their current
+    // positions (call once bodies are built, at rest) and reallocate them in that
+    // order, so that neighbors are adjacent both in the stores and on the heap.
+    // Springs, triangles and triangle constraints are renumbered to follow. Pointers
+    // to point masses and springs taken before the call are invalidated; ids are not.
+    void reorderSpatially(SpaceFillingCurve curve = SpaceFillingCurve::Hilbert);
+    // Move the point masses, in their current order, into one contiguous block, so that
+    // their state can be exported as strided arrays (see isPacked). Pointers to point
+    // masses and springs are invalidated as by reorderSpatially; the order of springs
+    // and triangles is kept. reorderSpatially packs as well.
+    void packPointMasses();
+    // Whether getPointMasses()[i] is the i-th element of one contiguous PointMass array.
+    // Adding a point mass or clearing ends that; the storage version changes whenever
+    // point masses move or are added or freed.
+    [[nodiscard]] bool isPacked() const { return pointMassBlock && pointMasses.size() == pointMassBlockSize; }
+    [[nodiscard]] unsigned long long getStorageVersion() const { return storageVersion; }
+    // Stable id of a point mass: its insertion index, unchanged by reordering
+    [[nodiscard]] int getPointMassId(int slot) const { return pointMassIds[slot]; }
+    [[nodiscard]] PointMass* getPointMassById(int id) const { return pointMasses[pointMassSlots[id]]; }
 
     [[nodiscard]] const std::vector<PointMass*>& getPointMasses() const { return pointMasses; }
     [[nodiscard]] const std::vector<Spring*>& getSprings() const { return springs; }
+    // Triangles as triples of indices into getPointMasses()
+    [[nodiscard]] const std::vector<int>& getTriangles() const { return triangles; }
+    // Every surface the air acts on: the triangles plus a triangulation of each spring
+    // cloth, in the same indexing
+    [[nodiscard]] const std::vector<int>& getSurfaceTriangles() const { return surfaceTriangles; }
+    [[nodiscard]] const TriangleConstraints& getTriangleConstraints() const { return triangleConstraints; }
+    void setTriangleStiffness(float area, float bend) { areaStiffness = area; dihedralStiffness = bend; }
 
     void clear();
+    // Put every setting a scene file can change (floor, stepping, sleeping, tearing,
+    // tethers, strain limiting, collisions, triangle stiffness) back to its default.
+    // Diagnostics, grabbing and the tear listener are left to the host.
+    void resetSettings();
+    // Load on every free particle for the whole of the next update, applied in each
+    // substep; call once per frame
     void applyGlobalForce(const Vector3D& force);
+    // Persistent fields (wind, drag, vortices, turbulence, surface aerodynamics) evaluated
+    // in every substep in the same pass as the applyGlobalForce load. Changing them wakes
+    // sleeping islands.
+    [[nodiscard]] ForceFields& getForceFields() { return forceFields; }
+
+    // Pin or unpin a point mass; wakes the island it belongs to. Pins set directly on a
+    // point mass wake its island at the next update().
+    void setFixed(PointMass* pointMass, bool fixed);
+
+    // Kinematic targets: pinned particles carried along keyframed or scripted paths, such
+    // as a rope on a moving crane hook or cloth on an animated rig. Each island moves its
+    // targets in one pass before forces in every substep, evaluating each path it uses
+    // once, so the integration loop is unchanged. A sleeping island wakes when its targets
+    // move on. Throws std::runtime_error for keys that are missing or out of order, and
+    // std::out_of_range for a path or point mass id that does not exist.
+    int addKinematicPath(const KinematicPath& path);
+    void setKinematicPath(int path, const KinematicPath& replacement);
+    // Pin the point mass with this id and carry it along path, at its current offset
+    // from where the path is now. Only its island is touched, and woken.
+    void attachToPath(int pointMassId, int path);
+    // Unpin it again, keeping the velocity of the path
+    void detachFromPath(int pointMassId);
+    [[nodiscard]] const KinematicTargets& getKinematicTargets() const { return kinematics; }
+    // Simulated time, advanced by update() and reset by clear()
+    [[nodiscard]] double getTime() const { return time; }
+
+    // Picking: the free particle under a ray, either within radius of it or a vertex of
+    // the surface triangle it crosses, nearest along the ray. Islands the ray misses are
+    // skipped on their bounds and the rest searched through their PickingBVH, refit from
+    // the chunk bounds the last substep of each frame records.
+    [[nodiscard]] PickHit pick(const Vector3D& origin, const Vector3D& direction, float radius);
+    // Dragging: a damped spring, per unit mass, pulls the grabbed particle toward the
+    // target in every substep alongside the force fields. Setting the target wakes the
+    // particle's island; reordering or clearing the simulation releases it.
+    void grab(PointMass* pointMass, const Vector3D& target);
+    void setGrabTarget(const Vector3D& target);
+    void release() { grabbed = nullptr; }
+    [[nodiscard]] PointMass* getGrabbed() const { return grabbed; }
+    void setGrabStiffness(float stiffness, float damping) { grabStiffness = stiffness; grabDamping = damping; }
+
+    // Sleeping, on by default: islands whose peak kinetic energy per unit mass stays
+    // below the threshold for sleepDelay seconds stop being integrated until woken by a
+    // contact, a load or field change, a moving kinematic target, a grab or a pin change.
+    void setSleepingEnabled(bool enabled);
+    void setSleepThreshold(float energyPerMass) { sleepThreshold = energyPerMass; }
+    void setSleepDelay(float seconds) { sleepDelay = seconds; }
+    void wakeAll();
+
+    // Adaptive stepping: substep size follows a CFL bound on particle speed versus
+    // spring rest length and an embedded local error estimate, instead of a fixed 5 ms.
+    // The controller never rejects a step: a substep can tear springs, push contacts and
+    // tell listeners, none of which a retry could take back, so a step over tolerance
+    // is kept and the next one is shrunk (counted in StepStats::overToleranceSteps).
+    // The CFL bound is what keeps the step stable.
+    void setAdaptiveStepping(bool enabled) { adaptiveStepping = enabled; }
+    void setStepTolerance(float tolerance) { stepTolerance = tolerance; }
+    void setCourantNumber(float c) { courantNumber = c; }
+    void setSubstepLimits(float minDt, float maxDt) { minSubDt = minDt; maxSubDt = maxDt; }
+    [[nodiscard]] const StepStats& getStepStats() const { return stepStats; }
+
+    // Diagnostics: kinetic, spring and load potential energy, linear momentum, strain and
+    // contacts reduced inside the spring and integration loops of each island's last
+    // substep of a frame, reported in getStepStats(). A frame is flagged as a blow-up when
+    // a value is not finite, or when the total energy grows by more than (factor - 1)
+    // times its magnitude in one frame to above energyPerMass times the free mass. A fall
+    // trades load potential for kinetic energy and keeps the total; a frame whose load
+    // changed is only checked for finite values. The reduction is serial: islands are
+    // stepped one after another, their loops write shared point masses and are not split
+    // across threads, and update() adds the per-island sums in island order.
+    void setDiagnosticsEnabled(bool enabled) { diagnosticsEnabled = enabled; }
+    void setBlowUpLimits(float factor, float energyPerMass) { blowUpFactor = factor; blowUpEnergyPerMass = energyPerMass; }
+
+    // Multirate stepping: every island integrates at its own rate from its stiffness to
+    // mass ratio and speed, synchronized at frame boundaries. Takes precedence over
+    // adaptive stepping when both are enabled.
+    void setMultirateStepping(bool enabled) { multirateStepping = enabled; }
+
+    // Tearing: a spring stretched beyond (1 + strain) times its rest length breaks.
+    // The listener is told about every torn spring so views can drop it.
+    void setTearingEnabled(bool enabled) { tearingEnabled = enabled; }
+    void setTearStrain(float strain) { tearStrain = strain; }
+    void setTearListener(std::function<void(PointMass*, PointMass*)> listener) { tearListener = std::move(listener); }
+
+    // Long-range attachments: every particle is tethered to its nearest pinned particle
+    // at the geodesic rest distance through the spring graph, so ropes and hanging cloth
+    // cannot stretch however few substeps are taken. Recomputed lazily when pins or
+    // topology change. slack loosens the tethers by that fraction of their length.
+    void setLongRangeAttachmentsEnabled(bool enabled) { longRangeAttachments = enabled; tethersDirty = true; }
+    void setTetherSlack(float slack) { tetherSlack = slack; tethersDirty = true; }
+
+    // Strain limiting: after each substep, springs stretched past (1 + maxStretch) times
+    // their rest length are pulled back by a solver built per island, with a geometric
+    // multigrid hierarchy for cloth grids and aggregation for other meshes. With
+    // multigrid off only the finest level is used, i.e. flat Jacobi sweeps.
+    void setStrainLimitingEnabled(bool enabled) { strainLimiting = enabled; strainSolversDirty = true; }
+    void setMaxStretch(float stretch) { maxStretch = stretch; }
+    void setMultigridEnabled(bool enabled) { multigrid = enabled; strainSolversDirty = true; }
+    // V-cycles per substep and Jacobi sweeps before and after each coarse correction
+    void setStrainSolverIterations(int cycles, int smoothing) { solverCycles = cycles; smoothingIterations = smoothing; }
+
+    // Continuous collision detection between moving points and triangles and between
+    // triangle edges, so thin cloth cannot tunnel through itself or other meshes. The
+    // swept surfaces are getSurfaceTriangles(), spring cloths included. The floor needs
+    // no sweep as a half-space; sphere and plane colliders are still tested per substep.
+    void setContinuousCollisionEnabled(bool enabled) { continuousCollision = enabled; }
+    void setCollisionThickness(float thickness) { collisions.setThickness(thickness); }
+    [[nodiscard]] const CollisionStats& getCollisionStats() const { return collisions.getStats(); }
+    void resetCollisionStats() { collisions.resetStats(); }
+
+    [[nodiscard]] const std::vector<Island>& getIslands();
+    [[nodiscard]] int getAwakeIslandCount();
 
 private:
+    void updateAdaptive(float dt);
+    [[nodiscard]] float stableSubDt() const;
+    [[nodiscard]] float islandStableSubDt(const Island& island) const;
+    void updateMultirate(float dt);
+    [[nodiscard]] bool boundsTouch(const Island& a, const Island& b) const;
+    // Pairs of islands whose bounds touch, at least one of them flagged in moving, from
+    // a sort and sweep along x
+    void findTouchingIslands(const std::vector<uint8_t>& moving, std::vector<std::pair<int, int>>& pairs);
+    void substep(float subDt, bool lastStep, float frameDt);
+    void stepIsland(Island& island, float subDt, bool lastStep, float frameDt);
+    void removeSpring(Island& island, Spring* spring);
+    // Rebuild the point masses as a block in the given order (new slot k holds old slot
+    // order[k]); springs and triangles are sorted by their lowest slot when sortTopology
+    void relocatePointMasses(const std::vector<int>& order, bool sortTopology);
+    void releasePointMasses();
+    void ensureIslands();
+    void rebuildIslands();
+    void wakeIsland(Island& island);
+    void wakeTouchedIslands();
+    void wakeRepinnedIslands();
+    // Start a frame for the kinematic targets, waking islands whose targets will move
+    void prepareKinematicTargets(float dt);
+    void resolveCollisions(float dt);
+    // Returns whether the particle was in contact with a collider
+    bool collideStatic(PointMass* pm);
+    void gatherDiagnostics(bool loadChanged);
+    // pinsTouched: some point mass was pinned or unpinned since the last frame
+    void ensureTethers(bool pinsTouched);
+    void ensureStrainSolvers();
+    void rebuildTethers();
+    void rebuildTethers(Island& island);
+    // Drop the tethers whose geodesic path ran through the spring between a and b
+    void dropTethersThrough(Island& island, const PointMass* a, const PointMass* b);
+    void projectTethers(Island& island);
+
     std::vector<PointMass*> pointMasses;
+    // Contiguous storage of the point masses after packPointMasses or reorderSpatially;
+    // point masses added later are allocated individually
+    PointMass* pointMassBlock{nullptr};
+    size_t pointMassBlockSize{0};
+    unsigned long long storageVersion{0};
+    // Slot to id and id to slot; identities until reorderSpatially
+    std::vector<int> pointMassIds;
+    std::vector<int> pointMassSlots;
     std::vector<Spring*> springs;
+    std::vector<int> triangles;
+    std::vector<int> surfaceTriangles;
+    TriangleConstraints triangleConstraints;
+    float areaStiffness{1.0f};
+    float dihedralStiffness{0.2f};
     bool floorEnabled{true};
     float floorY{-1.0f};
     float restitution{0.6f};
+    float fixedSubDt{0.005f};
+    std::vector<Collider> colliders;
+
+    std::vector<Island> islands;
+    bool islandsDirty{true};
+    bool sleepingEnabled{true};
+    float sleepThreshold{2e-3f};
+    float sleepDelay{0.5f};
+    // Padding added to island bounds when testing for contact with sleeping islands
+    float contactMargin{0.05f};
+    // Global force accumulated for the next frame and the one being stepped; a change
+    // wakes everything
+    Vector3D frameForce;
+    Vector3D lastFrameForce;
+    ForceFields forceFields;
+    int forceFieldVersion{0};
+    KinematicTargets kinematics;
+    double time{0.0};
+    PointMass* grabbed{nullptr};
+    Vector3D grabTarget;
+    float grabStiffness{400.0f};
+    float grabDamping{20.0f};
+
+    bool adaptiveStepping{false};
+    bool multirateStepping{false};
+    float stepTolerance{1e-4f};
+    float courantNumber{0.5f};
+    float minSubDt{1e-4f};
+    float maxSubDt{0.02f};
+    float nextSubDt{0.005f};
+    StepStats stepStats;
+    bool diagnosticsEnabled{false};
+    float blowUpFactor{10.0f};
+    float blowUpEnergyPerMass{50.0f};
+    double lastTotalEnergy{0.0};
+
+    bool tearingEnabled{false};
+    float tearStrain{1.0f};
+    std::function<void(PointMass*, PointMass*)> tearListener;
+    std::vector<int> tornSprings;
+
+    bool longRangeAttachments{false};
+    bool tethersDirty{true};
+    float tetherSlack{0.0f};
+    // Pinned particles the current tethers were computed for
+    std::vector<PointMass*> tetherAnchors;
+    std::vector<PointMass*> pinnedScratch;
+    // PointMass::getPinVersion() when the pins were last looked at
+    unsigned long long seenPinVersion{0};
+    // Per tether, whether dropTethersThrough cut its path
+    std::vector<uint8_t> tetherCut;
+
+    // Regular grids created by createCloth/createTriangleCloth, for the geometric hierarchy
+    struct GridPatch {
+        int first;  // point mass id
+        int width;
+        int height;
+    };
+    std::vector<GridPatch> gridPatches;
+    bool strainLimiting{false};
+    bool multigrid{true};
+    bool strainSolversDirty{true};
+    float maxStretch{0.1f};
+    int solverCycles{2};
+    int smoothingIterations{2};
+
+    bool continuousCollision{false};
+    CollisionDetector collisions;
+    // Scratch for findTouchingIslands and its callers
+    std::vector<int> sweepOrder;
+    std::vector<uint8_t> islandFlags;
+    std::vector<std::pair<int, int>> touchingIslands;
 };
 
 
@@ -0,0 +1,72 @@
+#include "SpaceFillingCurve.h"
+#include <algorithm>
+#include <cfloat>
+#include <numeric>
+
+namespace {
+
+uint64_t interleave(uint32_t a, uint32_t b, uint32_t c) {
+    uint64_t out = 0;
+    for (int bit = SpaceFilling::BITS - 1; bit >= 0; --bit) {
+        out = (out << 3) | ((uint64_t)((a >> bit) & 1u) << 2) | ((uint64_t)((b >> bit) & 1u) << 1) | ((c >> bit) & 1u);
+    }
+    return out;
+}
+
+// Skilling's transform ("Programming the Hilbert curve", 2004): converts coordinates
+// in place into the transposed Hilbert index, whose interleaved bits are the index
+void axesToTranspose(uint32_t x[3]) {
+    const uint32_t top = 1u << (SpaceFilling::BITS - 1);
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        const uint32_t p = q - 1;
+        for (int i = 0; i < 3; ++i) {
+            if (x[i] & q) {
+                x[0] ^= p;
+            } else {
+                uint32_t t = (x[0] ^ x[i]) & p;
+                x[0] ^= t;
+                x[i] ^= t;
+            }
+        }
+    }
+    // Gray encode
+    x[1] ^= x[0];
+    x[2] ^= x[1];
+    uint32_t t = 0;
+    for (uint32_t q = top; q > 1; q >>= 1) {
+        if (x[2] & q) t ^= q - 1;
+    }
+    for (int i = 0; i < 3; ++i) x[i] ^= t;
+}
+
+} // namespace
+
+uint64_t SpaceFilling::key(SpaceFillingCurve curve, uint32_t x, uint32_t y, uint32_t z) {
+    if (curve == SpaceFillingCurve::Morton) return interleave(x, y, z);
+    uint32_t axes[3] = {x, y, z};
+    axesToTranspose(axes);
+    return interleave(axes[0], axes[1], axes[2]);
+}
+
+std::vector<int> SpaceFilling::order(const std::vector<Vector3D>& points, SpaceFillingCurve curve) {
+    Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (const Vector3D& p : points) {
+        lo.x = std::min(lo.x, p.x); lo.y = std::min(lo.y, p.y); lo.z = std::min(lo.z, p.z);
+        hi.x = std::max(hi.x, p.x); hi.y = std::max(hi.y, p.y); hi.z = std::max(hi.z, p.z);
+    }
+    // One scale for all axes keeps the cells cubic, so flat cloth is not stretched
+    const float extent = std::max({hi.x - lo.x, hi.y - lo.y, hi.z - lo.z, 1e-12f});
+    const float scale = (float)((1u << BITS) - 1) / extent;
+
+    std::vector<uint64_t> keys(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+        const Vector3D& p = points[i];
+        keys[i] = key(curve, (uint32_t)((p.x - lo.x) * scale), (uint32_t)((p.y - lo.y) * scale),
+                      (uint32_t)((p.z - lo.z) * scale));
+    }
+
+    std::vector<int> result(points.size());
+    std::iota(result.begin(), result.end(), 0);
+    std::stable_sort(result.begin(), result.end(), [&keys](int a, int b) { return keys[a] < keys[b]; });
+    return result;
+}
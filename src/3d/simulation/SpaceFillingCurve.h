@@ -0,0 +1,24 @@
+#ifndef PBD_X_SPACEFILLINGCURVE_H
+#define PBD_X_SPACEFILLINGCURVE_H
+
+#include <cstdint>
+#include <vector>
+#include "../core/Vector3D.h"
+
+enum class SpaceFillingCurve { Morton, Hilbert };
+
+namespace SpaceFilling {
+    // Bits per axis of the quantized coordinates; three axes fit a 64-bit key
+    constexpr int BITS = 21;
+
+    // Key of a point quantized to BITS per axis. Morton interleaves the coordinate
+    // bits; Hilbert additionally rotates each octant so consecutive keys are always
+    // face neighbors, at a few more operations per point.
+    uint64_t key(SpaceFillingCurve curve, uint32_t x, uint32_t y, uint32_t z);
+
+    // Order of the points along the curve through their bounding box: element k is
+    // the index of the k-th point. Ties keep input order.
+    std::vector<int> order(const std::vector<Vector3D>& points, SpaceFillingCurve curve);
+}
+
+#endif //PBD_X_SPACEFILLINGCURVE_H
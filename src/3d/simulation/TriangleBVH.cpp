@@ -0,0 +1,163 @@
+#include "TriangleBVH.h"
+#include "../utils/Parallel.h"
+#include <algorithm>
+#include <cfloat>
+#include <thread>
+
+namespace {
+
+constexpr int LEAF_SIZE = 4;
+// Trees over fewer triangles are refit on the calling thread: at a few tens of
+// nanoseconds per node, starting threads would cost more than the refit
+constexpr size_t PARALLEL_TRIANGLES = 65536;
+// Subtrees handed to each thread in a parallel refit, for balance
+constexpr size_t SUBTREES_PER_THREAD = 4;
+
+float surfaceArea(const Vector3D& lo, const Vector3D& hi) {
+    Vector3D d = hi - lo;
+    return 2.0f * (d.x * d.y + d.y * d.z + d.z * d.x);
+}
+
+} // namespace
+
+void TriangleBVH::clear() {
+    nodes.clear();
+    order.clear();
+    boxLo.clear();
+    boxHi.clear();
+    levels.clear();
+    builtArea = 0.0f;
+    currentArea = 0.0f;
+}
+
+void TriangleBVH::build(const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                        const std::vector<Vector3D>& end, float margin) {
+    clear();
+    const int count = (int)(triangles.size() / 3);
+    if (count == 0) return;
+
+    std::vector<Vector3D> centroids(count);
+    order.resize(count);
+    boxLo.resize(count);
+    boxHi.resize(count);
+    for (int t = 0; t < count; ++t) {
+        order[t] = t;
+        centroids[t] = (end[triangles[t * 3]] + end[triangles[t * 3 + 1]] + end[triangles[t * 3 + 2]]) / 3.0f;
+    }
+
+    nodes.reserve(2 * count / LEAF_SIZE + 1);
+    buildNode(0, count, 0, centroids);
+    refit(triangles, start, end, margin);
+    builtArea = currentArea;
+}
+
+int TriangleBVH::buildNode(int first, int count, int depth, const std::vector<Vector3D>& centroids) {
+    int index = (int)nodes.size();
+    nodes.emplace_back();
+    if ((int)levels.size() <= depth) levels.emplace_back();
+    levels[depth].push_back(index);
+
+    if (count <= LEAF_SIZE) {
+        nodes[index].first = first;
+        nodes[index].count = count;
+        return index;
+    }
+
+    // Median split along the longest axis of the centroid bounds
+    Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int i = first; i < first + count; ++i) {
+        const Vector3D& c = centroids[order[i]];
+        lo.x = std::min(lo.x, c.x); lo.y = std::min(lo.y, c.y); lo.z = std::min(lo.z, c.z);
+        hi.x = std::max(hi.x, c.x); hi.y = std::max(hi.y, c.y); hi.z = std::max(hi.z, c.z);
+    }
+    Vector3D extent = hi - lo;
+    int axis = (extent.x >= extent.y && extent.x >= extent.z) ? 0 : (extent.y >= extent.z ? 1 : 2);
+    auto key = [&centroids, axis](int t) {
+        const Vector3D& c = centroids[t];
+        return axis == 0 ? c.x : (axis == 1 ? c.y : c.z);
+    };
+
+    int half = count / 2;
+    std::nth_element(order.begin() + first, order.begin() + first + half, order.begin() + first + count,
+                     [&key](int a, int b) { return key(a) < key(b); });
+
+    int left = buildNode(first, half, depth + 1, centroids);
+    int right = buildNode(first + half, count - half, depth + 1, centroids);
+    nodes[index].left = left;
+    nodes[index].right = right;
+    return index;
+}
+
+void TriangleBVH::refitLeaf(Node& node, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                            const std::vector<Vector3D>& end, float margin) {
+    const Vector3D pad(margin, margin, margin);
+    Vector3D lo(FLT_MAX, FLT_MAX, FLT_MAX), hi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+    for (int i = node.first; i < node.first + node.count; ++i) {
+        int t = order[i];
+        Vector3D tlo(FLT_MAX, FLT_MAX, FLT_MAX), thi(-FLT_MAX, -FLT_MAX, -FLT_MAX);
+        for (int k = 0; k < 3; ++k) {
+            int v = triangles[t * 3 + k];
+            for (const Vector3D* p : {&start[v], &end[v]}) {
+                tlo.x = std::min(tlo.x, p->x); tlo.y = std::min(tlo.y, p->y); tlo.z = std::min(tlo.z, p->z);
+                thi.x = std::max(thi.x, p->x); thi.y = std::max(thi.y, p->y); thi.z = std::max(thi.z, p->z);
+            }
+        }
+        boxLo[i] = tlo - pad;
+        boxHi[i] = thi + pad;
+        lo.x = std::min(lo.x, tlo.x); lo.y = std::min(lo.y, tlo.y); lo.z = std::min(lo.z, tlo.z);
+        hi.x = std::max(hi.x, thi.x); hi.y = std::max(hi.y, thi.y); hi.z = std::max(hi.z, thi.z);
+    }
+    node.lo = lo - pad;
+    node.hi = hi + pad;
+}
+
+void TriangleBVH::refitNode(Node& node, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                            const std::vector<Vector3D>& end, float margin) {
+    if (node.left < 0) {
+        refitLeaf(node, triangles, start, end, margin);
+        return;
+    }
+    const Node& l = nodes[node.left];
+    const Node& r = nodes[node.right];
+    node.lo = Vector3D(std::min(l.lo.x, r.lo.x), std::min(l.lo.y, r.lo.y), std::min(l.lo.z, r.lo.z));
+    node.hi = Vector3D(std::max(l.hi.x, r.hi.x), std::max(l.hi.y, r.hi.y), std::max(l.hi.z, r.hi.z));
+}
+
+void TriangleBVH::refitSubtree(int index, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                               const std::vector<Vector3D>& end, float margin) {
+    Node& node = nodes[index];
+    if (node.left >= 0) {
+        refitSubtree(node.left, triangles, start, end, margin);
+        refitSubtree(node.right, triangles, start, end, margin);
+    }
+    refitNode(node, triangles, start, end, margin);
+}
+
+void TriangleBVH::refit(const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                        const std::vector<Vector3D>& end, float margin) {
+    // Large trees are cut at the first level wide enough to keep every thread busy; the
+    // subtrees below it are refit in one parallel pass, so threads start once per refit
+    // rather than once per level. The levels above are refit serially, deepest first.
+    int splitDepth = (int)levels.size();
+    if (order.size() >= PARALLEL_TRIANGLES) {
+        const size_t wanted = SUBTREES_PER_THREAD * std::max(1u, std::thread::hardware_concurrency());
+        splitDepth = 0;
+        while (splitDepth + 1 < (int)levels.size() && levels[splitDepth].size() < wanted) ++splitDepth;
+        const std::vector<int>& roots = levels[splitDepth];
+        Parallel::forRange((int)roots.size(), (int)SUBTREES_PER_THREAD, [&](int begin, int endIndex) {
+            for (int i = begin; i < endIndex; ++i) refitSubtree(roots[i], triangles, start, end, margin);
+        });
+    }
+    for (int depth = splitDepth - 1; depth >= 0; --depth) {
+        for (int index : levels[depth]) refitNode(nodes[index], triangles, start, end, margin);
+    }
+    currentArea = totalArea();
+}
+
+float TriangleBVH::totalArea() const {
+    float area = 0.0f;
+    for (const Node& node : nodes) {
+        area += surfaceArea(node.lo, node.hi);
+    }
+    return area;
+}
@@ -0,0 +1,84 @@
+#ifndef PBD_X_TRIANGLEBVH_H
+#define PBD_X_TRIANGLEBVH_H
+
+#include <vector>
+#include "../core/Vector3D.h"
+
+// Bounding volume hierarchy over deforming triangles. Leaf boxes enclose each
+// triangle's motion over a substep (start and end positions), so the tree can be
+// refit bottom-up every substep instead of rebuilt.
+class TriangleBVH {
+public:
+    struct Node {
+        Vector3D lo, hi;
+        int left{-1}, right{-1};  // children, or -1 for a leaf
+        int first{0}, count{0};   // leaf range in the triangle order
+    };
+
+    void build(const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+               const std::vector<Vector3D>& end, float margin);
+    void refit(const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+               const std::vector<Vector3D>& end, float margin);
+    void clear();
+
+    // Refit quality: summed node surface area now versus right after the last build
+    [[nodiscard]] bool needsRebuild(float ratio = 2.0f) const { return builtArea > 0.0f && currentArea > ratio * builtArea; }
+    [[nodiscard]] bool empty() const { return nodes.empty(); }
+    [[nodiscard]] size_t triangleCount() const { return order.size(); }
+
+    // Call visit(triangleIndex) for every triangle whose box overlaps [lo, hi]
+    template <typename Visitor>
+    void query(const Vector3D& lo, const Vector3D& hi, Visitor&& visit) const {
+        if (nodes.empty()) return;
+        // A depth-first walk holds at most one pending sibling per level, so the stack
+        // is sized from the tree's depth and only deep trees spill to the heap
+        int localStack[64];
+        std::vector<int> heapStack;
+        int* stack = localStack;
+        if (levels.size() + 1 > 64) {
+            heapStack.resize(levels.size() + 1);
+            stack = heapStack.data();
+        }
+        int top = 0;
+        stack[top++] = 0;
+        while (top > 0) {
+            const Node& node = nodes[stack[--top]];
+            if (!overlaps(node.lo, node.hi, lo, hi)) continue;
+            if (node.left < 0) {
+                for (int i = node.first; i < node.first + node.count; ++i) {
+                    if (overlaps(boxLo[i], boxHi[i], lo, hi)) visit(order[i]);
+                }
+            } else {
+                stack[top++] = node.left;
+                stack[top++] = node.right;
+            }
+        }
+    }
+
+private:
+    static bool overlaps(const Vector3D& aLo, const Vector3D& aHi, const Vector3D& bLo, const Vector3D& bHi) {
+        return aLo.x <= bHi.x && aHi.x >= bLo.x && aLo.y <= bHi.y && aHi.y >= bLo.y &&
+               aLo.z <= bHi.z && aHi.z >= bLo.z;
+    }
+
+    int buildNode(int first, int count, int depth, const std::vector<Vector3D>& centroids);
+    void refitLeaf(Node& node, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                   const std::vector<Vector3D>& end, float margin);
+    // One node from its triangles or its children
+    void refitNode(Node& node, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                   const std::vector<Vector3D>& end, float margin);
+    void refitSubtree(int index, const std::vector<int>& triangles, const std::vector<Vector3D>& start,
+                      const std::vector<Vector3D>& end, float margin);
+    [[nodiscard]] float totalArea() const;
+
+    std::vector<Node> nodes;
+    std::vector<int> order;
+    // Per-triangle swept boxes, stored in tree order
+    std::vector<Vector3D> boxLo, boxHi;
+    // Node indices grouped by depth; refit walks the upper levels deepest first
+    std::vector<std::vector<int>> levels;
+    float builtArea{0.0f};
+    float currentArea{0.0f};
+};
+
+#endif //PBD_X_TRIANGLEBVH_H
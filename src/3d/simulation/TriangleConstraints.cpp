@@ -0,0 +1,206 @@
+#include "TriangleConstraints.h"
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+float triangleArea(const Vector3D& a, const Vector3D& b, const Vector3D& c) {
+    return 0.5f * (b - a).cross(c - a).magnitude();
+}
+
+// Signed angle between the wing normals of hinge (a, b) with wings c and d; zero when flat.
+// Must match the angle measured in projectTriangleConstraints.
+float dihedralAngle(const Vector3D& a, const Vector3D& b, const Vector3D& c, const Vector3D& d) {
+    Vector3D e = b - a;
+    Vector3D n1 = (c - a).cross(c - b);
+    Vector3D n2 = (d - b).cross(d - a);
+    float elen = e.magnitude();
+    if (elen < 1e-6f) return 0.0f;
+    return std::atan2(n1.cross(n2).dot(e) / elen, n1.dot(n2));
+}
+
+inline void cross(float ax, float ay, float az, float bx, float by, float bz, float& cx, float& cy, float& cz) {
+    cx = ay * bz - az * by;
+    cy = az * bx - ax * bz;
+    cz = ax * by - ay * bx;
+}
+
+inline void accumulate(ConstraintBatch& b, int v, const float* delta) {
+    b.dx[v] += delta[0];
+    b.dy[v] += delta[1];
+    b.dz[v] += delta[2];
+    b.count[v] += 1.0f;
+}
+
+} // namespace
+
+void TriangleConstraints::addTriangle(const std::vector<PointMass*>& pointMasses, int a, int b, int c) {
+    areaVertices.push_back(a);
+    areaVertices.push_back(b);
+    areaVertices.push_back(c);
+    restAreas.push_back(triangleArea(pointMasses[a]->getPosition(), pointMasses[b]->getPosition(), pointMasses[c]->getPosition()));
+}
+
+void TriangleConstraints::addHinge(const std::vector<PointMass*>& pointMasses, int a, int b, int c, int d) {
+    bendVertices.push_back(a);
+    bendVertices.push_back(b);
+    bendVertices.push_back(c);
+    bendVertices.push_back(d);
+    restAngles.push_back(dihedralAngle(pointMasses[a]->getPosition(), pointMasses[b]->getPosition(),
+                                       pointMasses[c]->getPosition(), pointMasses[d]->getPosition()));
+}
+
+void TriangleConstraints::clear() {
+    areaVertices.clear();
+    restAreas.clear();
+    bendVertices.clear();
+    restAngles.clear();
+}
+
+void ConstraintBatch::clear() {
+    vertices.clear();
+    areaA.clear(); areaB.clear(); areaC.clear();
+    restAreas.clear();
+    bendA.clear(); bendB.clear(); bendC.clear(); bendD.clear();
+    restAngles.clear();
+}
+
+void projectTriangleConstraints(ConstraintBatch& b, float dt, float areaStiffness, float bendStiffness) {
+    const int n = (int)b.vertices.size();
+    b.x.resize(n); b.y.resize(n); b.z.resize(n); b.invMass.resize(n);
+    b.dx.assign(n, 0.0f); b.dy.assign(n, 0.0f); b.dz.assign(n, 0.0f); b.count.assign(n, 0.0f);
+
+    for (int i = 0; i < n; ++i) {
+        PointMass* pm = b.vertices[i];
+        auto pos = pm->getPosition();
+        b.x[i] = pos.x;
+        b.y[i] = pos.y;
+        b.z[i] = pos.z;
+        b.invMass[i] = pm->isFixed() ? 0.0f : 1.0f / pm->getMass();
+    }
+
+    const float eps = 1e-12f;
+
+    // The kernels below are branch-free and write each constraint's corrections to its
+    // own slot, so they vectorize; the scatter into shared vertices is a separate pass.
+
+    // Area: C = area - restArea
+    const int areas = (int)b.restAreas.size();
+    b.areaDelta.resize(areas * 9);
+    float* areaOut = b.areaDelta.data();
+    for (int t = 0; t < areas; ++t) {
+        const int ia = b.areaA[t], ib = b.areaB[t], ic = b.areaC[t];
+        float e1x = b.x[ib] - b.x[ia], e1y = b.y[ib] - b.y[ia], e1z = b.z[ib] - b.z[ia];
+        float e2x = b.x[ic] - b.x[ia], e2y = b.y[ic] - b.y[ia], e2z = b.z[ic] - b.z[ia];
+        float nx, ny, nz;
+        cross(e1x, e1y, e1z, e2x, e2y, e2z, nx, ny, nz);
+        float len = std::sqrt(nx * nx + ny * ny + nz * nz);
+        float inv = len > eps ? 1.0f / len : 0.0f;
+        nx *= inv; ny *= inv; nz *= inv;
+
+        float gbx, gby, gbz, gcx, gcy, gcz;
+        cross(e2x, e2y, e2z, nx, ny, nz, gbx, gby, gbz);
+        cross(nx, ny, nz, e1x, e1y, e1z, gcx, gcy, gcz);
+        gbx *= 0.5f; gby *= 0.5f; gbz *= 0.5f;
+        gcx *= 0.5f; gcy *= 0.5f; gcz *= 0.5f;
+        float gax = -gbx - gcx, gay = -gby - gcy, gaz = -gbz - gcz;
+
+        const float wa = b.invMass[ia], wb = b.invMass[ib], wc = b.invMass[ic];
+        float sum = wa * (gax * gax + gay * gay + gaz * gaz) +
+                    wb * (gbx * gbx + gby * gby + gbz * gbz) +
+                    wc * (gcx * gcx + gcy * gcy + gcz * gcz);
+        float c = 0.5f * len - b.restAreas[t];
+        float s = sum > eps ? -areaStiffness * c / sum : 0.0f;
+
+        float* out = areaOut + t * 9;
+        out[0] = s * wa * gax; out[1] = s * wa * gay; out[2] = s * wa * gaz;
+        out[3] = s * wb * gbx; out[4] = s * wb * gby; out[5] = s * wb * gbz;
+        out[6] = s * wc * gcx; out[7] = s * wc * gcy; out[8] = s * wc * gcz;
+    }
+
+    // Dihedral bending with the signed-angle gradients of Bridson et al. 2003, which stay
+    // well conditioned for flat hinges. Shared edge (a, b), wing vertices c and d.
+    const int hinges = (int)b.restAngles.size();
+    b.bendDelta.resize(hinges * 12);
+    float* bendOut = b.bendDelta.data();
+    for (int h = 0; h < hinges; ++h) {
+        const int i1 = b.bendA[h], i2 = b.bendB[h], i3 = b.bendC[h], i4 = b.bendD[h];
+        float ex = b.x[i2] - b.x[i1], ey = b.y[i2] - b.y[i1], ez = b.z[i2] - b.z[i1];
+        float ca_x = b.x[i3] - b.x[i1], ca_y = b.y[i3] - b.y[i1], ca_z = b.z[i3] - b.z[i1];
+        float cb_x = b.x[i3] - b.x[i2], cb_y = b.y[i3] - b.y[i2], cb_z = b.z[i3] - b.z[i2];
+        float da_x = b.x[i4] - b.x[i1], da_y = b.y[i4] - b.y[i1], da_z = b.z[i4] - b.z[i1];
+        float db_x = b.x[i4] - b.x[i2], db_y = b.y[i4] - b.y[i2], db_z = b.z[i4] - b.z[i2];
+
+        // Unnormalized wing normals N1 = (c - a) x (c - b), N2 = (d - b) x (d - a)
+        float n1x, n1y, n1z, n2x, n2y, n2z;
+        cross(ca_x, ca_y, ca_z, cb_x, cb_y, cb_z, n1x, n1y, n1z);
+        cross(db_x, db_y, db_z, da_x, da_y, da_z, n2x, n2y, n2z);
+        float n1sq = n1x * n1x + n1y * n1y + n1z * n1z;
+        float n2sq = n2x * n2x + n2y * n2y + n2z * n2z;
+        float elen = std::sqrt(ex * ex + ey * ey + ez * ez);
+        // Degenerate hinges get zero weights and hence no correction
+        const bool valid = n1sq > eps && n2sq > eps && elen > 1e-6f;
+        float in1 = valid ? 1.0f / n1sq : 0.0f;
+        float in2 = valid ? 1.0f / n2sq : 0.0f;
+        float ie = valid ? 1.0f / elen : 0.0f;
+
+        // Signed angle between the normals about the edge direction
+        float cx, cy, cz;
+        cross(n1x, n1y, n1z, n2x, n2y, n2z, cx, cy, cz);
+        float sine = (cx * ex + cy * ey + cz * ez) * ie;
+        float cosine = n1x * n2x + n1y * n2y + n1z * n2z;
+        float angle = std::atan2(sine, cosine);
+
+        // Gradients of the angle for the wings (u3, u4) and the edge ends (u1, u2)
+        float u3x = elen * in1 * n1x, u3y = elen * in1 * n1y, u3z = elen * in1 * n1z;
+        float u4x = elen * in2 * n2x, u4y = elen * in2 * n2y, u4z = elen * in2 * n2z;
+        float ta = (ca_x * ex + ca_y * ey + ca_z * ez) * ie;
+        float tb = (cb_x * ex + cb_y * ey + cb_z * ez) * ie;
+        float sa = (da_x * ex + da_y * ey + da_z * ez) * ie;
+        float sb = (db_x * ex + db_y * ey + db_z * ez) * ie;
+        float q1x = tb * in1 * n1x + sb * in2 * n2x, q1y = tb * in1 * n1y + sb * in2 * n2y, q1z = tb * in1 * n1z + sb * in2 * n2z;
+        float q2x = -ta * in1 * n1x - sa * in2 * n2x, q2y = -ta * in1 * n1y - sa * in2 * n2y, q2z = -ta * in1 * n1z - sa * in2 * n2z;
+        float q3x = u3x, q3y = u3y, q3z = u3z;
+        float q4x = u4x, q4y = u4y, q4z = u4z;
+
+        const float w1 = b.invMass[i1], w2 = b.invMass[i2], w3 = b.invMass[i3], w4 = b.invMass[i4];
+        float sum = w1 * (q1x * q1x + q1y * q1y + q1z * q1z) +
+                    w2 * (q2x * q2x + q2y * q2y + q2z * q2z) +
+                    w3 * (q3x * q3x + q3y * q3y + q3z * q3z) +
+                    w4 * (q4x * q4x + q4y * q4y + q4z * q4z);
+
+        // Wrap the error into (-pi, pi] so a hinge never takes the long way round
+        float c = angle - b.restAngles[h];
+        c = c > 3.14159265f ? c - 6.28318531f : (c < -3.14159265f ? c + 6.28318531f : c);
+        float s = (valid && sum > eps) ? bendStiffness * c / sum : 0.0f;
+
+        float* out = bendOut + h * 12;
+        out[0] = s * w1 * q1x; out[1] = s * w1 * q1y; out[2] = s * w1 * q1z;
+        out[3] = s * w2 * q2x; out[4] = s * w2 * q2y; out[5] = s * w2 * q2z;
+        out[6] = s * w3 * q3x; out[7] = s * w3 * q3y; out[8] = s * w3 * q3z;
+        out[9] = s * w4 * q4x; out[10] = s * w4 * q4y; out[11] = s * w4 * q4z;
+    }
+
+    for (int t = 0; t < areas; ++t) {
+        accumulate(b, b.areaA[t], areaOut + t * 9);
+        accumulate(b, b.areaB[t], areaOut + t * 9 + 3);
+        accumulate(b, b.areaC[t], areaOut + t * 9 + 6);
+    }
+    for (int h = 0; h < hinges; ++h) {
+        accumulate(b, b.bendA[h], bendOut + h * 12);
+        accumulate(b, b.bendB[h], bendOut + h * 12 + 3);
+        accumulate(b, b.bendC[h], bendOut + h * 12 + 6);
+        accumulate(b, b.bendD[h], bendOut + h * 12 + 9);
+    }
+
+    // Average the accumulated corrections and carry them into the velocities
+    const float invDt = dt > 0.0f ? 1.0f / dt : 0.0f;
+    for (int i = 0; i < n; ++i) {
+        if (b.count[i] == 0.0f || b.invMass[i] == 0.0f) continue;
+        float inv = 1.0f / b.count[i];
+        Vector3D delta(b.dx[i] * inv, b.dy[i] * inv, b.dz[i] * inv);
+        PointMass* pm = b.vertices[i];
+        pm->setPosition(Vector3D(b.x[i], b.y[i], b.z[i]) + delta);
+        pm->setVelocity(pm->getVelocity() + delta * invDt);
+    }
+}
@@ -0,0 +1,43 @@
+#ifndef PBD_X_TRIANGLECONSTRAINTS_H
+#define PBD_X_TRIANGLECONSTRAINTS_H
+
+#include <vector>
+#include "../core/PointMass.h"
+
+// Rest-state data for the triangle cloth model, stored flat and indexed by
+// point mass slot in the owning simulation.
+struct TriangleConstraints {
+    std::vector<int> areaVertices;   // 3 per triangle
+    std::vector<float> restAreas;
+    std::vector<int> bendVertices;   // 4 per hinge: shared edge (a, b), opposite (c, d)
+    std::vector<float> restAngles;
+
+    void addTriangle(const std::vector<PointMass*>& pointMasses, int a, int b, int c);
+    void addHinge(const std::vector<PointMass*>& pointMasses, int a, int b, int c, int d);
+    void clear();
+    [[nodiscard]] bool empty() const { return restAreas.empty() && restAngles.empty(); }
+};
+
+// Per-island copy of the constraints in island-local vertex numbering, laid out as
+// structure-of-arrays so the projection kernels run over plain float arrays.
+struct ConstraintBatch {
+    std::vector<PointMass*> vertices;
+    std::vector<int> areaA, areaB, areaC;
+    std::vector<float> restAreas;
+    std::vector<int> bendA, bendB, bendC, bendD;
+    std::vector<float> restAngles;
+
+    // Scratch buffers reused every substep
+    std::vector<float> x, y, z, invMass;
+    std::vector<float> dx, dy, dz, count;
+    std::vector<float> areaDelta, bendDelta;
+
+    void clear();
+    [[nodiscard]] bool empty() const { return restAreas.empty() && restAngles.empty(); }
+};
+
+// One Jacobi pass of area and dihedral bending projection. Position corrections are
+// written back to the point masses and folded into their velocities.
+void projectTriangleConstraints(ConstraintBatch& batch, float dt, float areaStiffness, float bendStiffness);
+
+#endif //PBD_X_TRIANGLECONSTRAINTS_H
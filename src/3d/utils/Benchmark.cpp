@@ -0,0 +1,333 @@
+#include "Benchmark.h"
+#include "MeshLoader.h"
+#include "SceneLoader.h"
+#include "../simulation/BatchedSimulation.h"
+#include "../simulation/MultigridSolver.h"
+#include "../simulation/Simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <random>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+struct Sample {
+    double ms;
+    float residual;
+};
+
+// Run solver rounds from the same start state until the residual target or the time
+// budget is reached
+std::vector<Sample> converge(MultigridSolver& solver, const std::vector<PointMass*>& pointMasses,
+                             const std::vector<Vector3D>& start, int smoothing, float maxStretch,
+                             float target, double budgetMs) {
+    for (size_t i = 0; i < pointMasses.size(); ++i) {
+        pointMasses[i]->setPosition(start[i]);
+    }
+
+    std::vector<Sample> samples;
+    samples.push_back({0.0, solver.residual(maxStretch)});
+    double elapsed = 0.0;
+    while (elapsed < budgetMs && samples.back().residual > target) {
+        auto t0 = std::chrono::steady_clock::now();
+        solver.solve(1.0f / 60.0f, maxStretch, 1, smoothing);
+        elapsed += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        samples.push_back({elapsed, solver.residual(maxStretch)});
+    }
+    return samples;
+}
+
+double timeToReach(const std::vector<Sample>& samples, float residual) {
+    for (const Sample& s : samples) {
+        if (s.residual <= residual) return s.ms;
+    }
+    return -1.0;
+}
+
+// Fully associative LRU cache of 64-byte lines, fed with the addresses a kernel
+// touches, as a portable stand-in for hardware miss counters
+class CacheModel {
+public:
+    explicit CacheModel(size_t bytes) : capacity(bytes / LINE) {}
+
+    void touch(const void* address, size_t size) {
+        auto first = (uintptr_t)address / LINE, last = ((uintptr_t)address + size - 1) / LINE;
+        for (uintptr_t line = first; line <= last; ++line) {
+            ++accesses;
+            auto it = lookup.find(line);
+            if (it != lookup.end()) {
+                lru.splice(lru.begin(), lru, it->second);
+                continue;
+            }
+            ++misses;
+            lru.push_front(line);
+            lookup[line] = lru.begin();
+            if (lru.size() > capacity) {
+                lookup.erase(lru.back());
+                lru.pop_back();
+            }
+        }
+    }
+
+    long long accesses{0};
+    long long misses{0};
+
+private:
+    static constexpr size_t LINE = 64;
+    size_t capacity;
+    std::list<uintptr_t> lru;
+    std::unordered_map<uintptr_t, std::list<uintptr_t>::iterator> lookup;
+};
+
+// Wavy size x size sheet with its vertices numbered in random order, as an
+// importer with no locality would leave them
+MeshData shuffledSheet(int size) {
+    std::vector<int> number(size * size);
+    for (int i = 0; i < size * size; ++i) number[i] = i;
+    std::shuffle(number.begin(), number.end(), std::mt19937(1234));
+
+    MeshData mesh;
+    mesh.positions.resize(3 * size * size);
+    for (int y = 0; y < size; ++y) {
+        for (int x = 0; x < size; ++x) {
+            float* p = &mesh.positions[3 * number[y * size + x]];
+            p[0] = (float)x / size;
+            p[1] = 0.05f * std::sin(10.0f * (float)(x + y) / size);
+            p[2] = (float)y / size;
+        }
+    }
+    for (int y = 0; y + 1 < size; ++y) {
+        for (int x = 0; x + 1 < size; ++x) {
+            int a = number[y * size + x], b = number[y * size + x + 1];
+            int c = number[(y + 1) * size + x], d = number[(y + 1) * size + x + 1];
+            mesh.triangles.insert(mesh.triangles.end(), {a, b, d, a, d, c});
+        }
+    }
+    MeshLoader::buildEdges(mesh);
+    return mesh;
+}
+
+} // namespace
+
+void Benchmark::multigrid(std::ostream& out, int size) {
+    const float maxStretch = 0.01f;
+    const float target = 1e-3f;
+    const double budgetMs = 10000.0;
+
+    Simulation sim;
+    sim.createCloth(0.0f, 0.0f, 0.0f, size, size, 0.01f);
+    const auto& pointMasses = sim.getPointMasses();
+
+    // Hang the cloth below its pinned row, stretched half again along its height
+    std::vector<Vector3D> start;
+    start.reserve(pointMasses.size());
+    for (PointMass* pm : pointMasses) {
+        auto pos = pm->getPosition();
+        start.emplace_back(pos.x, -1.5f * pos.y, pos.z);
+    }
+
+    MultigridSolver flat;
+    flat.buildGrid(pointMasses, sim.getSprings(), size, size, 1);
+    MultigridSolver hierarchy;
+    hierarchy.buildGrid(pointMasses, sim.getSprings(), size, size, 16);
+
+    out << "Strain limiting convergence, " << size << "x" << size << " cloth, "
+        << hierarchy.levelCount() << " multigrid levels" << std::endl;
+    auto flatSamples = converge(flat, pointMasses, start, 4, maxStretch, target, budgetMs);
+    auto mgSamples = converge(hierarchy, pointMasses, start, 2, maxStretch, target, budgetMs);
+
+    out << "solver,round,ms,residual" << std::endl;
+    for (size_t i = 0; i < flatSamples.size(); i += std::max<size_t>(1, flatSamples.size() / 20)) {
+        out << "flat," << i << "," << flatSamples[i].ms << "," << flatSamples[i].residual << std::endl;
+    }
+    for (size_t i = 0; i < mgSamples.size(); i += std::max<size_t>(1, mgSamples.size() / 20)) {
+        out << "multigrid," << i << "," << mgSamples[i].ms << "," << mgSamples[i].residual << std::endl;
+    }
+
+    for (float residual : {1e-1f, 1e-2f, 1e-3f}) {
+        double flatMs = timeToReach(flatSamples, residual);
+        double mgMs = timeToReach(mgSamples, residual);
+        out << "time to residual " << residual << ": flat ";
+        if (flatMs < 0) out << "> " << budgetMs; else out << flatMs;
+        out << " ms, multigrid ";
+        if (mgMs < 0) out << "> " << budgetMs; else out << mgMs;
+        out << " ms" << std::endl;
+    }
+}
+
+void Benchmark::scene(std::ostream& out, const std::string& path) {
+    Simulation sim;
+    auto t0 = std::chrono::steady_clock::now();
+    SceneSettings settings = SceneLoader::load(path, sim);
+    double loadMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    out << path << ": " << sim.getPointMasses().size() << " point masses, " << sim.getSprings().size()
+        << " springs, loaded in " << loadMs << " ms" << std::endl;
+
+    double totalMs = 0.0, worstMs = 0.0;
+    for (int frame = 0; frame < settings.frames; ++frame) {
+        t0 = std::chrono::steady_clock::now();
+        sim.applyGlobalForce(settings.gravity);
+        if (settings.windEnabled) sim.applyGlobalForce(settings.wind);
+        sim.update(settings.frameTime);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        totalMs += ms;
+        worstMs = std::max(worstMs, ms);
+    }
+    out << settings.frames << " frames: " << (settings.frames > 0 ? totalMs / settings.frames : 0.0)
+        << " ms/frame average, " << worstMs << " ms worst, " << sim.getAwakeIslandCount() << " of "
+        << sim.getIslands().size() << " islands awake at the end" << std::endl;
+}
+
+void Benchmark::batched(std::ostream& out, int variants) {
+    const int frames = 300;
+    const float frameTime = 1.0f / 60.0f;
+    const Vector3D gravity(0.0f, -9.81f, 0.0f);
+    auto stiffnessScale = [](int v) { return 0.5f + 0.01f * (float)(v % 100); };
+    auto dampingScale = [](int v) { return 0.5f + 0.05f * (float)(v % 20); };
+    auto restitution = [](int v) { return 0.2f + 0.1f * (float)(v % 7); };
+
+    auto build = [&](Simulation& sim, int v) {
+        Material cloth;
+        cloth.stiffness *= stiffnessScale(v);
+        cloth.shearStiffness *= stiffnessScale(v);
+        cloth.bendStiffness *= stiffnessScale(v);
+        cloth.damping *= dampingScale(v);
+        Material rope = Material::rope();
+        rope.stiffness *= stiffnessScale(v);
+        rope.shearStiffness *= stiffnessScale(v);
+        rope.bendStiffness *= stiffnessScale(v);
+        rope.damping *= dampingScale(v);
+        sim.setSleepingEnabled(false);
+        sim.setRestitution(restitution(v));
+        sim.createCloth(0, 2, 0, 8, 8, 0.2f, cloth);
+        sim.createRope(3, 0, 0, 10, 0.15f, rope);
+    };
+
+    std::vector<std::vector<Vector3D>> reference(variants);
+    auto t0 = std::chrono::steady_clock::now();
+    for (int v = 0; v < variants; ++v) {
+        Simulation sim;
+        build(sim, v);
+        for (int frame = 0; frame < frames; ++frame) {
+            sim.applyGlobalForce(gravity);
+            sim.update(frameTime);
+        }
+        for (PointMass* pm : sim.getPointMasses()) reference[v].push_back(pm->getPosition());
+    }
+    double scalarMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    // The prototype carries the unscaled materials the per variant scales apply to
+    Simulation prototype;
+    prototype.createCloth(0, 2, 0, 8, 8, 0.2f);
+    prototype.createRope(3, 0, 0, 10, 0.15f);
+    t0 = std::chrono::steady_clock::now();
+    BatchedSimulation batch(prototype, variants);
+    for (int v = 0; v < variants; ++v) {
+        batch.setStiffnessScale(v, stiffnessScale(v));
+        batch.setDampingScale(v, dampingScale(v));
+        batch.setRestitution(v, restitution(v));
+    }
+    for (int frame = 0; frame < frames; ++frame) {
+        batch.applyGlobalForce(gravity);
+        batch.update(frameTime);
+    }
+    double batchedMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+    float maxDifference = 0.0f;
+    for (int v = 0; v < variants; ++v) {
+        for (int i = 0; i < batch.getNodeCount(); ++i) {
+            maxDifference = std::max(maxDifference, Vector3D::distance(reference[v][i], batch.getPosition(v, i)));
+        }
+    }
+
+    out << variants << " variants x " << frames << " frames of an 8x8 cloth and 10 node rope" << std::endl;
+    out << "  one Simulation each:  " << scalarMs << " ms" << std::endl;
+    out << "  BatchedSimulation:    " << batchedMs << " ms (" << BatchedSimulation::LANES << " lanes, "
+        << scalarMs / batchedMs << "x)" << std::endl;
+    out << "  largest position difference: " << maxDifference << std::endl;
+}
+
+void Benchmark::collisions(std::ostream& out, int size) {
+    const int frames = 120;
+    out << size << "x" << size << " hanging cloth, " << frames << " frames" << std::endl;
+    out << "ccd,ms/frame,refit ms/frame,traversal ms/frame,narrowphase ms/frame,contacts/frame" << std::endl;
+    for (bool ccd : {false, true}) {
+        Simulation sim;
+        sim.setContinuousCollisionEnabled(ccd);
+        sim.createCloth(0.0f, 0.0f, 0.0f, size, size, 0.05f);
+        // Pinned along its first row, so it swings down and folds against itself
+        for (int x = 0; x < size; ++x) sim.setFixed(sim.getPointMasses()[x], true);
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            sim.applyGlobalForce(Vector3D(0.0f, -9.81f, 0.0f));
+            sim.update(1.0f / 60.0f);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+
+        const CollisionStats& stats = sim.getCollisionStats();
+        out << (ccd ? "on," : "off,") << ms / frames << "," << stats.refitMs / frames << ","
+            << stats.traversalMs / frames << "," << stats.narrowphaseMs / frames << ","
+            << (double)(stats.pointTriangleContacts + stats.edgeEdgeContacts) / frames << std::endl;
+    }
+}
+
+void Benchmark::reorder(std::ostream& out, const std::string& meshPath, int size) {
+    MeshData mesh = meshPath.empty() ? shuffledSheet(size) : MeshLoader::load(meshPath);
+    const int frames = 60;
+    out << (meshPath.empty() ? "shuffled sheet" : meshPath) << ": " << mesh.vertexCount() << " vertices, "
+        << mesh.triangleCount() << " triangles" << std::endl;
+    out << "order,mean spring span,L1 misses/spring,L2 misses/spring,ms/substep" << std::endl;
+
+    const char* names[] = {"import", "morton", "hilbert"};
+    for (int variant = 0; variant < 3; ++variant) {
+        Simulation sim;
+        sim.setSleepingEnabled(false);
+        sim.setFloorEnabled(false);
+        sim.createMesh(mesh, 0.0f, 0.0f, 0.0f);
+        if (variant == 1) sim.reorderSpatially(SpaceFillingCurve::Morton);
+        if (variant == 2) sim.reorderSpatially(SpaceFillingCurve::Hilbert);
+
+        const auto& pointMasses = sim.getPointMasses();
+        std::unordered_map<const PointMass*, int> slot;
+        for (size_t i = 0; i < pointMasses.size(); ++i) slot[pointMasses[i]] = (int)i;
+        double span = 0.0;
+        for (const Spring* spring : sim.getSprings()) {
+            span += std::abs(slot[spring->getPointMass1()] - slot[spring->getPointMass2()]);
+        }
+
+        // Replay one substep's memory traffic: the spring pass, then the particle pass
+        CacheModel l1(32 * 1024), l2(1024 * 1024);
+        auto touch = [&](const void* address, size_t bytes) {
+            l1.touch(address, bytes);
+            l2.touch(address, bytes);
+        };
+        for (int pass = 0; pass < 2; ++pass) {
+            for (const Spring* spring : sim.getSprings()) {
+                touch(spring, sizeof(Spring));
+                touch(spring->getPointMass1(), sizeof(PointMass));
+                touch(spring->getPointMass2(), sizeof(PointMass));
+            }
+            for (const PointMass* pm : pointMasses) touch(pm, sizeof(PointMass));
+            // Warm-up pass; count the second
+            if (pass == 0) l1.misses = l2.misses = 0;
+        }
+
+        auto t0 = std::chrono::steady_clock::now();
+        for (int frame = 0; frame < frames; ++frame) {
+            sim.applyGlobalForce(Vector3D(0.0f, -9.81f, 0.0f));
+            sim.update(1.0f / 60.0f);
+        }
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+        int substeps = std::max(1, frames * sim.getStepStats().substeps);
+
+        const double springCount = std::max<size_t>(1, sim.getSprings().size());
+        out << names[variant] << "," << span / springCount << "," << l1.misses / springCount << ","
+            << l2.misses / springCount << "," << ms / substeps << std::endl;
+    }
+}
@@ -0,0 +1,26 @@
+#ifndef PBD_X_BENCHMARK_H
+#define PBD_X_BENCHMARK_H
+
+#include <ostream>
+#include <string>
+
+// Headless benchmarks, run from the command line with --bench <name>
+namespace Benchmark {
+    // Strain limiting on a size x size cloth hanging 50% overstretched: residual
+    // against wall time for flat Jacobi sweeps and for multigrid V-cycles
+    void multigrid(std::ostream& out, int size = 256);
+    // Load a scene file and time its run (frames and step from the scene's run line)
+    void scene(std::ostream& out, const std::string& path);
+    // The default cloth and rope scene in many variants: one Simulation per variant
+    // against BatchedSimulation, with the largest difference between the two
+    void batched(std::ostream& out, int variants = 1024);
+    // Spring index span, modeled cache misses and step time of a mesh in import order
+    // and after Morton and Hilbert reordering. Without a mesh file, a size x size
+    // sheet with randomly numbered vertices is used.
+    void reorder(std::ostream& out, const std::string& meshPath = "", int size = 256);
+    // A size x size cloth hanging from one row, with continuous collision off and
+    // on: time per frame and the refit, traversal and narrowphase share of it
+    void collisions(std::ostream& out, int size = 64);
+}
+
+#endif //PBD_X_BENCHMARK_H
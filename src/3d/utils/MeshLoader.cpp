@@ -0,0 +1,527 @@
+#include "MeshLoader.h"
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+#include <unordered_map>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    explicit MappedFile(const std::string& path) {
+#ifdef _WIN32
+        file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        if (file == INVALID_HANDLE_VALUE) throw std::runtime_error("Failed to open mesh file: " + path);
+        LARGE_INTEGER fileSize;
+        if (!GetFileSizeEx(file, &fileSize)) {
+            CloseHandle(file);
+            throw std::runtime_error("Failed to open mesh file: " + path);
+        }
+        length = (size_t)fileSize.QuadPart;
+        if (length == 0) return;
+        mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) bytes = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (!bytes) {
+            if (mapping) CloseHandle(mapping);
+            CloseHandle(file);
+            throw std::runtime_error("Failed to map mesh file: " + path);
+        }
+#else
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("Failed to open mesh file: " + path);
+        struct stat st{};
+        if (fstat(fd, &st) != 0) {
+            close(fd);
+            throw std::runtime_error("Failed to open mesh file: " + path);
+        }
+        length = (size_t)st.st_size;
+        if (length == 0) return;
+        void* p = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (p == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error("Failed to map mesh file: " + path);
+        }
+        bytes = (const char*)p;
+        madvise(p, length, MADV_SEQUENTIAL);
+#endif
+    }
+
+    ~MappedFile() {
+#ifdef _WIN32
+        if (bytes) UnmapViewOfFile(bytes);
+        if (mapping) CloseHandle(mapping);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        if (bytes) munmap((void*)bytes, length);
+        if (fd >= 0) close(fd);
+#endif
+    }
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    [[nodiscard]] const char* data() const { return bytes; }
+    [[nodiscard]] size_t size() const { return length; }
+
+private:
+    const char* bytes{nullptr};
+    size_t length{0};
+#ifdef _WIN32
+    HANDLE file{INVALID_HANDLE_VALUE};
+    HANDLE mapping{nullptr};
+#else
+    int fd{-1};
+#endif
+};
+
+inline const char* skipSpaces(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t' || *p == '\r')) ++p;
+    return p;
+}
+
+inline const char* nextLine(const char* p, const char* end) {
+    const char* nl = (const char*)std::memchr(p, '\n', end - p);
+    return nl ? nl + 1 : end;
+}
+
+// std::from_chars, which takes no leading '+' although exporters write one
+template <typename T>
+inline std::from_chars_result parseNumber(const char* p, const char* end, T& value) {
+    if (end - p > 1 && p[0] == '+' && p[1] != '-' && p[1] != '+') ++p;
+    return std::from_chars(p, end, value);
+}
+
+// Output of one OBJ chunk. Negative (relative) face indices cannot be resolved until
+// the vertex counts of earlier chunks are known, so they are stored chunk-local and
+// flagged in `relative`.
+struct ObjChunk {
+    std::vector<float> positions;
+    std::vector<int> triangles;
+    std::vector<uint8_t> relative;
+};
+
+void parseObjChunk(const char* p, const char* end, ObjChunk& out) {
+    // Reused across faces, so only the largest polygon of a chunk allocates
+    std::vector<int> polygon;
+    std::vector<uint8_t> polygonRelative;
+
+    while (p < end) {
+        const char* lineEnd = nextLine(p, end);
+        const char* q = skipSpaces(p, lineEnd);
+
+        if (q + 1 < lineEnd && q[0] == 'v' && (q[1] == ' ' || q[1] == '\t')) {
+            q += 2;
+            for (int i = 0; i < 3; ++i) {
+                q = skipSpaces(q, lineEnd);
+                float value = 0.0f;
+                auto result = parseNumber(q, lineEnd, value);
+                if (result.ec != std::errc()) throw std::runtime_error("Malformed OBJ vertex");
+                out.positions.push_back(value);
+                q = result.ptr;
+            }
+        } else if (q + 1 < lineEnd && q[0] == 'f' && (q[1] == ' ' || q[1] == '\t')) {
+            q += 2;
+            int localVertices = (int)(out.positions.size() / 3);
+            polygon.clear();
+            polygonRelative.clear();
+            while (true) {
+                q = skipSpaces(q, lineEnd);
+                if (q >= lineEnd || *q == '\n' || *q == '#') break;
+                int index = 0;
+                auto result = parseNumber(q, lineEnd, index);
+                if (result.ec != std::errc() || index == 0) throw std::runtime_error("Malformed OBJ face");
+                q = result.ptr;
+                // skip texture / normal references
+                while (q < lineEnd && *q != ' ' && *q != '\t' && *q != '\r' && *q != '\n') ++q;
+                polygonRelative.push_back(index < 0);
+                polygon.push_back((index > 0) ? index - 1 : localVertices + index);
+            }
+            // fan triangulation
+            const int count = (int)polygon.size();
+            for (int i = 1; i + 1 < count; ++i) {
+                for (int k : {0, i, i + 1}) {
+                    out.triangles.push_back(polygon[k]);
+                    out.relative.push_back(polygonRelative[k]);
+                }
+            }
+        }
+        p = lineEnd;
+    }
+}
+
+enum class PlyType { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64, Invalid };
+
+PlyType parsePlyType(const std::string& name) {
+    if (name == "char" || name == "int8") return PlyType::Int8;
+    if (name == "uchar" || name == "uint8") return PlyType::UInt8;
+    if (name == "short" || name == "int16") return PlyType::Int16;
+    if (name == "ushort" || name == "uint16") return PlyType::UInt16;
+    if (name == "int" || name == "int32") return PlyType::Int32;
+    if (name == "uint" || name == "uint32") return PlyType::UInt32;
+    if (name == "float" || name == "float32") return PlyType::Float32;
+    if (name == "double" || name == "float64") return PlyType::Float64;
+    return PlyType::Invalid;
+}
+
+size_t plyTypeSize(PlyType type) {
+    switch (type) {
+        case PlyType::Int8: case PlyType::UInt8: return 1;
+        case PlyType::Int16: case PlyType::UInt16: return 2;
+        case PlyType::Int32: case PlyType::UInt32: case PlyType::Float32: return 4;
+        case PlyType::Float64: return 8;
+        default: return 0;
+    }
+}
+
+double readPlyBinary(const char* p, PlyType type) {
+    switch (type) {
+        case PlyType::Int8: { int8_t v; std::memcpy(&v, p, 1); return v; }
+        case PlyType::UInt8: { uint8_t v; std::memcpy(&v, p, 1); return v; }
+        case PlyType::Int16: { int16_t v; std::memcpy(&v, p, 2); return v; }
+        case PlyType::UInt16: { uint16_t v; std::memcpy(&v, p, 2); return v; }
+        case PlyType::Int32: { int32_t v; std::memcpy(&v, p, 4); return v; }
+        case PlyType::UInt32: { uint32_t v; std::memcpy(&v, p, 4); return v; }
+        case PlyType::Float32: { float v; std::memcpy(&v, p, 4); return v; }
+        case PlyType::Float64: { double v; std::memcpy(&v, p, 8); return v; }
+        default: return 0.0;
+    }
+}
+
+struct PlyProperty {
+    std::string name;
+    PlyType type{PlyType::Invalid};
+    bool isList{false};
+    PlyType countType{PlyType::Invalid};
+};
+
+struct PlyElement {
+    std::string name;
+    size_t count{0};
+    std::vector<PlyProperty> properties;
+};
+
+} // namespace
+
+namespace MeshLoader {
+
+MeshData load(const std::string& path) {
+    auto dot = path.find_last_of('.');
+    std::string ext = (dot == std::string::npos) ? "" : path.substr(dot + 1);
+    std::transform(ext.begin(), ext.end(), ext.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+
+    if (ext == "obj") return loadOBJ(path);
+    if (ext == "ply") return loadPLY(path);
+    throw std::runtime_error("Unsupported mesh format: " + path);
+}
+
+MeshData loadOBJ(const std::string& path, int threads) {
+    MappedFile file(path);
+    const char* begin = file.data();
+    const char* end = begin + file.size();
+
+    if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+    // Small files are not worth the thread start-up
+    const size_t minChunk = 1 << 20;
+    threads = (int)std::max<size_t>(1, std::min<size_t>((size_t)threads, file.size() / minChunk));
+
+    // Split at line boundaries
+    std::vector<const char*> bounds{begin};
+    for (int i = 1; i < threads; ++i) {
+        const char* p = begin + file.size() * i / threads;
+        p = std::max(p, bounds.back());
+        bounds.push_back(p < end ? nextLine(p, end) : end);
+    }
+    bounds.push_back(end);
+
+    std::vector<ObjChunk> chunks(threads);
+    if (threads == 1) {
+        parseObjChunk(begin, end, chunks[0]);
+    } else {
+        std::vector<std::thread> workers;
+        std::vector<std::string> errors(threads);
+        for (int i = 0; i < threads; ++i) {
+            workers.emplace_back([&, i]() {
+                try {
+                    parseObjChunk(bounds[i], bounds[i + 1], chunks[i]);
+                } catch (const std::exception& e) {
+                    errors[i] = e.what();
+                }
+            });
+        }
+        for (auto& worker : workers) worker.join();
+        for (const auto& error : errors) {
+            if (!error.empty()) throw std::runtime_error(error + " in " + path);
+        }
+    }
+
+    MeshData mesh;
+    size_t totalPositions = 0, totalTriangles = 0;
+    for (const auto& chunk : chunks) {
+        totalPositions += chunk.positions.size();
+        totalTriangles += chunk.triangles.size();
+    }
+    mesh.positions.reserve(totalPositions);
+    mesh.triangles.reserve(totalTriangles);
+
+    int vertexOffset = 0;
+    for (const auto& chunk : chunks) {
+        mesh.positions.insert(mesh.positions.end(), chunk.positions.begin(), chunk.positions.end());
+        for (size_t i = 0; i < chunk.triangles.size(); ++i) {
+            mesh.triangles.push_back(chunk.relative[i] ? vertexOffset + chunk.triangles[i] : chunk.triangles[i]);
+        }
+        vertexOffset += (int)(chunk.positions.size() / 3);
+    }
+
+    for (int index : mesh.triangles) {
+        if (index < 0 || index >= vertexOffset) throw std::runtime_error("OBJ face index out of range in " + path);
+    }
+
+    weldVertices(mesh);
+    buildEdges(mesh);
+    return mesh;
+}
+
+MeshData loadPLY(const std::string& path) {
+    MappedFile file(path);
+    const char* p = file.data();
+    const char* end = p + file.size();
+
+    bool binary = false;
+    std::vector<PlyElement> elements;
+
+    // Header
+    if (file.size() < 3 || std::strncmp(p, "ply", 3) != 0) throw std::runtime_error("Not a PLY file: " + path);
+    while (true) {
+        if (p >= end) throw std::runtime_error("Truncated PLY header: " + path);
+        const char* lineEnd = nextLine(p, end);
+        std::string line(p, lineEnd);
+        while (!line.empty() && (line.back() == '\n' || line.back() == '\r')) line.pop_back();
+        p = lineEnd;
+
+        std::vector<std::string> tokens;
+        size_t pos = 0;
+        while (pos < line.size()) {
+            size_t next = line.find(' ', pos);
+            if (next == std::string::npos) next = line.size();
+            if (next > pos) tokens.push_back(line.substr(pos, next - pos));
+            pos = next + 1;
+        }
+        if (tokens.empty()) continue;
+
+        if (tokens[0] == "end_header") break;
+        if (tokens[0] == "format" && tokens.size() > 1) {
+            if (tokens[1] == "binary_little_endian") binary = true;
+            else if (tokens[1] != "ascii") throw std::runtime_error("Unsupported PLY format " + tokens[1] + ": " + path);
+        } else if (tokens[0] == "element" && tokens.size() > 2) {
+            PlyElement element;
+            element.name = tokens[1];
+            element.count = std::stoull(tokens[2]);
+            elements.push_back(element);
+        } else if (tokens[0] == "property" && !elements.empty()) {
+            PlyProperty property;
+            if (tokens.size() > 4 && tokens[1] == "list") {
+                property.isList = true;
+                property.countType = parsePlyType(tokens[2]);
+                property.type = parsePlyType(tokens[3]);
+                property.name = tokens[4];
+            } else if (tokens.size() > 2) {
+                property.type = parsePlyType(tokens[1]);
+                property.name = tokens[2];
+            }
+            if (property.type == PlyType::Invalid) throw std::runtime_error("Unsupported PLY property type: " + path);
+            elements.back().properties.push_back(property);
+        }
+    }
+
+    MeshData mesh;
+    std::vector<int> polygon;
+
+    for (const PlyElement& element : elements) {
+        const bool isVertex = element.name == "vertex";
+        const bool isFace = element.name == "face";
+        if (isVertex) mesh.positions.reserve(element.count * 3);
+        if (isFace) mesh.triangles.reserve(element.count * 3);
+
+        for (size_t e = 0; e < element.count; ++e) {
+            float xyz[3] = {0.0f, 0.0f, 0.0f};
+            polygon.clear();
+
+            for (const PlyProperty& property : element.properties) {
+                size_t n = 1;
+                if (property.isList) {
+                    double count = 0.0;
+                    if (binary) {
+                        size_t size = plyTypeSize(property.countType);
+                        if (p + size > end) throw std::runtime_error("Truncated PLY data: " + path);
+                        count = readPlyBinary(p, property.countType);
+                        p += size;
+                    } else {
+                        p = skipSpaces(p, end);
+                        while (p < end && *p == '\n') p = skipSpaces(p + 1, end);
+                        auto result = parseNumber(p, end, count);
+                        if (result.ec != std::errc()) throw std::runtime_error("Malformed PLY data: " + path);
+                        p = result.ptr;
+                    }
+                    n = (size_t)count;
+                }
+
+                for (size_t k = 0; k < n; ++k) {
+                    double value = 0.0;
+                    if (binary) {
+                        size_t size = plyTypeSize(property.type);
+                        if (p + size > end) throw std::runtime_error("Truncated PLY data: " + path);
+                        value = readPlyBinary(p, property.type);
+                        p += size;
+                    } else {
+                        p = skipSpaces(p, end);
+                        while (p < end && *p == '\n') p = skipSpaces(p + 1, end);
+                        auto result = parseNumber(p, end, value);
+                        if (result.ec != std::errc()) throw std::runtime_error("Malformed PLY data: " + path);
+                        p = result.ptr;
+                    }
+
+                    if (isVertex && !property.isList) {
+                        if (property.name == "x") xyz[0] = (float)value;
+                        else if (property.name == "y") xyz[1] = (float)value;
+                        else if (property.name == "z") xyz[2] = (float)value;
+                    } else if (isFace && property.isList &&
+                               (property.name == "vertex_indices" || property.name == "vertex_index")) {
+                        polygon.push_back((int)value);
+                    }
+                }
+            }
+
+            if (isVertex) {
+                mesh.positions.push_back(xyz[0]);
+                mesh.positions.push_back(xyz[1]);
+                mesh.positions.push_back(xyz[2]);
+            } else if (isFace) {
+                for (size_t i = 1; i + 1 < polygon.size(); ++i) {
+                    mesh.triangles.push_back(polygon[0]);
+                    mesh.triangles.push_back(polygon[i]);
+                    mesh.triangles.push_back(polygon[i + 1]);
+                }
+            }
+        }
+    }
+
+    int vertices = mesh.vertexCount();
+    for (int index : mesh.triangles) {
+        if (index < 0 || index >= vertices) throw std::runtime_error("PLY face index out of range in " + path);
+    }
+
+    weldVertices(mesh);
+    buildEdges(mesh);
+    return mesh;
+}
+
+void weldVertices(MeshData& mesh) {
+    struct Key {
+        uint32_t x, y, z;
+        bool operator==(const Key& o) const { return x == o.x && y == o.y && z == o.z; }
+    };
+    struct KeyHash {
+        size_t operator()(const Key& k) const {
+            return ((size_t)k.x * 73856093u) ^ ((size_t)k.y * 19349663u) ^ ((size_t)k.z * 83492791u);
+        }
+    };
+
+    const int n = mesh.vertexCount();
+    std::unordered_map<Key, int, KeyHash> unique;
+    unique.reserve(n);
+    std::vector<int> remap(n);
+    std::vector<float> welded;
+    welded.reserve(mesh.positions.size());
+
+    for (int i = 0; i < n; ++i) {
+        Key key{};
+        // +0.0f folds -0.0 into 0.0 so both hash alike
+        float x = mesh.positions[i * 3] + 0.0f, y = mesh.positions[i * 3 + 1] + 0.0f, z = mesh.positions[i * 3 + 2] + 0.0f;
+        std::memcpy(&key.x, &x, 4);
+        std::memcpy(&key.y, &y, 4);
+        std::memcpy(&key.z, &z, 4);
+        auto inserted = unique.emplace(key, (int)(welded.size() / 3));
+        if (inserted.second) {
+            welded.push_back(x);
+            welded.push_back(y);
+            welded.push_back(z);
+        }
+        remap[i] = inserted.first->second;
+    }
+
+    size_t out = 0;
+    for (size_t t = 0; t + 2 < mesh.triangles.size(); t += 3) {
+        int a = remap[mesh.triangles[t]], b = remap[mesh.triangles[t + 1]], c = remap[mesh.triangles[t + 2]];
+        if (a == b || b == c || a == c) continue;
+        mesh.triangles[out++] = a;
+        mesh.triangles[out++] = b;
+        mesh.triangles[out++] = c;
+    }
+    mesh.triangles.resize(out);
+    mesh.positions.swap(welded);
+}
+
+void buildEdges(MeshData& mesh) {
+    // Each triangle contributes its three edges tagged with the opposite vertex; after
+    // sorting, edges shared by two triangles yield a bending pair between the opposites
+    struct HalfEdge {
+        uint64_t key;
+        int opposite;
+    };
+
+    const size_t triangleCount = mesh.triangles.size() / 3;
+    std::vector<HalfEdge> halfEdges;
+    halfEdges.reserve(triangleCount * 3);
+    for (size_t t = 0; t < triangleCount; ++t) {
+        const int* tri = &mesh.triangles[t * 3];
+        for (int i = 0; i < 3; ++i) {
+            uint32_t a = (uint32_t)tri[i], b = (uint32_t)tri[(i + 1) % 3];
+            if (a > b) std::swap(a, b);
+            halfEdges.push_back({((uint64_t)a << 32) | b, tri[(i + 2) % 3]});
+        }
+    }
+
+    std::sort(halfEdges.begin(), halfEdges.end(), [](const HalfEdge& l, const HalfEdge& r) {
+        return l.key < r.key;
+    });
+
+    mesh.edges.clear();
+    mesh.bendEdges.clear();
+    mesh.hinges.clear();
+    mesh.edges.reserve(halfEdges.size());
+    mesh.bendEdges.reserve(halfEdges.size());
+    mesh.hinges.reserve(halfEdges.size() * 2);
+
+    for (size_t i = 0; i < halfEdges.size();) {
+        size_t j = i + 1;
+        while (j < halfEdges.size() && halfEdges[j].key == halfEdges[i].key) ++j;
+
+        int a = (int)(halfEdges[i].key >> 32);
+        int b = (int)(halfEdges[i].key & 0xffffffffu);
+        mesh.edges.push_back(a);
+        mesh.edges.push_back(b);
+        if (j - i == 2 && halfEdges[i].opposite != halfEdges[i + 1].opposite) {
+            mesh.bendEdges.push_back(halfEdges[i].opposite);
+            mesh.bendEdges.push_back(halfEdges[i + 1].opposite);
+            mesh.hinges.insert(mesh.hinges.end(), {a, b, halfEdges[i].opposite, halfEdges[i + 1].opposite});
+        }
+        i = j;
+    }
+}
+
+} // namespace MeshLoader
@@ -0,0 +1,35 @@
+#ifndef PBD_X_MESHLOADER_H
+#define PBD_X_MESHLOADER_H
+
+#include <string>
+#include <vector>
+
+// Flat triangle mesh ready to be turned into point masses and springs
+struct MeshData {
+    std::vector<float> positions;   // x, y, z per vertex
+    std::vector<int> triangles;     // 3 vertex indices per triangle
+    std::vector<int> edges;         // 2 vertex indices per structural edge
+    std::vector<int> bendEdges;     // 2 vertex indices opposite each interior edge
+    std::vector<int> hinges;        // 4 per interior edge: the edge, then its opposite vertices
+
+    [[nodiscard]] int vertexCount() const { return (int)(positions.size() / 3); }
+    [[nodiscard]] int triangleCount() const { return (int)(triangles.size() / 3); }
+};
+
+namespace MeshLoader {
+    // Load a .obj or .ply file (chosen by extension), weld duplicate vertices and
+    // generate structural and bending edges. Throws std::runtime_error on failure.
+    MeshData load(const std::string& path);
+
+    // OBJ is parsed in parallel chunks; threads <= 0 uses all hardware threads
+    MeshData loadOBJ(const std::string& path, int threads = 0);
+    // Supports ascii and binary_little_endian PLY
+    MeshData loadPLY(const std::string& path);
+
+    // Merge vertices with identical positions and drop triangles that collapse
+    void weldVertices(MeshData& mesh);
+    // Fill edges, bendEdges and hinges from the triangle list
+    void buildEdges(MeshData& mesh);
+}
+
+#endif //PBD_X_MESHLOADER_H
@@ -0,0 +1,106 @@
+#ifndef PBD_X_PARALLEL_H
+#define PBD_X_PARALLEL_H
+
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Parallel {
+    // Set on forEachStealing workers, whose tasks are already one per core, so nested
+    // forRange calls run inline instead of oversubscribing
+    inline thread_local bool insideWorker = false;
+
+    // Split [0, count) into contiguous ranges and call fn(begin, end) on each, one range
+    // per hardware thread. Ranges smaller than minPerThread run inline on the caller.
+    template <typename Fn>
+    void forRange(int count, int minPerThread, Fn&& fn) {
+        int threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        threads = std::min(threads, count / std::max(1, minPerThread));
+        if (threads <= 1 || insideWorker) {
+            if (count > 0) fn(0, count);
+            return;
+        }
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (int t = 1; t < threads; ++t) {
+            int begin = (int)((long long)count * t / threads);
+            int end = (int)((long long)count * (t + 1) / threads);
+            workers.emplace_back([&fn, begin, end]() { fn(begin, end); });
+        }
+        fn(0, (int)((long long)count / threads));
+        for (auto& worker : workers) worker.join();
+    }
+
+    // Call fn(index) for every index in [0, count) on up to threads workers (0 means one
+    // per hardware thread). Each worker starts on its own contiguous block of indices and
+    // takes from its front; a worker that runs dry steals from the back of the fullest
+    // remaining block. Meant for coarse tasks of uneven cost, such as whole simulations.
+    template <typename Fn>
+    void forEachStealing(int count, int threads, Fn&& fn) {
+        if (threads <= 0) threads = (int)std::max(1u, std::thread::hardware_concurrency());
+        threads = std::max(1, std::min(threads, count));
+        if (count <= 0) return;
+
+        struct Queue {
+            std::mutex mutex;
+            std::deque<int> tasks;
+        };
+        std::vector<std::unique_ptr<Queue>> queues;
+        for (int t = 0; t < threads; ++t) {
+            queues.push_back(std::make_unique<Queue>());
+            int begin = (int)((long long)count * t / threads);
+            int end = (int)((long long)count * (t + 1) / threads);
+            for (int i = begin; i < end; ++i) queues[t]->tasks.push_back(i);
+        }
+
+        auto next = [&queues, threads](int self, int& task) {
+            {
+                std::lock_guard<std::mutex> lock(queues[self]->mutex);
+                if (!queues[self]->tasks.empty()) {
+                    task = queues[self]->tasks.front();
+                    queues[self]->tasks.pop_front();
+                    return true;
+                }
+            }
+            // Tasks are never added, so a full scan that finds nothing means we are done
+            while (true) {
+                int victim = -1;
+                size_t most = 0;
+                for (int t = 0; t < threads; ++t) {
+                    std::lock_guard<std::mutex> lock(queues[t]->mutex);
+                    if (queues[t]->tasks.size() > most) {
+                        most = queues[t]->tasks.size();
+                        victim = t;
+                    }
+                }
+                if (victim < 0) return false;
+                std::lock_guard<std::mutex> lock(queues[victim]->mutex);
+                if (queues[victim]->tasks.empty()) continue;
+                task = queues[victim]->tasks.back();
+                queues[victim]->tasks.pop_back();
+                return true;
+            }
+        };
+        auto work = [&fn, &next](int self) {
+            bool wasInside = insideWorker;
+            insideWorker = true;
+            int task;
+            while (next(self, task)) fn(task);
+            insideWorker = wasInside;
+        };
+
+        std::vector<std::thread> workers;
+        workers.reserve(threads - 1);
+        for (int t = 1; t < threads; ++t) {
+            workers.emplace_back(work, t);
+        }
+        work(0);
+        for (auto& worker : workers) worker.join();
+    }
+}
+
+#endif //PBD_X_PARALLEL_H
@@ -0,0 +1,104 @@
+#include "ParameterSweep.h"
+#include "Parallel.h"
+#include "../simulation/Simulation.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <mutex>
+
+ParameterSweep::ParameterSweep(std::shared_ptr<const ParsedScene> scene) : scene(std::move(scene)) {
+}
+
+void ParameterSweep::addGrid(const std::vector<float>& stiffnessScales, const std::vector<float>& dampingScales,
+                             const std::vector<float>& restitutions) {
+    for (float stiffness : stiffnessScales) {
+        for (float damping : dampingScales) {
+            for (float restitution : restitutions) {
+                SceneOverrides overrides;
+                overrides.stiffnessScale = stiffness;
+                overrides.dampingScale = damping;
+                overrides.restitution = restitution;
+                variants.push_back(overrides);
+            }
+        }
+    }
+}
+
+std::vector<SweepResult> ParameterSweep::run(std::ostream& out, int threads) const {
+    std::vector<SweepResult> results(variants.size());
+    std::vector<char> finished(variants.size(), 0);
+    size_t written = 0;
+    std::mutex outputMutex;
+
+    writeHeader(out);
+    Parallel::forEachStealing((int)variants.size(), threads, [&](int index) {
+        SweepResult result = runVariant(index);
+
+        std::lock_guard<std::mutex> lock(outputMutex);
+        results[index] = result;
+        finished[index] = 1;
+        while (written < variants.size() && finished[written]) {
+            write(out, results[written]);
+            ++written;
+        }
+        out.flush();
+    });
+    return results;
+}
+
+SweepResult ParameterSweep::runVariant(int index) const {
+    SweepResult result;
+    result.variant = index;
+    result.overrides = variants[index];
+
+    auto t0 = std::chrono::steady_clock::now();
+    Simulation sim;
+    SceneSettings settings = SceneLoader::build(*scene, sim, variants[index]);
+
+    // Stability comes from the diagnostics reduced inside the step, not a pass per frame
+    sim.setDiagnosticsEnabled(true);
+    const auto& pointMasses = sim.getPointMasses();
+    for (int frame = 0; frame < settings.frames && result.stable; ++frame) {
+        sim.applyGlobalForce(settings.gravity);
+        if (settings.windEnabled) sim.applyGlobalForce(settings.wind);
+        sim.update(settings.frameTime);
+        const StepStats& stats = sim.getStepStats();
+        result.frames = frame + 1;
+        result.substeps += stats.islandSubsteps;
+        result.tornSprings += stats.tornSprings;
+        result.stable = !stats.blowUp && stats.diagnostics.maxSpeed <= speedLimit;
+    }
+
+    double energy = 0.0, height = 0.0;
+    float lowest = pointMasses.empty() ? 0.0f : pointMasses[0]->getPosition().y;
+    for (PointMass* pm : pointMasses) {
+        Vector3D v = pm->getVelocity();
+        energy += 0.5 * pm->getMass() * v.dot(v);
+        height += pm->getPosition().y;
+        lowest = std::min(lowest, pm->getPosition().y);
+    }
+    float maxStrain = 0.0f;
+    for (Spring* spring : sim.getSprings()) {
+        if (spring->getRestLength() > 0.0f) {
+            maxStrain = std::max(maxStrain, spring->getCurrentLength() / spring->getRestLength() - 1.0f);
+        }
+    }
+    result.kineticEnergy = (float)energy;
+    result.meanHeight = pointMasses.empty() ? 0.0f : (float)(height / pointMasses.size());
+    result.lowestPoint = lowest;
+    result.maxStrain = maxStrain;
+    result.wallMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count();
+    return result;
+}
+
+void ParameterSweep::writeHeader(std::ostream& out) {
+    out << "variant,stiffness_scale,damping_scale,restitution,frames,substeps,torn_springs,"
+           "kinetic_energy,max_strain,mean_height,lowest_point,stable,wall_ms\n";
+}
+
+void ParameterSweep::write(std::ostream& out, const SweepResult& r) {
+    out << r.variant << ',' << r.overrides.stiffnessScale << ',' << r.overrides.dampingScale << ','
+        << r.overrides.restitution << ',' << r.frames << ',' << r.substeps << ',' << r.tornSprings << ','
+        << r.kineticEnergy << ',' << r.maxStrain << ',' << r.meanHeight << ',' << r.lowestPoint << ','
+        << (r.stable ? 1 : 0) << ',' << r.wallMs << '\n';
+}
@@ -0,0 +1,59 @@
+#ifndef PBD_X_PARAMETERSWEEP_H
+#define PBD_X_PARAMETERSWEEP_H
+
+#include <memory>
+#include <ostream>
+#include <vector>
+#include "SceneLoader.h"
+
+// Metrics of one finished variant
+struct SweepResult {
+    int variant{0};
+    SceneOverrides overrides;
+    double wallMs{0.0};
+    int frames{0};
+    // Island substeps summed over the run, the integration cost
+    long long substeps{0};
+    int tornSprings{0};
+    // State at the end of the run
+    float kineticEnergy{0.0f};
+    float maxStrain{0.0f};
+    float meanHeight{0.0f};
+    float lowestPoint{0.0f};
+    // False if the step diagnostics flagged a blow-up or a particle exceeded the speed
+    // limit; the variant stops at that frame
+    bool stable{true};
+};
+
+// Runs many variants of one scene in process. The scene is parsed once (meshes
+// included) and shared read-only by every variant, which only carries its own
+// SceneOverrides. Variants run one per core with work stealing, each building and
+// stepping a private Simulation, and their metrics are streamed to a single CSV in
+// variant order as soon as every earlier variant has finished.
+class ParameterSweep {
+public:
+    explicit ParameterSweep(std::shared_ptr<const ParsedScene> scene);
+
+    void addVariant(const SceneOverrides& overrides) { variants.push_back(overrides); }
+    // Every combination of the given values
+    void addGrid(const std::vector<float>& stiffnessScales, const std::vector<float>& dampingScales,
+                 const std::vector<float>& restitutions);
+    // Speed above which a variant counts as blown up
+    void setSpeedLimit(float limit) { speedLimit = limit; }
+
+    [[nodiscard]] size_t variantCount() const { return variants.size(); }
+
+    // threads = 0 uses every hardware thread
+    std::vector<SweepResult> run(std::ostream& out, int threads = 0) const;
+
+private:
+    [[nodiscard]] SweepResult runVariant(int index) const;
+    static void writeHeader(std::ostream& out);
+    static void write(std::ostream& out, const SweepResult& result);
+
+    std::shared_ptr<const ParsedScene> scene;
+    std::vector<SceneOverrides> variants;
+    float speedLimit{1000.0f};
+};
+
+#endif //PBD_X_PARAMETERSWEEP_H
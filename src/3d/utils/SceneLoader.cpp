@@ -0,0 +1,552 @@
+#include "SceneLoader.h"
+#include "MeshLoader.h"
+#include "../simulation/Simulation.h"
+#include <fstream>
+#include <functional>
+#include <map>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace {
+
+// One parsed line: command, optional positional word, then key=value options
+class Line {
+public:
+    Line(std::string source, int lineNumber) : source(std::move(source)), lineNumber(lineNumber) {}
+
+    [[noreturn]] void fail(const std::string& message) const {
+        throw std::runtime_error(source + ":" + std::to_string(lineNumber) + ": " + message);
+    }
+
+    void add(const std::string& token) {
+        auto eq = token.find('=');
+        if (eq == std::string::npos) {
+            if (!positional.empty()) fail("unexpected '" + token + "'");
+            positional = token;
+            return;
+        }
+        options[token.substr(0, eq)] = token.substr(eq + 1);
+    }
+
+    [[nodiscard]] bool has(const std::string& key) const { return options.count(key) != 0; }
+
+    std::string text(const std::string& key, const std::string& fallback) {
+        auto it = options.find(key);
+        if (it == options.end()) return fallback;
+        std::string value = it->second;
+        options.erase(it);
+        return value;
+    }
+
+    float number(const std::string& key, float fallback) {
+        if (!has(key)) return fallback;
+        std::string value = text(key, "");
+        try {
+            size_t used = 0;
+            float f = std::stof(value, &used);
+            if (used == value.size()) return f;
+        } catch (const std::exception&) {
+        }
+        fail("'" + key + "' expects a number, got '" + value + "'");
+    }
+
+    int integer(const std::string& key, int fallback) {
+        float f = number(key, (float)fallback);
+        if (f != (float)(int)f) fail("'" + key + "' expects an integer");
+        return (int)f;
+    }
+
+    bool flag(const std::string& key, bool fallback) {
+        if (!has(key)) return fallback;
+        std::string value = text(key, "");
+        if (value == "on" || value == "true" || value == "1") return true;
+        if (value == "off" || value == "false" || value == "0") return false;
+        fail("'" + key + "' expects on or off, got '" + value + "'");
+    }
+
+    std::vector<float> list(const std::string& key, size_t count, const std::vector<float>& fallback) {
+        if (!has(key)) return fallback;
+        std::string value = text(key, "");
+        std::vector<float> out;
+        std::stringstream ss(value);
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            try {
+                out.push_back(std::stof(item));
+            } catch (const std::exception&) {
+                fail("'" + key + "' has a bad component '" + item + "'");
+            }
+        }
+        if (out.size() != count) fail("'" + key + "' expects " + std::to_string(count) + " comma separated values");
+        return out;
+    }
+
+    Vector3D vec3(const std::string& key, const Vector3D& fallback) {
+        auto v = list(key, 3, {fallback.x, fallback.y, fallback.z});
+        return {v[0], v[1], v[2]};
+    }
+
+    // Every option has to be consumed, so typos are reported instead of ignored
+    void finish() const {
+        if (!options.empty()) fail("unknown option '" + options.begin()->first + "'");
+    }
+
+    std::string command;
+    std::string positional;
+
+private:
+    std::string source;
+    int lineNumber;
+    std::map<std::string, std::string> options;
+};
+
+enum class BodyType { Cloth, TriangleCloth, Rope, Mesh };
+
+struct Body {
+    BodyType type;
+    std::string name;
+    Material material;
+    Vector3D position;
+    int width{0}, height{0};
+    float spacing{0.1f};
+    float scale{1.0f};
+    bool triangleModel{false};
+    std::shared_ptr<MeshData> mesh;
+    int count{0};
+    // Body-local indices of the pinned vertices
+    std::vector<int> pins;
+    // Path the pins follow, or -1 to hold them still
+    int path{-1};
+};
+
+struct ExtraPin {
+    int body;
+    int vertex;
+    int path;
+};
+
+// time:x,y,z keys separated by semicolons
+KinematicPath parseKeys(const std::string& spec, const Line& line) {
+    KinematicPath path;
+    std::stringstream keys(spec);
+    std::string key;
+    while (std::getline(keys, key, ';')) {
+        auto colon = key.find(':');
+        if (colon == std::string::npos) line.fail("key '" + key + "' expects time:x,y,z");
+        std::vector<float> values;
+        std::stringstream ss(key.substr(0, colon) + "," + key.substr(colon + 1));
+        std::string item;
+        while (std::getline(ss, item, ',')) {
+            try {
+                values.push_back(std::stof(item));
+            } catch (const std::exception&) {
+                line.fail("key '" + key + "' has a bad component '" + item + "'");
+            }
+        }
+        if (values.size() != 4) line.fail("key '" + key + "' expects time:x,y,z");
+        path.times.push_back(values[0]);
+        path.positions.emplace_back(values[1], values[2], values[3]);
+    }
+    if (!path.isValid()) line.fail("keys must be given at increasing times");
+    return path;
+}
+
+std::vector<int> pinIndices(const Body& body, const std::string& spec, const Line& line) {
+    if (spec == "none") return {};
+    if (spec == "first") return {0};
+    if (spec == "last") return {body.count - 1};
+    if (spec == "corners") {
+        if (body.type == BodyType::Rope || body.type == BodyType::Mesh) return {0, body.count - 1};
+        return {0, body.width - 1};
+    }
+    if (spec == "row") {
+        std::vector<int> row;
+        for (int x = 0; x < body.width; ++x) row.push_back(x);
+        return row;
+    }
+
+    std::vector<int> indices;
+    std::stringstream ss(spec);
+    std::string item;
+    while (std::getline(ss, item, ',')) {
+        try {
+            indices.push_back(std::stoi(item));
+        } catch (const std::exception&) {
+            line.fail("bad pin '" + item + "'");
+        }
+    }
+    return indices;
+}
+
+size_t springEstimate(const Body& body) {
+    const size_t w = body.width, h = body.height;
+    switch (body.type) {
+        case BodyType::Cloth:
+            return (w - 1) * h + w * (h - 1) + 2 * (w - 1) * (h - 1) + (w > 2 ? (w - 2) * h : 0) + (h > 2 ? w * (h - 2) : 0);
+        case BodyType::TriangleCloth:
+            return 3 * w * h;
+        case BodyType::Rope:
+            return w > 0 ? w - 1 : 0;
+        case BodyType::Mesh:
+            return (body.mesh->edges.size() + (body.triangleModel ? 0 : body.mesh->bendEdges.size())) / 2;
+    }
+    return 0;
+}
+
+} // namespace
+
+struct ParsedScene {
+    SceneSettings settings;
+    // Solver, floor and collider setup, replayed on every build
+    std::vector<std::function<void(Simulation&)>> setup;
+    std::vector<Body> bodies;
+    std::vector<ExtraPin> extraPins;
+    std::vector<KinematicPath> paths;
+    size_t pointMassTotal{0};
+    size_t springTotal{0};
+    // Space-filling-curve renumbering applied once all bodies are built
+    bool reorder{false};
+    SpaceFillingCurve curve{SpaceFillingCurve::Hilbert};
+};
+
+std::shared_ptr<const ParsedScene> SceneLoader::parse(const std::string& path) {
+    std::ifstream file(path);
+    if (!file) {
+        throw std::runtime_error("Could not open scene " + path);
+    }
+    std::stringstream buffer;
+    buffer << file.rdbuf();
+
+    auto slash = path.find_last_of("/\\");
+    std::string baseDir = slash == std::string::npos ? "" : path.substr(0, slash + 1);
+    return parseString(buffer.str(), path, baseDir);
+}
+
+std::shared_ptr<const ParsedScene> SceneLoader::parseString(const std::string& text, const std::string& name,
+                                                           const std::string& baseDir) {
+    auto scene = std::make_shared<ParsedScene>();
+    SceneSettings& settings = scene->settings;
+    auto& setup = scene->setup;
+    std::map<std::string, Material> materials;
+    std::map<std::string, int> named;
+    std::map<std::string, int> namedPaths;
+    // Path named by a path= option, or -1 without one
+    auto pathOption = [&](Line& line) {
+        if (!line.has("path")) return -1;
+        std::string pathName = line.text("path", "");
+        auto it = namedPaths.find(pathName);
+        if (it == namedPaths.end()) line.fail("unknown path '" + pathName + "'");
+        return it->second;
+    };
+
+    // Defaults mirror Simulation's own, for settings that are set in pairs
+    float minSubDt = 1e-4f, maxSubDt = 0.02f;
+    int cycles = 2, smoothing = 2;
+    float areaStiffness = 1.0f, bendStiffness = 0.2f;
+    bool solverSeen = false;
+
+    std::stringstream input(text);
+    std::string raw;
+    int number = 0;
+    while (std::getline(input, raw)) {
+        ++number;
+        auto hash = raw.find('#');
+        if (hash != std::string::npos) raw.erase(hash);
+
+        Line line(name, number);
+        std::stringstream tokens(raw);
+        std::string token;
+        if (!(tokens >> line.command)) continue;
+        while (tokens >> token) line.add(token);
+
+        // Record a setter call for an option that is present
+        auto setNumber = [&](const char* key, void (Simulation::*setter)(float)) {
+            if (!line.has(key)) return;
+            float value = line.number(key, 0.0f);
+            setup.emplace_back([setter, value](Simulation& sim) { (sim.*setter)(value); });
+        };
+        auto setFlag = [&](const char* key, void (Simulation::*setter)(bool)) {
+            if (!line.has(key)) return;
+            bool value = line.flag(key, false);
+            setup.emplace_back([setter, value](Simulation& sim) { (sim.*setter)(value); });
+        };
+
+        const std::string& cmd = line.command;
+        if (cmd == "solver") {
+            solverSeen = true;
+            setNumber("substep", &Simulation::setFixedSubstep);
+            setFlag("adaptive", &Simulation::setAdaptiveStepping);
+            setNumber("tolerance", &Simulation::setStepTolerance);
+            setNumber("courant", &Simulation::setCourantNumber);
+            minSubDt = line.number("min_substep", minSubDt);
+            maxSubDt = line.number("max_substep", maxSubDt);
+            setFlag("multirate", &Simulation::setMultirateStepping);
+            setFlag("sleeping", &Simulation::setSleepingEnabled);
+            setNumber("sleep_threshold", &Simulation::setSleepThreshold);
+            setNumber("sleep_delay", &Simulation::setSleepDelay);
+            setFlag("tearing", &Simulation::setTearingEnabled);
+            setNumber("tear_strain", &Simulation::setTearStrain);
+            setFlag("tethers", &Simulation::setLongRangeAttachmentsEnabled);
+            setNumber("tether_slack", &Simulation::setTetherSlack);
+            setFlag("strain_limit", &Simulation::setStrainLimitingEnabled);
+            setNumber("max_stretch", &Simulation::setMaxStretch);
+            setFlag("multigrid", &Simulation::setMultigridEnabled);
+            cycles = line.integer("cycles", cycles);
+            smoothing = line.integer("smoothing", smoothing);
+            setFlag("ccd", &Simulation::setContinuousCollisionEnabled);
+            setNumber("thickness", &Simulation::setCollisionThickness);
+            areaStiffness = line.number("area_stiffness", areaStiffness);
+            bendStiffness = line.number("bend_stiffness", bendStiffness);
+            if (line.has("reorder")) {
+                std::string order = line.text("reorder", "");
+                if (order != "none" && order != "morton" && order != "hilbert") {
+                    line.fail("reorder must be none, morton or hilbert");
+                }
+                scene->reorder = order != "none";
+                scene->curve = order == "morton" ? SpaceFillingCurve::Morton : SpaceFillingCurve::Hilbert;
+            }
+        } else if (cmd == "floor") {
+            float y = line.number("y", -1.0f);
+            float restitution = line.number("restitution", 0.6f);
+            bool enabled = line.flag("enabled", true);
+            setup.emplace_back([y, restitution, enabled](Simulation& sim) {
+                sim.setFloorY(y);
+                sim.setRestitution(restitution);
+                sim.setFloorEnabled(enabled);
+            });
+        } else if (cmd == "field") {
+            std::function<void(ForceFields&)> add;
+            if (line.positional == "uniform") {
+                Vector3D force = line.vec3("force", Vector3D());
+                add = [force](ForceFields& fields) { fields.addUniform(force); };
+            } else if (line.positional == "wind") {
+                Vector3D velocity = line.vec3("velocity", Vector3D(5, 0, 5));
+                float coefficient = line.number("coefficient", 0.2f);
+                add = [velocity, coefficient](ForceFields& fields) { fields.addWind(velocity, coefficient); };
+            } else if (line.positional == "drag") {
+                float linear = line.number("linear", 0.0f);
+                float quadratic = line.number("quadratic", 0.0f);
+                add = [linear, quadratic](ForceFields& fields) { fields.addDrag(linear, quadratic); };
+            } else if (line.positional == "vortex") {
+                Vector3D center = line.vec3("center", Vector3D());
+                Vector3D axis = line.vec3("axis", Vector3D(0, 1, 0));
+                float strength = line.number("strength", 1.0f);
+                float radius = line.number("radius", 0.1f);
+                if (axis.magnitude() == 0.0f) line.fail("axis must not be zero");
+                add = [=](ForceFields& fields) { fields.addVortex(center, axis, strength, radius); };
+            } else if (line.positional == "turbulence") {
+                float strength = line.number("strength", 1.0f);
+                float cell = line.number("cell", 0.25f);
+                int seed = line.integer("seed", 1);
+                int resolution = line.integer("resolution", 32);
+                if (cell <= 0.0f) line.fail("cell must be positive");
+                if (resolution < 4 || resolution > 128) line.fail("resolution must be between 4 and 128");
+                add = [=](ForceFields& fields) { fields.addTurbulence(strength, cell, (unsigned)seed, resolution); };
+            } else if (line.positional == "aero") {
+                Vector3D air = line.vec3("air", Vector3D(5, 0, 5));
+                float density = line.number("density", 1.2f);
+                float drag = line.number("drag", 1.0f);
+                float lift = line.number("lift", 1.0f);
+                if (density < 0.0f) line.fail("density must not be negative");
+                add = [=](ForceFields& fields) { fields.setAerodynamics(air, density, drag, lift); };
+            } else {
+                line.fail("field must be uniform, wind, drag, vortex, turbulence or aero");
+            }
+            setup.emplace_back([add](Simulation& sim) { add(sim.getForceFields()); });
+        } else if (cmd == "gravity") {
+            settings.gravity = line.vec3("value", settings.gravity);
+        } else if (cmd == "wind") {
+            settings.wind = line.vec3("value", settings.wind);
+            settings.windEnabled = line.flag("enabled", true);
+        } else if (cmd == "run") {
+            settings.frames = line.integer("frames", settings.frames);
+            settings.frameTime = line.number("dt", settings.frameTime);
+        } else if (cmd == "material") {
+            if (line.positional.empty()) line.fail("material needs a name");
+            Material m;
+            m.mass = line.number("mass", m.mass);
+            m.stiffness = line.number("stiffness", m.stiffness);
+            m.shearStiffness = line.number("shear", m.shearStiffness);
+            m.bendStiffness = line.number("bend", m.bendStiffness);
+            m.damping = line.number("damping", m.damping);
+            if (m.mass <= 0.0f) line.fail("mass must be positive");
+            materials[line.positional] = m;
+        } else if (cmd == "cloth" || cmd == "trianglecloth" || cmd == "rope" || cmd == "mesh") {
+            Body body;
+            body.type = cmd == "cloth" ? BodyType::Cloth
+                      : cmd == "trianglecloth" ? BodyType::TriangleCloth
+                      : cmd == "rope" ? BodyType::Rope : BodyType::Mesh;
+            std::string bodyName = line.text("name", "");
+            std::string materialName = line.text("material", "");
+            if (materialName.empty()) {
+                body.material = body.type == BodyType::Rope ? Material::rope() : Material();
+            } else if (materials.count(materialName)) {
+                body.material = materials[materialName];
+            } else {
+                line.fail("unknown material '" + materialName + "'");
+            }
+            body.position = line.vec3("position", Vector3D());
+            body.spacing = line.number("spacing", body.spacing);
+
+            std::string pins;
+            if (body.type == BodyType::Cloth || body.type == BodyType::TriangleCloth) {
+                auto size = line.list("size", 2, {8, 8});
+                body.width = (int)size[0];
+                body.height = (int)size[1];
+                if (body.width < 1 || body.height < 1) line.fail("size must be positive");
+                pins = line.text("pins", "corners");
+            } else if (body.type == BodyType::Rope) {
+                body.width = line.integer("points", 10);
+                body.height = 1;
+                if (body.width < 1) line.fail("points must be positive");
+                pins = line.text("pins", "first");
+            } else {
+                std::string file = line.text("file", "");
+                if (file.empty()) line.fail("mesh needs file=");
+                if (file[0] != '/' && !baseDir.empty()) file = baseDir + file;
+                try {
+                    body.mesh = std::make_shared<MeshData>(MeshLoader::load(file));
+                } catch (const std::exception& e) {
+                    line.fail(e.what());
+                }
+                body.scale = line.number("scale", 1.0f);
+                body.triangleModel = line.flag("triangles", false);
+                pins = line.text("pins", "none");
+            }
+            body.count = body.mesh ? body.mesh->vertexCount() : body.width * body.height;
+            body.path = pathOption(line);
+            for (int index : pinIndices(body, pins, line)) {
+                if (index < 0 || index >= body.count) line.fail("pin " + std::to_string(index) + " is out of range");
+                body.pins.push_back(index);
+            }
+
+            scene->pointMassTotal += body.count;
+            scene->springTotal += springEstimate(body);
+            if (!bodyName.empty()) named[bodyName] = (int)scene->bodies.size();
+            scene->bodies.push_back(std::move(body));
+        } else if (cmd == "pin") {
+            std::string bodyName = line.text("body", "");
+            int vertex = line.integer("vertex", -1);
+            if (bodyName.empty() || vertex < 0) line.fail("pin needs body= and vertex=");
+            auto it = named.find(bodyName);
+            if (it == named.end()) line.fail("unknown body '" + bodyName + "'");
+            if (vertex >= scene->bodies[it->second].count) line.fail("vertex " + std::to_string(vertex) + " is out of range");
+            scene->extraPins.push_back({it->second, vertex, pathOption(line)});
+        } else if (cmd == "path") {
+            if (line.positional.empty()) line.fail("path needs a name");
+            KinematicPath path = parseKeys(line.text("keys", ""), line);
+            std::string interpolation = line.text("interpolation", "linear");
+            if (interpolation == "step") {
+                path.interpolation = KinematicPath::Interpolation::Step;
+            } else if (interpolation == "smooth") {
+                path.interpolation = KinematicPath::Interpolation::Smooth;
+            } else if (interpolation != "linear") {
+                line.fail("interpolation must be step, linear or smooth");
+            }
+            path.loop = line.flag("loop", false);
+            namedPaths[line.positional] = (int)scene->paths.size();
+            scene->paths.push_back(std::move(path));
+        } else if (cmd == "collider") {
+            Collider collider;
+            if (line.positional == "plane") {
+                collider = Collider::plane(line.vec3("point", Vector3D()), line.vec3("normal", Vector3D(0, 1, 0)));
+            } else if (line.positional == "sphere") {
+                float radius = line.number("radius", 0.5f);
+                if (radius <= 0.0f) line.fail("radius must be positive");
+                collider = Collider::sphere(line.vec3("center", Vector3D()), radius);
+            } else {
+                line.fail("collider must be plane or sphere");
+            }
+            setup.emplace_back([collider](Simulation& sim) { sim.addCollider(collider); });
+        } else {
+            line.fail("unknown command '" + cmd + "'");
+        }
+        line.finish();
+    }
+
+    if (solverSeen) {
+        setup.emplace_back([=](Simulation& sim) {
+            sim.setSubstepLimits(minSubDt, maxSubDt);
+            sim.setStrainSolverIterations(cycles, smoothing);
+            sim.setTriangleStiffness(areaStiffness, bendStiffness);
+        });
+    }
+    return scene;
+}
+
+SceneSettings SceneLoader::build(const ParsedScene& scene, Simulation& sim, const SceneOverrides& overrides) {
+    sim.clear();
+    for (const auto& apply : scene.setup) {
+        apply(sim);
+    }
+    if (overrides.restitution >= 0.0f) sim.setRestitution(overrides.restitution);
+    sim.reserve(scene.pointMassTotal, scene.springTotal);
+
+    std::vector<int> firsts;
+    firsts.reserve(scene.bodies.size());
+    for (const Body& body : scene.bodies) {
+        const Vector3D& p = body.position;
+        Material material = body.material;
+        material.stiffness *= overrides.stiffnessScale;
+        material.shearStiffness *= overrides.stiffnessScale;
+        material.bendStiffness *= overrides.stiffnessScale;
+        material.damping *= overrides.dampingScale;
+
+        int first = (int)sim.getPointMasses().size();
+        firsts.push_back(first);
+        switch (body.type) {
+            case BodyType::Cloth:
+                sim.createCloth(p.x, p.y, p.z, body.width, body.height, body.spacing, material);
+                break;
+            case BodyType::TriangleCloth:
+                sim.createTriangleCloth(p.x, p.y, p.z, body.width, body.height, body.spacing, material);
+                break;
+            case BodyType::Rope:
+                sim.createRope(p.x, p.y, p.z, body.width, body.spacing, material);
+                break;
+            case BodyType::Mesh:
+                sim.createMesh(*body.mesh, p.x, p.y, p.z, body.scale, body.triangleModel, material);
+                break;
+        }
+
+        // The builders pin their defaults; the scene decides instead
+        const auto& pointMasses = sim.getPointMasses();
+        for (int i = 0; i < body.count; ++i) {
+            pointMasses[first + i]->setFixed(false);
+        }
+        for (int index : body.pins) {
+            pointMasses[first + index]->setFixed(true);
+        }
+    }
+
+    for (const ExtraPin& pin : scene.extraPins) {
+        sim.getPointMasses()[firsts[pin.body] + pin.vertex]->setFixed(true);
+    }
+
+    // Point mass ids are still insertion indices here
+    for (const KinematicPath& path : scene.paths) {
+        sim.addKinematicPath(path);
+    }
+    for (size_t b = 0; b < scene.bodies.size(); ++b) {
+        if (scene.bodies[b].path < 0) continue;
+        for (int index : scene.bodies[b].pins) {
+            sim.attachToPath(firsts[b] + index, scene.bodies[b].path);
+        }
+    }
+    for (const ExtraPin& pin : scene.extraPins) {
+        if (pin.path >= 0) sim.attachToPath(firsts[pin.body] + pin.vertex, pin.path);
+    }
+    if (scene.reorder) sim.reorderSpatially(scene.curve);
+    return scene.settings;
+}
+
+SceneSettings SceneLoader::load(const std::string& path, Simulation& sim) {
+    return build(*parse(path), sim);
+}
+
+SceneSettings SceneLoader::loadFromString(const std::string& text, Simulation& sim, const std::string& name,
+                                          const std::string& baseDir) {
+    return build(*parseString(text, name, baseDir), sim);
+}
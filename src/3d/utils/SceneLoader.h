@@ -0,0 +1,80 @@
+#ifndef PBD_X_SCENELOADER_H
+#define PBD_X_SCENELOADER_H
+
+#include <memory>
+#include <string>
+#include "../core/Vector3D.h"
+
+class Simulation;
+// A parsed scene with its meshes loaded. Immutable once parsed, so one instance
+// can be built into many simulations, from several threads at once.
+struct ParsedScene;
+
+// Per-frame settings of a scene that the driver (viewer, headless runner or
+// benchmark) applies around Simulation::update
+struct SceneSettings {
+    Vector3D gravity{0.0f, -9.81f, 0.0f};
+    Vector3D wind{5.0f, 0.0f, 5.0f};
+    bool windEnabled{false};
+    // Frame step and length for headless runs
+    float frameTime{1.0f / 60.0f};
+    int frames{600};
+};
+
+// Parameters applied on top of a parsed scene when it is built, e.g. by one
+// variant of a parameter sweep
+struct SceneOverrides {
+    // Multiply every material's spring constants and damping
+    float stiffnessScale{1.0f};
+    float dampingScale{1.0f};
+    // Replaces the floor and collider restitution when not negative
+    float restitution{-1.0f};
+};
+
+// Text scene format, one command per line, `#` starts a comment:
+//
+//   solver   substep=0.005 adaptive=off multirate=off sleeping=on tearing=off tear_strain=1
+//            tethers=off strain_limit=off max_stretch=0.1 multigrid=on ccd=off thickness=0.01
+//            reorder=none|morton|hilbert ...
+//   floor    y=-1 restitution=0.6 enabled=on
+//   gravity  value=0,-9.81,0
+//   wind     value=5,0,5 enabled=off
+//   run      frames=600 dt=0.016667
+//   material silk mass=0.5 stiffness=80 shear=20 bend=5 damping=0.5
+//   path     hook keys=0:3,0,0;2:6,0,0;4:3,0,0 interpolation=linear loop=off
+//   cloth    name=flag material=silk position=0,2,0 size=8,8 spacing=0.2 pins=corners
+//   trianglecloth position=0,2,0 size=16,16 spacing=0.1
+//   rope     position=3,0,0 points=10 spacing=0.15 pins=first path=hook
+//   mesh     file=bunny.obj position=0,1,0 scale=0.5 triangles=on pins=none
+//   pin      body=flag vertex=12 path=hook
+//   collider sphere center=0,0,0 radius=0.5
+//   collider plane point=0,-1,0 normal=0,1,0
+//   field    wind velocity=3,0,1 coefficient=0.2
+//   field    drag linear=0.05 quadratic=0.01
+//   field    vortex center=0,1,0 axis=0,1,0 strength=2 radius=0.3
+//   field    turbulence strength=1.5 cell=0.25 seed=1 resolution=32
+//   field    uniform force=0,0,1
+//   field    aero air=5,0,5 density=1.2 drag=1 lift=1
+//
+// pins is none, first, last, corners, row (the first row of a cloth) or a comma
+// separated list of body-local vertex indices. A path is a list of time:position keys
+// interpolated step, linear or smooth; bodies and pins given path= carry their pins
+// along it at their offsets from its first key. gravity and wind are returned to the
+// driver as a per-frame load; field lines become persistent Simulation force fields.
+namespace SceneLoader {
+    // Parse and validate a scene. Throws std::runtime_error naming the file and line
+    // on malformed input.
+    std::shared_ptr<const ParsedScene> parse(const std::string& path);
+    // Mesh paths are resolved against baseDir
+    std::shared_ptr<const ParsedScene> parseString(const std::string& text, const std::string& name = "<scene>",
+                                                   const std::string& baseDir = "");
+    // Clear sim and build the scene into it; cannot fail once parsed
+    SceneSettings build(const ParsedScene& scene, Simulation& sim, const SceneOverrides& overrides = {});
+
+    // parse followed by build
+    SceneSettings load(const std::string& path, Simulation& sim);
+    SceneSettings loadFromString(const std::string& text, Simulation& sim, const std::string& name = "<scene>",
+                                 const std::string& baseDir = "");
+}
+
+#endif //PBD_X_SCENELOADER_H
@@ -0,0 +1,30 @@
+#include "Telemetry.h"
+#include "../simulation/Simulation.h"
+#include <algorithm>
+
+Telemetry::Telemetry(const std::string& path) {
+    const bool binary = path.size() >= 4 && path.compare(path.size() - 4, 4, ".bin") == 0;
+    logger = std::make_unique<CSVLogger>(
+        path,
+        std::vector<std::string>{"frame", "time", "step_ms", "substeps", "kinetic_energy", "potential_energy",
+                                 "spring_energy", "momentum_x", "momentum_y", "momentum_z", "max_strain",
+                                 "mean_strain", "contacts", "blow_up"},
+        binary ? LogFormat::Binary : LogFormat::Csv);
+}
+
+void Telemetry::record(const Simulation& sim, float dt, double stepMs) {
+    time += dt;
+    const StepStats& stats = sim.getStepStats();
+    const Diagnostics& d = stats.diagnostics;
+
+    const CollisionStats& collisions = sim.getCollisionStats();
+    const long long continuous = (long long)collisions.pointTriangleContacts + collisions.edgeEdgeContacts;
+    // Stats reset by someone else restart the count
+    const long long newContacts = std::max(0LL, continuous - lastContinuousContacts);
+    lastContinuousContacts = continuous;
+
+    // Potential energy is the spring energy plus the load's potential relative to the floor
+    logger->log({(double)frame++, time, stepMs, (double)stats.substeps, d.kineticEnergy,
+                 d.springEnergy + d.loadEnergy, d.springEnergy, d.momentumX, d.momentumY, d.momentumZ, d.maxStrain, d.springs ? d.strainSum / d.springs : 0.0,
+                 (double)(d.contacts + newContacts), stats.blowUp ? 1.0 : 0.0});
+}
@@ -0,0 +1,32 @@
+#ifndef PBD_X_TELEMETRY_H
+#define PBD_X_TELEMETRY_H
+
+#include <memory>
+#include <string>
+#include "../../common/CSVLogger.h"
+
+class Simulation;
+
+// Per-frame solver telemetry written through a CSVLogger: step timing and the
+// simulation's fused diagnostics (energies, momentum, strain, contacts), which must be
+// enabled. Recording reads only the step stats; formatting and disk writes happen on
+// the logger's thread.
+class Telemetry {
+public:
+    // A path ending in .bin selects the binary column format, anything else CSV
+    explicit Telemetry(const std::string& path);
+
+    // Queue the row of an update(dt) of sim that took stepMs
+    void record(const Simulation& sim, float dt, double stepMs);
+
+    [[nodiscard]] long long getDroppedRows() const { return logger->getDroppedRows(); }
+
+private:
+    std::unique_ptr<CSVLogger> logger;
+    int frame{0};
+    double time{0.0};
+    // Cumulative continuous collision contacts at the previous row
+    long long lastContinuousContacts{0};
+};
+
+#endif //PBD_X_TELEMETRY_H
@@ -0,0 +1,139 @@
+#include "pbdx.h"
+#include "../3d/simulation/Simulation.h"
+#include "../3d/utils/SceneLoader.h"
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+static_assert(sizeof(int) == sizeof(int32_t), "triangle indices are exported as int32_t");
+
+struct pbdx_simulation {
+    Simulation sim;
+    SceneSettings settings;
+    std::string lastError;
+};
+
+namespace {
+
+// Run fn, turning exceptions into PBDX_ERROR with the message kept on the simulation
+template <typename Fn>
+pbdx_status guarded(pbdx_simulation* handle, Fn&& fn) {
+    if (!handle) return PBDX_ERROR;
+    handle->lastError.clear();
+    try {
+        fn();
+        return PBDX_OK;
+    } catch (const std::exception& e) {
+        handle->lastError = e.what();
+    } catch (...) {
+        handle->lastError = "unknown error";
+    }
+    return PBDX_ERROR;
+}
+
+// Views address the packed block directly, so a point mass's stride is the element size
+pbdx_status view(pbdx_simulation* handle, pbdx_view* out, float* (PointMass::*data)()) {
+    return guarded(handle, [&]() {
+        if (!out) throw std::invalid_argument("view is null");
+        const auto& pointMasses = handle->sim.getPointMasses();
+        if (!pointMasses.empty() && !handle->sim.isPacked()) handle->sim.packPointMasses();
+        out->data = pointMasses.empty() ? nullptr : (pointMasses[0]->*data)();
+        out->count = pointMasses.size();
+        out->stride = sizeof(PointMass);
+    });
+}
+
+// Swap in a parsed scene, built on default settings so nothing carries over from the
+// previous one; parsing happens before this, so a bad scene never gets here
+void replaceScene(pbdx_simulation& handle, const ParsedScene& scene) {
+    handle.sim.resetSettings();
+    handle.settings = SceneLoader::build(scene, handle.sim);
+    handle.sim.packPointMasses();
+}
+
+} // namespace
+
+extern "C" {
+
+uint32_t pbdx_abi_version(void) {
+    return PBDX_ABI_VERSION;
+}
+
+pbdx_simulation* pbdx_create(void) {
+    try {
+        return new pbdx_simulation();
+    } catch (...) {
+        return nullptr;
+    }
+}
+
+void pbdx_destroy(pbdx_simulation* sim) {
+    delete sim;
+}
+
+const char* pbdx_last_error(const pbdx_simulation* sim) {
+    return sim ? sim->lastError.c_str() : "simulation is null";
+}
+
+pbdx_status pbdx_load_scene_file(pbdx_simulation* sim, const char* path) {
+    return guarded(sim, [&]() {
+        if (!path) throw std::invalid_argument("path is null");
+        replaceScene(*sim, *SceneLoader::parse(path));
+    });
+}
+
+pbdx_status pbdx_load_scene_string(pbdx_simulation* sim, const char* text, const char* base_dir) {
+    return guarded(sim, [&]() {
+        if (!text) throw std::invalid_argument("text is null");
+        replaceScene(*sim, *SceneLoader::parseString(text, "<pbdx scene>", base_dir ? base_dir : ""));
+    });
+}
+
+void pbdx_clear(pbdx_simulation* sim) {
+    if (!sim) return;
+    sim->sim.clear();
+    sim->sim.resetSettings();
+    sim->settings = SceneSettings();
+}
+
+pbdx_status pbdx_step(pbdx_simulation* sim, float dt) {
+    return guarded(sim, [&]() {
+        sim->sim.applyGlobalForce(sim->settings.gravity);
+        if (sim->settings.windEnabled) sim->sim.applyGlobalForce(sim->settings.wind);
+        sim->sim.update(dt);
+    });
+}
+
+float pbdx_frame_time(const pbdx_simulation* sim) {
+    return sim ? sim->settings.frameTime : 0.0f;
+}
+
+size_t pbdx_particle_count(const pbdx_simulation* sim) {
+    return sim ? sim->sim.getPointMasses().size() : 0;
+}
+
+uint64_t pbdx_storage_version(const pbdx_simulation* sim) {
+    return sim ? sim->sim.getStorageVersion() : 0;
+}
+
+pbdx_status pbdx_positions(pbdx_simulation* sim, pbdx_view* out) {
+    return view(sim, out, &PointMass::positionData);
+}
+
+pbdx_status pbdx_velocities(pbdx_simulation* sim, pbdx_view* out) {
+    return view(sim, out, &PointMass::velocityData);
+}
+
+void pbdx_state_written(pbdx_simulation* sim) {
+    if (sim) sim->sim.wakeAll();
+}
+
+pbdx_status pbdx_triangles(const pbdx_simulation* sim, const int32_t** indices, size_t* count) {
+    if (!sim || !indices || !count) return PBDX_ERROR;
+    const std::vector<int>& triangles = sim->sim.getSurfaceTriangles();
+    *indices = triangles.empty() ? nullptr : reinterpret_cast<const int32_t*>(triangles.data());
+    *count = triangles.size() / 3;
+    return PBDX_OK;
+}
+
+}
@@ -0,0 +1,94 @@
+#ifndef PBD_X_PBDX_H
+#define PBD_X_PBDX_H
+
+/*
+ * C interface of libpbdx, the 3D solver as a shared library.
+ *
+ * Lifetime rules:
+ * - A pbdx_simulation is created by pbdx_create and freed by pbdx_destroy; every
+ *   pointer obtained from it dies with it.
+ * - Views (pbdx_positions, pbdx_velocities) and the triangle array point into live
+ *   solver memory. Their contents change in place on every pbdx_step; the pointers
+ *   themselves stay valid until the storage version (pbdx_storage_version) changes,
+ *   which happens only in pbdx_load_scene_* and pbdx_clear.
+ * - A host may read views between calls and write positions or velocities through
+ *   them, then must call pbdx_state_written before the next step.
+ * - A simulation must not be used from two threads at once. Distinct simulations are
+ *   independent.
+ *
+ * Functions returning pbdx_status report failures as PBDX_ERROR with a message
+ * available from pbdx_last_error until the next call on the same simulation.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(_WIN32)
+#  if defined(PBDX_BUILDING)
+#    define PBDX_API __declspec(dllexport)
+#  else
+#    define PBDX_API __declspec(dllimport)
+#  endif
+#else
+#  define PBDX_API __attribute__((visibility("default")))
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Incremented on any incompatible change to this header */
+#define PBDX_ABI_VERSION 1
+
+typedef struct pbdx_simulation pbdx_simulation;
+
+typedef enum pbdx_status {
+    PBDX_OK = 0,
+    PBDX_ERROR = 1
+} pbdx_status;
+
+/* count elements of three floats (x, y, z); element i starts at
+   (const float*)((const char*)data + i * stride) */
+typedef struct pbdx_view {
+    float* data;
+    size_t count;
+    size_t stride;
+} pbdx_view;
+
+/* PBDX_ABI_VERSION of the loaded library, to check against the header */
+PBDX_API uint32_t pbdx_abi_version(void);
+
+PBDX_API pbdx_simulation* pbdx_create(void);
+PBDX_API void pbdx_destroy(pbdx_simulation* sim);
+PBDX_API const char* pbdx_last_error(const pbdx_simulation* sim);
+
+/* Replace the simulation's contents with a scene in the text format of the viewer's
+   --scene files. Mesh paths in a string are resolved against base_dir, which may be
+   NULL. Solver settings start from their defaults for every scene. A scene that fails
+   to parse leaves the previous one in place. pbdx_clear also resets the settings. */
+PBDX_API pbdx_status pbdx_load_scene_file(pbdx_simulation* sim, const char* path);
+PBDX_API pbdx_status pbdx_load_scene_string(pbdx_simulation* sim, const char* text, const char* base_dir);
+PBDX_API void pbdx_clear(pbdx_simulation* sim);
+
+/* Advance by dt seconds under the scene's gravity and wind */
+PBDX_API pbdx_status pbdx_step(pbdx_simulation* sim, float dt);
+/* The scene's frame time, for hosts without their own clock */
+PBDX_API float pbdx_frame_time(const pbdx_simulation* sim);
+
+PBDX_API size_t pbdx_particle_count(const pbdx_simulation* sim);
+PBDX_API uint64_t pbdx_storage_version(const pbdx_simulation* sim);
+/* Views of the live particle state, in particle order */
+PBDX_API pbdx_status pbdx_positions(pbdx_simulation* sim, pbdx_view* view);
+PBDX_API pbdx_status pbdx_velocities(pbdx_simulation* sim, pbdx_view* view);
+/* Call after writing through a view: wakes sleeping parts of the scene */
+PBDX_API void pbdx_state_written(pbdx_simulation* sim);
+
+/* Surface triangles as index triples into the particle views; *count is the number of
+   triangles. Valid like a view. */
+PBDX_API pbdx_status pbdx_triangles(const pbdx_simulation* sim, const int32_t** indices, size_t* count);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* PBD_X_PBDX_H */
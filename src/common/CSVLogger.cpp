@@ -0,0 +1,123 @@
+#include "CSVLogger.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+
+namespace {
+
+// How long the writer sleeps when it finds the buffer empty; the buffer holds far
+// more rows than a simulation logs in that time
+constexpr auto WRITER_IDLE = std::chrono::milliseconds(2);
+
+} // namespace
+
+CSVLogger::CSVLogger(const std::string& path, std::vector<std::string> columns, LogFormat format,
+                     size_t capacityRows)
+    : columns(std::move(columns)), format(format), capacity(capacityRows < 1 ? 1 : capacityRows) {
+    if (this->columns.empty()) {
+        throw std::runtime_error("CSVLogger needs at least one column");
+    }
+    file = std::fopen(path.c_str(), format == LogFormat::Csv ? "w" : "wb");
+    if (!file) {
+        throw std::runtime_error("Could not open log file " + path);
+    }
+    ring.resize(capacity * this->columns.size());
+
+    if (format == LogFormat::Csv) {
+        for (size_t c = 0; c < this->columns.size(); ++c) {
+            std::fputs(this->columns[c].c_str(), file);
+            std::fputc(c + 1 < this->columns.size() ? ',' : '\n', file);
+        }
+    } else {
+        auto count = (uint32_t)this->columns.size();
+        std::fwrite("PBDXLOG1", 1, 8, file);
+        std::fwrite(&count, sizeof(count), 1, file);
+        for (const std::string& name : this->columns) std::fwrite(name.c_str(), 1, name.size() + 1, file);
+    }
+    writer = std::thread(&CSVLogger::writerLoop, this);
+}
+
+CSVLogger::~CSVLogger() {
+    stopping.store(true, std::memory_order_release);
+    writer.join();
+    std::fclose(file);
+}
+
+bool CSVLogger::log(const double* values) {
+    const size_t h = head.load(std::memory_order_relaxed);
+    // The writer's position is only re-read when the buffer looks full, so the producer
+    // does not pull the writer's cache line on every row
+    if (h - producerTail >= capacity) {
+        producerTail = tail.load(std::memory_order_acquire);
+        if (h - producerTail >= capacity) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    std::memcpy(&ring[(h % capacity) * columns.size()], values, columns.size() * sizeof(double));
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+void CSVLogger::flush() {
+    const size_t target = head.load(std::memory_order_relaxed);
+    flushRequested.store(true, std::memory_order_release);
+    while (tail.load(std::memory_order_acquire) < target || flushRequested.load(std::memory_order_acquire)) {
+        std::this_thread::sleep_for(std::chrono::microseconds(100));
+    }
+}
+
+void CSVLogger::writerLoop() {
+    bool failed = false;
+    while (true) {
+        // Read stopping first: rows logged before it was set are then visible below
+        const bool stop = stopping.load(std::memory_order_acquire);
+        const bool flushing = flushRequested.load(std::memory_order_acquire);
+        const size_t t = tail.load(std::memory_order_relaxed);
+        const size_t h = head.load(std::memory_order_acquire);
+        if (h != t) {
+            // Up to the end of the ring in one go; the wrapped part on the next pass
+            const size_t last = std::min(h, t + (capacity - t % capacity));
+            if (!failed) failed = !writeRows(t, last);
+            tail.store(last, std::memory_order_release);
+            continue;
+        }
+        if (flushing || stop) {
+            std::fflush(file);
+            flushRequested.store(false, std::memory_order_release);
+            if (stop) return;
+            continue;
+        }
+        std::this_thread::sleep_for(WRITER_IDLE);
+    }
+}
+
+bool CSVLogger::writeRows(size_t first, size_t last) {
+    const size_t n = columns.size();
+    const double* rows = &ring[(first % capacity) * n];
+    const size_t count = last - first;
+    if (format == LogFormat::Binary) {
+        // Transpose into columns so each block stores a column contiguously
+        transposed.resize(count * n);
+        for (size_t c = 0; c < n; ++c) {
+            for (size_t r = 0; r < count; ++r) transposed[c * count + r] = rows[r * n + c];
+        }
+        auto rowCount = (uint32_t)count;
+        return std::fwrite(&rowCount, sizeof(rowCount), 1, file) == 1 &&
+               std::fwrite(transposed.data(), sizeof(double), transposed.size(), file) == transposed.size();
+    }
+
+    // %.9g round-trips a float, %.17g would be needed only for full double precision
+    scratch.resize(count * n * 24 + 1);
+    char* out = scratch.data();
+    for (size_t r = 0; r < count; ++r) {
+        for (size_t c = 0; c < n; ++c) {
+            out += std::snprintf(out, 24, "%.9g", rows[r * n + c]);
+            *out++ = c + 1 < n ? ',' : '\n';
+        }
+    }
+    const size_t bytes = out - scratch.data();
+    return std::fwrite(scratch.data(), 1, bytes, file) == bytes;
+}
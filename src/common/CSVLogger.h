@@ -0,0 +1,68 @@
+#ifndef PBD_X_CSVLOGGER_H
+#define PBD_X_CSVLOGGER_H
+
+#include <atomic>
+#include <cstdio>
+#include <initializer_list>
+#include <string>
+#include <thread>
+#include <vector>
+
+enum class LogFormat {
+    // Text, one header line and one line per row
+    Csv,
+    // "PBDXLOG1", the column count and names, then blocks of up to a buffer's worth of
+    // rows: the row count followed by each column's values as contiguous doubles
+    Binary
+};
+
+// Telemetry log with a fixed set of numeric columns. log() copies a row into a
+// single-producer ring buffer and returns; a background thread drains the buffer and
+// does all formatting and file I/O, so the thread stepping the simulation never
+// blocks on the disk. Rows logged while the buffer is full are dropped and counted
+// rather than stalling the producer. Only one thread may call log() and flush().
+class CSVLogger {
+public:
+    // Throws std::runtime_error if the file cannot be created
+    CSVLogger(const std::string& path, std::vector<std::string> columns, LogFormat format = LogFormat::Csv,
+              size_t capacityRows = 1 << 16);
+    // Writes every buffered row, then closes the file
+    ~CSVLogger();
+
+    CSVLogger(const CSVLogger&) = delete;
+    CSVLogger& operator=(const CSVLogger&) = delete;
+
+    // values holds one value per column; returns false if the row was dropped
+    bool log(const double* values);
+    bool log(std::initializer_list<double> values) { return log(values.begin()); }
+    // Block until every row logged so far is on disk
+    void flush();
+
+    [[nodiscard]] size_t getColumnCount() const { return columns.size(); }
+    [[nodiscard]] long long getDroppedRows() const { return dropped.load(std::memory_order_relaxed); }
+
+private:
+    void writerLoop();
+    // Write rows [first, last) of the ring; returns false on an I/O error
+    bool writeRows(size_t first, size_t last);
+
+    std::vector<std::string> columns;
+    LogFormat format;
+    FILE* file{nullptr};
+    size_t capacity;
+    std::vector<double> ring;
+    // Rows ever logged and ever written; the producer owns head, the writer owns tail
+    alignas(64) std::atomic<size_t> head{0};
+    // Last tail the producer saw, never ahead of the real one
+    size_t producerTail{0};
+    std::atomic<long long> dropped{0};
+    alignas(64) std::atomic<size_t> tail{0};
+    std::atomic<bool> stopping{false};
+    std::atomic<bool> flushRequested{false};
+    // Formatted or transposed rows, owned by the writer
+    std::vector<char> scratch;
+    std::vector<double> transposed;
+    std::thread writer;
+};
+
+#endif //PBD_X_CSVLOGGER_H
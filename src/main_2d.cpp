@@ -4,11 +4,14 @@
 #include <algorithm>
 
 int main(int argc, char** argv) {
-	// By default run the automated test suite and exit. Pass `--app` to start the interactive app.
+	// By default run the automated test suite and exit. Pass `--app` to start the interactive app,
+	// or `--update-golden` to rewrite the test's golden trajectory.
 	bool startApp = false;
+	bool updateGolden = false;
 	for (int i = 1; i < argc; ++i) {
 		std::string a = argv[i];
 		if (a == "--app") startApp = true;
+		if (a == "--update-golden") updateGolden = true;
 	}
 
 	if (startApp) {
@@ -17,6 +20,6 @@ int main(int argc, char** argv) {
 	}
 
 	TestRunner2D runner(1024, 768);
-	runner.runAll("output_2d_tests");
-	return 0;
+	runner.setUpdateGolden(updateGolden);
+	return runner.runAll("output_2d_tests") == 0 ? 0 : 1;
 }
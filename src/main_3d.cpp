@@ -1,22 +1,157 @@
 #include "3d/gui/OpenGLApplication3D.h"
+#include "3d/utils/Benchmark.h"
+#include "3d/utils/ParameterSweep.h"
 #include "tests/TestRunner3D.h"
 #include <string>
 #include <algorithm>
+#include <iostream>
+#include <cctype>
+#include <cstdlib>
+#include <exception>
+#include <fstream>
+#include <sstream>
+#include <vector>
+
+namespace {
+
+std::vector<float> parseValues(const std::string& text) {
+	std::vector<float> values;
+	std::stringstream ss(text);
+	std::string item;
+	while (std::getline(ss, item, ',')) values.push_back(std::stof(item));
+	return values;
+}
+
+// --sweep <scene> <results.csv> [stiffness=a,b,..] [damping=..] [restitution=..] [threads=N]
+int runSweep(int argc, char** argv, int first) {
+	if (first + 1 >= argc) {
+		std::cerr << "--sweep needs a scene file and a results file" << std::endl;
+		return 1;
+	}
+	std::vector<float> stiffness{1.0f}, damping{1.0f}, restitution{-1.0f};
+	int threads = 0;
+	for (int i = first + 2; i < argc; ++i) {
+		std::string a = argv[i];
+		auto eq = a.find('=');
+		std::string key = a.substr(0, eq), value = eq == std::string::npos ? "" : a.substr(eq + 1);
+		if (key == "stiffness") stiffness = parseValues(value);
+		else if (key == "damping") damping = parseValues(value);
+		else if (key == "restitution") restitution = parseValues(value);
+		else if (key == "threads") threads = std::atoi(value.c_str());
+		else {
+			std::cerr << "Unknown sweep option: " << a << std::endl;
+			return 1;
+		}
+	}
+
+	std::ofstream out(argv[first + 1]);
+	if (!out) {
+		std::cerr << "Could not open " << argv[first + 1] << std::endl;
+		return 1;
+	}
+	ParameterSweep sweep(SceneLoader::parse(argv[first]));
+	sweep.addGrid(stiffness, damping, restitution);
+	auto results = sweep.run(out, threads);
+	int unstable = 0;
+	for (const SweepResult& r : results) unstable += r.stable ? 0 : 1;
+	std::cout << results.size() << " variants written to " << argv[first + 1] << ", " << unstable << " unstable" << std::endl;
+	return 0;
+}
+
+}
 
 int main(int argc, char** argv) {
-	// By default run automated 3D tests. Pass `--app` to start the interactive app.
+	// By default run automated 3D tests. Pass `--app` to start the interactive app,
+	// optionally with `--scene <file>`. `--bench multigrid [size]`,
+	// `--bench batched [variants]`, `--bench reorder [size | mesh file]`,
+	// `--bench collisions [size]` and `--bench scene <file>` run headless benchmarks
+	// instead, and `--sweep` runs a parameter sweep over a scene (see runSweep).
+	// `--capture <dir> [frames]` renders the scene offscreen, without a display, and
+	// writes every frame to dir. The tests
+	// take `--update-golden`, `--update-baseline` and `--perf-threshold <fraction>`.
+	// `--telemetry <file>` logs per-frame solver telemetry from the app or a capture.
 	bool startApp = false;
+	bool updateGolden = false;
+	bool updateBaseline = false;
+	float perfThreshold = 0.25f;
+	std::string scenePath;
+	std::string captureDir;
+	std::string telemetryPath;
+	int captureFrames = 120;
 	for (int i = 1; i < argc; ++i) {
 		std::string a = argv[i];
 		if (a == "--app") startApp = true;
+		if (a == "--scene" && i + 1 < argc) scenePath = argv[++i];
+		if (a == "--telemetry" && i + 1 < argc) telemetryPath = argv[++i];
+		if (a == "--update-golden") updateGolden = true;
+		if (a == "--update-baseline") updateBaseline = true;
+		if (a == "--perf-threshold" && i + 1 < argc) perfThreshold = std::stof(argv[++i]);
+		if (a == "--capture" && i + 1 < argc) {
+			captureDir = argv[++i];
+			if (i + 1 < argc && std::isdigit((unsigned char)argv[i + 1][0])) captureFrames = std::max(1, std::atoi(argv[++i]));
+		}
+		if (a == "--sweep") {
+			try {
+				return runSweep(argc, argv, i + 1);
+			} catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+		}
+		if (a == "--bench" && i + 1 < argc) {
+			std::string name = argv[i + 1];
+			std::string arg = (i + 2 < argc) ? argv[i + 2] : "";
+			try {
+				if (name == "multigrid") {
+					Benchmark::multigrid(std::cout, arg.empty() ? 256 : std::max(4, std::atoi(arg.c_str())));
+					return 0;
+				}
+				if (name == "batched") {
+					Benchmark::batched(std::cout, arg.empty() ? 1024 : std::max(1, std::atoi(arg.c_str())));
+					return 0;
+				}
+				if (name == "reorder") {
+					bool isSize = !arg.empty() && arg.find_first_not_of("0123456789") == std::string::npos;
+					Benchmark::reorder(std::cout, isSize ? "" : arg, isSize ? std::max(2, std::atoi(arg.c_str())) : 256);
+					return 0;
+				}
+				if (name == "collisions") {
+					Benchmark::collisions(std::cout, arg.empty() ? 64 : std::max(2, std::atoi(arg.c_str())));
+					return 0;
+				}
+				if (name == "scene" && !arg.empty()) {
+					Benchmark::scene(std::cout, arg);
+					return 0;
+				}
+			} catch (const std::exception& e) {
+				std::cerr << e.what() << std::endl;
+				return 1;
+			}
+			std::cerr << "Unknown benchmark: " << name << std::endl;
+			return 1;
+		}
+	}
+
+	if (!captureDir.empty()) {
+		try {
+			OpenGLApplication3D app(1024, 768, scenePath, true);
+			if (!telemetryPath.empty()) app.setTelemetry(telemetryPath);
+			return app.capture(captureDir, captureFrames);
+		} catch (const std::exception& e) {
+			std::cerr << e.what() << std::endl;
+			return 1;
+		}
 	}
 
 	if (startApp) {
-		OpenGLApplication3D app(1024, 768);
+		OpenGLApplication3D app(1024, 768, scenePath);
+		if (!telemetryPath.empty()) app.setTelemetry(telemetryPath);
 		return app.run();
 	}
 
 	TestRunner3D runner(1024, 768);
-	runner.runAll("output_3d_tests");
-	return 0;
+	runner.setUpdateGolden(updateGolden);
+	runner.setUpdateBaseline(updateBaseline);
+	runner.setPerfThreshold(perfThreshold);
+	return runner.runAll("output_3d_tests") == 0 ? 0 : 1;
 }
@@ -0,0 +1,90 @@
+/* Checks of libpbdx through its C interface only, as a host would use it. Exits
+   non-zero when a check fails. */
+#include "pbdx.h"
+#include <stdio.h>
+
+static int failures = 0;
+
+static void check(int ok, const char* name, const char* what) {
+    printf("[%s] %s: %s\n", ok ? "PASS" : "FAIL", name, what);
+    if (!ok) failures++;
+}
+
+static float lowestY(pbdx_simulation* sim) {
+    pbdx_view view;
+    float lowest = 1e30f;
+    size_t i;
+    if (pbdx_positions(sim, &view) != PBDX_OK) return -1e30f;
+    for (i = 0; i < view.count; ++i) {
+        const float* p = (const float*)((const char*)view.data + i * view.stride);
+        if (p[1] < lowest) lowest = p[1];
+    }
+    return lowest;
+}
+
+/* Scene A turns the floor off and changes the stepping; scene B sets nothing, so its
+   rope must come to rest on the default floor at y = -1 */
+static const char* SCENE_A =
+    "solver substep=0.01 adaptive=on sleeping=off tearing=on tethers=on\n"
+    "floor enabled=off\n"
+    "rope position=0,0,0 points=6 spacing=0.1 pins=first\n";
+
+static const char* SCENE_B =
+    "rope position=0,0,0 points=3 spacing=0.1 pins=none\n";
+
+static void load(pbdx_simulation* sim, const char* text, const char* name) {
+    int ok = pbdx_load_scene_string(sim, text, NULL) == PBDX_OK;
+    check(ok, name, ok ? "scene loads" : pbdx_last_error(sim));
+}
+
+static void twoScenesInARow(void) {
+    pbdx_simulation* sim = pbdx_create();
+    int i;
+    load(sim, SCENE_A, "load_scene_a");
+    for (i = 0; i < 30; ++i) pbdx_step(sim, pbdx_frame_time(sim));
+    load(sim, SCENE_B, "load_scene_b");
+    check(pbdx_particle_count(sim) == 3, "scene_b_replaces_a", "only scene B's particles remain");
+    for (i = 0; i < 120; ++i) pbdx_step(sim, pbdx_frame_time(sim));
+    check(lowestY(sim) > -1.05f, "settings_reset", "scene B falls onto the default floor");
+    pbdx_destroy(sim);
+}
+
+/* Tethers of the first scene hold its pinned particles; loading the second must not
+   reach back into them */
+static const char* TETHER_SCENE =
+    "solver tethers=on\n"
+    "rope position=0,0,0 points=8 spacing=0.1 pins=first\n";
+
+static void twoTetherScenesInARow(void) {
+    pbdx_simulation* sim = pbdx_create();
+    int i, ok = 1;
+    load(sim, TETHER_SCENE, "load_tether_scene_a");
+    for (i = 0; i < 10; ++i) ok &= pbdx_step(sim, pbdx_frame_time(sim)) == PBDX_OK;
+    load(sim, TETHER_SCENE, "load_tether_scene_b");
+    for (i = 0; i < 10; ++i) ok &= pbdx_step(sim, pbdx_frame_time(sim)) == PBDX_OK;
+    check(ok && pbdx_particle_count(sim) == 8, "tether_scenes_in_a_row", "the second tether scene steps");
+    pbdx_destroy(sim);
+}
+
+static void failedLoadKeepsScene(void) {
+    pbdx_simulation* sim = pbdx_create();
+    size_t count;
+    uint64_t version;
+    pbdx_load_scene_string(sim, SCENE_A, NULL);
+    count = pbdx_particle_count(sim);
+    version = pbdx_storage_version(sim);
+    check(pbdx_load_scene_string(sim, "rope points=oops\n", NULL) == PBDX_ERROR, "bad_scene_fails",
+          "a malformed scene is reported");
+    check(pbdx_particle_count(sim) == count && pbdx_storage_version(sim) == version, "bad_scene_keeps_previous",
+          "the previous scene and its views survive");
+    check(pbdx_step(sim, pbdx_frame_time(sim)) == PBDX_OK, "step_after_bad_scene", "stepping continues");
+    pbdx_destroy(sim);
+}
+
+int main(void) {
+    check(pbdx_abi_version() == PBDX_ABI_VERSION, "abi_version", "library matches the header");
+    twoScenesInARow();
+    twoTetherScenesInARow();
+    failedLoadKeepsScene();
+    return failures == 0 ? 0 : 1;
+}
@@ -0,0 +1,116 @@
+#include "GoldenTrajectory.h"
+#include <cmath>
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+
+GoldenTrajectory GoldenTrajectory::load(const std::string& path) {
+    std::ifstream in(path);
+    if (!in) {
+        throw std::runtime_error("Could not open golden trajectory " + path);
+    }
+    GoldenTrajectory t;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(in, line)) {
+        ++lineNumber;
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream ss(line);
+        std::string key;
+        ss >> key;
+        if (key == "dimensions") {
+            ss >> t.dimensions;
+        } else if (key == "sample_every") {
+            ss >> t.sampleEvery;
+        } else if (key == "particles") {
+            int count = 0;
+            ss >> count;
+            t.particles.resize(count);
+            for (int& p : t.particles) ss >> p;
+        } else if (key == "frame") {
+            int frame = 0;
+            ss >> frame;
+            std::vector<float> values(t.particles.size() * t.dimensions);
+            for (float& v : values) ss >> v;
+            t.frames.push_back(frame);
+            t.positions.push_back(std::move(values));
+        } else {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": unknown key " + key);
+        }
+        if (ss.fail()) {
+            throw std::runtime_error(path + ":" + std::to_string(lineNumber) + ": malformed " + key + " line");
+        }
+    }
+    return t;
+}
+
+void GoldenTrajectory::save(const std::string& path) const {
+    std::ofstream out(path);
+    if (!out) {
+        throw std::runtime_error("Could not write golden trajectory " + path);
+    }
+    // Nine significant digits round-trip a float exactly
+    out << std::setprecision(9);
+    out << "dimensions " << dimensions << "\n";
+    out << "sample_every " << sampleEvery << "\n";
+    out << "particles " << particles.size();
+    for (int p : particles) out << ' ' << p;
+    out << "\n";
+    for (size_t s = 0; s < frames.size(); ++s) {
+        out << "frame " << frames[s];
+        for (float v : positions[s]) out << ' ' << v;
+        out << "\n";
+    }
+}
+
+namespace Trajectory {
+
+std::vector<int> sampleParticles(int count, int limit) {
+    std::vector<int> indices;
+    if (count <= limit) {
+        for (int i = 0; i < count; ++i) indices.push_back(i);
+        return indices;
+    }
+    for (int i = 0; i < limit; ++i) {
+        indices.push_back((int)((long long)i * (count - 1) / (limit - 1)));
+    }
+    return indices;
+}
+
+TrajectoryMismatch compare(const GoldenTrajectory& golden, const GoldenTrajectory& actual, float tolerance,
+                           float growthPerSecond, float frameTime) {
+    TrajectoryMismatch result;
+    if (golden.dimensions != actual.dimensions || golden.particles != actual.particles ||
+        golden.frames != actual.frames) {
+        result.matches = false;
+        result.reason = "sampled particles or frames differ from the golden; the scene changed";
+        return result;
+    }
+    for (size_t s = 0; s < golden.frames.size(); ++s) {
+        const float allowed = tolerance + growthPerSecond * golden.frames[s] * frameTime;
+        const std::vector<float>& a = golden.positions[s];
+        const std::vector<float>& b = actual.positions[s];
+        for (size_t p = 0; p < golden.particles.size(); ++p) {
+            float sq = 0.0f;
+            for (int d = 0; d < golden.dimensions; ++d) {
+                float diff = a[p * golden.dimensions + d] - b[p * golden.dimensions + d];
+                sq += diff * diff;
+            }
+            float error = std::sqrt(sq);
+            // NaN fails as well
+            if (!(error <= allowed)) {
+                result.matches = false;
+                result.frame = golden.frames[s];
+                result.particle = golden.particles[p];
+                result.error = error;
+                result.tolerance = allowed;
+                result.reason = "position diverged from the golden";
+                return result;
+            }
+        }
+    }
+    return result;
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef PBD_X_GOLDENTRAJECTORY_H
+#define PBD_X_GOLDENTRAJECTORY_H
+
+#include <string>
+#include <vector>
+
+// Positions of a fixed subset of particles every sampleEvery frames of a run. Goldens
+// are recorded from a reference build and stored as text, so regenerated files diff
+// readably in review.
+struct GoldenTrajectory {
+    int dimensions{3};
+    int sampleEvery{10};
+    // Indices of the sampled particles
+    std::vector<int> particles;
+    // Frame number of each sample and, per sample, particles.size() * dimensions floats
+    std::vector<int> frames;
+    std::vector<std::vector<float>> positions;
+
+    // Throws std::runtime_error when the file is missing or malformed
+    static GoldenTrajectory load(const std::string& path);
+    void save(const std::string& path) const;
+};
+
+// Where two trajectories first disagree by more than the tolerance of that frame
+struct TrajectoryMismatch {
+    bool matches{true};
+    int frame{0};
+    int particle{0};
+    float error{0.0f};
+    float tolerance{0.0f};
+    std::string reason;
+};
+
+namespace Trajectory {
+    // Every particle when there are at most limit, otherwise limit evenly spaced ones,
+    // always including the first and the last
+    std::vector<int> sampleParticles(int count, int limit = 64);
+    // Largest per-particle distance at each sample must stay within
+    // tolerance + growthPerSecond * elapsed simulated time, as small differences in
+    // floating-point evaluation grow over a run
+    TrajectoryMismatch compare(const GoldenTrajectory& golden, const GoldenTrajectory& actual, float tolerance,
+                               float growthPerSecond, float frameTime);
+}
+
+#endif //PBD_X_GOLDENTRAJECTORY_H
@@ -0,0 +1,72 @@
+#include "TestRunner2D.h"
+#include "GoldenTrajectory.h"
+#include "../2d/simulation/Simulation.h"
+#include <exception>
+#include <filesystem>
+#include <iostream>
+#include <vector>
+
+#ifndef PBD_X_GOLDEN_DIR
+#define PBD_X_GOLDEN_DIR "src/tests/golden"
+#endif
+
+namespace {
+
+constexpr int FRAMES = 300;
+constexpr float FRAME_TIME = 1.0f / 60.0f;
+constexpr float POSITION_TOLERANCE = 1e-4f;
+constexpr float TOLERANCE_GROWTH = 1e-3f;
+
+} // namespace
+
+TestRunner2D::TestRunner2D(int width, int height) : width(width), height(height), goldenDir(PBD_X_GOLDEN_DIR) {}
+
+int TestRunner2D::runAll(const std::string& outputDir) {
+    Simulation sim;
+    sim.createCloth(0.0f, 0.0f, 8, 8, 0.2f);
+    sim.createRope(3.0f, 0.0f, 10, 0.15f);
+
+    GoldenTrajectory actual;
+    actual.dimensions = 2;
+    actual.particles = Trajectory::sampleParticles((int)sim.getPointMasses().size());
+    for (int frame = 1; frame <= FRAMES; ++frame) {
+        sim.applyGlobalForce(Vector2D(0, -9.81f));
+        sim.update(FRAME_TIME);
+        if (frame % actual.sampleEvery == 0) {
+            std::vector<float> sample;
+            for (int index : actual.particles) {
+                Vector2D p = sim.getPointMasses()[index]->getPosition();
+                sample.insert(sample.end(), {p.x, p.y});
+            }
+            actual.frames.push_back(frame);
+            actual.positions.push_back(std::move(sample));
+        }
+    }
+
+    std::filesystem::create_directories(outputDir);
+    actual.save(outputDir + "/default.traj");
+
+    const std::string goldenPath = goldenDir + "/2d_default.traj";
+    if (updateGolden) {
+        actual.save(goldenPath);
+        std::cout << "[GOLD] default: wrote " << goldenPath << std::endl;
+        return 0;
+    }
+    try {
+        TrajectoryMismatch m = Trajectory::compare(GoldenTrajectory::load(goldenPath), actual, POSITION_TOLERANCE,
+                                                   TOLERANCE_GROWTH, FRAME_TIME);
+        if (m.matches) {
+            std::cout << "[PASS] default: trajectory matches over " << FRAMES << " frames" << std::endl;
+            return 0;
+        }
+        std::cout << "[FAIL] default: " << m.reason;
+        if (m.tolerance > 0.0f) {
+            std::cout << " at frame " << m.frame << ", particle " << m.particle << " off by " << m.error
+                      << " (tolerance " << m.tolerance << ")";
+        }
+        std::cout << std::endl;
+    } catch (const std::exception& e) {
+        std::cout << "[FAIL] default: " << e.what() << std::endl;
+    }
+    return 1;
+}
@@ -0,0 +1,26 @@
+#ifndef PBD_X_TESTRUNNER2D_H
+#define PBD_X_TESTRUNNER2D_H
+
+#include <string>
+
+// Regression harness for the 2D solver: the interactive application's default cloth
+// and rope are stepped headless and compared frame by frame against a golden
+// trajectory (see TestRunner3D for the full harness)
+class TestRunner2D {
+public:
+    TestRunner2D(int width, int height);
+
+    // Returns the number of failed checks; outputDir receives the trajectory of this run
+    int runAll(const std::string& outputDir);
+
+    // Rewrite the golden trajectory from this run instead of comparing against it
+    void setUpdateGolden(bool update) { updateGolden = update; }
+
+private:
+    int width;
+    int height;
+    bool updateGolden{false};
+    std::string goldenDir;
+};
+
+#endif //PBD_X_TESTRUNNER2D_H
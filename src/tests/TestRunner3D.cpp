@@ -0,0 +1,443 @@
+#include <glad/glad.h>
+#include "TestRunner3D.h"
+#include "../3d/gui/GLFWContext.h"
+#include "../3d/gui/OpenGLRenderer3D.h"
+#include "../3d/simulation/Simulation.h"
+#include "../3d/simulation/TriangleConstraints.h"
+#include "../3d/utils/MeshLoader.h"
+#include "../3d/utils/SceneLoader.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <vector>
+
+#ifndef PBD_X_GOLDEN_DIR
+#define PBD_X_GOLDEN_DIR "src/tests/golden"
+#endif
+
+namespace {
+
+// Absolute position tolerance at frame 0 and its growth per simulated second, in meters
+constexpr float POSITION_TOLERANCE = 1e-4f;
+constexpr float TOLERANCE_GROWTH = 1e-3f;
+// Slowdowns smaller than this are timer noise, whatever the threshold
+constexpr double PERF_NOISE_MS = 0.05;
+
+std::map<std::string, double> loadBaseline(const std::string& path) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(path);
+    std::string name;
+    double ms;
+    while (in >> name >> ms) baseline[name] = ms;
+    return baseline;
+}
+
+void saveBaseline(const std::string& path, const std::map<std::string, double>& baseline) {
+    std::ofstream out(path);
+    for (const auto& entry : baseline) out << entry.first << ' ' << entry.second << '\n';
+}
+
+// Median time of a fixed scalar kernel that does not touch the solver. Scene timings are
+// stored and compared as multiples of it, measured right before each scene, so a machine
+// that is slower or busier as a whole does not fail the check.
+double calibrationMs() {
+    std::vector<float> data(1 << 14, 1.0f);
+    std::vector<double> samples;
+    for (int run = 0; run < 15; ++run) {
+        auto t0 = std::chrono::steady_clock::now();
+        for (int pass = 0; pass < 8; ++pass) {
+            for (size_t i = 1; i < data.size(); ++i) data[i] = data[i] * 0.999f + data[i - 1] * 0.001f;
+        }
+        samples.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+    }
+    // Keep the kernel from being optimized away
+    volatile float sink = data.back();
+    (void)sink;
+    std::nth_element(samples.begin(), samples.begin() + samples.size() / 2, samples.end());
+    return samples[samples.size() / 2];
+}
+
+// Timings are only compared within one build configuration: the architecture, and
+// whether assertions are compiled out as in release builds
+std::string perfConfiguration() {
+#if defined(__x86_64__) || defined(_M_X64)
+    std::string configuration = "x86_64";
+#elif defined(__aarch64__) || defined(_M_ARM64)
+    std::string configuration = "arm64";
+#else
+    std::string configuration = "other";
+#endif
+#ifdef NDEBUG
+    return configuration + "-release";
+#else
+    return configuration + "-debug";
+#endif
+}
+
+std::string writeFile(const std::string& dir, const std::string& name, const std::string& content) {
+    std::string path = dir + "/" + name;
+    std::ofstream(path, std::ios::binary) << content;
+    return path;
+}
+
+// OBJ faces of any size fan out from their first corner
+std::string objPolygonFan(const std::string& dir) {
+    std::ostringstream obj;
+    for (int i = 0; i < 70; ++i) {
+        float angle = 6.2831853f * (float)i / 70.0f;
+        obj << "v " << std::cos(angle) << ' ' << std::sin(angle) << " 0\n";
+    }
+    obj << "f";
+    for (int i = 1; i <= 70; ++i) obj << ' ' << i;
+    obj << '\n';
+    MeshData mesh = MeshLoader::loadOBJ(writeFile(dir, "polygon70.obj", obj.str()));
+    if (mesh.vertexCount() != 70 || mesh.triangleCount() != 68) {
+        return std::to_string(mesh.vertexCount()) + " vertices and " + std::to_string(mesh.triangleCount()) +
+               " triangles, expected 70 and 68";
+    }
+    for (int t = 0; t < 68; ++t) {
+        if (mesh.triangles[t * 3] != 0 || mesh.triangles[t * 3 + 1] != t + 1 || mesh.triangles[t * 3 + 2] != t + 2) {
+            return "triangle " + std::to_string(t) + " is not fanned from the first corner";
+        }
+    }
+    // 70 boundary edges and 67 diagonals
+    return mesh.edges.size() == 137 * 2 ? "" : std::to_string(mesh.edges.size() / 2) + " edges, expected 137";
+}
+
+// Negative indices count back from the last vertex read; CRLF endings, texture and
+// normal references and explicit '+' signs parse as their plain equivalents
+std::string objIndexForms(const std::string& dir) {
+    const std::string absolute = "v 0 0 0\nv 1 0 0\nv 1 1 0\nv 0 1 0\nf 1 2 3 4\n"
+                                 "v 2 0 0\nv 2 1 0\nf 2 5 6 3\n";
+    const std::string relative = "v 0 0 0\r\nv 1 0 0\r\nv 1 1 0\r\nv 0 1 0\r\nf -4/1 -3/2 -2/3 -1/4\r\n"
+                                 "v +2 +0 +0\r\nv 2.0 +1.0 0\r\nf +2//1 -2//1 -1//1 +3//1\r\n";
+    MeshData expected = MeshLoader::loadOBJ(writeFile(dir, "indices_absolute.obj", absolute));
+    MeshData actual = MeshLoader::loadOBJ(writeFile(dir, "indices_relative.obj", relative));
+    if (actual.positions != expected.positions) return "vertex positions differ from the plain file";
+    if (actual.triangles != expected.triangles) return "face indices differ from the plain file";
+    return expected.triangleCount() == 4 ? "" : std::to_string(expected.triangleCount()) + " triangles, expected 4";
+}
+
+float dihedral(const Vector3D& a, const Vector3D& b, const Vector3D& c, const Vector3D& d) {
+    Vector3D e = b - a;
+    Vector3D n1 = (c - a).cross(c - b);
+    Vector3D n2 = (d - b).cross(d - a);
+    return std::atan2(n1.cross(n2).dot(e) / e.magnitude(), n1.dot(n2));
+}
+
+// Area and dihedral projections pull a disturbed hinge back to its rest shape
+std::string triangleConstraintsConverge(const std::string&) {
+    std::vector<std::unique_ptr<PointMass>> owned;
+    std::vector<PointMass*> pointMasses;
+    // Edge (0, 1) along z, wings folded 40 degrees out of the plane
+    const float fold = 0.6981317f;
+    const Vector3D rest[4] = {Vector3D(0, 0, 0), Vector3D(0, 0, 1), Vector3D(1, 0, 0.5f),
+                              Vector3D(-std::cos(fold), std::sin(fold), 0.5f)};
+    for (const Vector3D& p : rest) {
+        owned.push_back(std::make_unique<PointMass>(1.0f, p.x, p.y, p.z));
+        pointMasses.push_back(owned.back().get());
+    }
+    TriangleConstraints constraints;
+    constraints.addTriangle(pointMasses, 0, 1, 2);
+    constraints.addTriangle(pointMasses, 1, 0, 3);
+    constraints.addHinge(pointMasses, 0, 1, 2, 3);
+
+    ConstraintBatch batch;
+    batch.vertices = pointMasses;
+    batch.areaA = {0, 1};
+    batch.areaB = {1, 0};
+    batch.areaC = {2, 3};
+    batch.restAreas = constraints.restAreas;
+    batch.bendA = {0};
+    batch.bendB = {1};
+    batch.bendC = {2};
+    batch.bendD = {3};
+    batch.restAngles = constraints.restAngles;
+
+    // Stretch one wing and flatten the other
+    pointMasses[2]->setPosition(Vector3D(1.6f, 0.2f, 0.5f));
+    pointMasses[3]->setPosition(Vector3D(-1.0f, 0.0f, 0.7f));
+    for (int it = 0; it < 200; ++it) projectTriangleConstraints(batch, 1.0f / 60.0f, 1.0f, 1.0f);
+
+    auto at = [&pointMasses](int i) { return pointMasses[i]->getPosition(); };
+    for (int t = 0; t < 2; ++t) {
+        float area = 0.5f * (at(batch.areaB[t]) - at(batch.areaA[t])).cross(at(batch.areaC[t]) - at(batch.areaA[t])).magnitude();
+        if (std::fabs(area - batch.restAreas[t]) > 1e-3f * batch.restAreas[t]) {
+            return "triangle " + std::to_string(t) + " area " + std::to_string(area) + ", rest " +
+                   std::to_string(batch.restAreas[t]);
+        }
+    }
+    float angle = dihedral(at(0), at(1), at(2), at(3));
+    if (std::fabs(angle - batch.restAngles[0]) > 1e-3f) {
+        return "hinge angle " + std::to_string(angle) + ", rest " + std::to_string(batch.restAngles[0]);
+    }
+    return "";
+}
+
+} // namespace
+
+TestRunner3D::TestRunner3D(int width, int height) : width(width), height(height), goldenDir(PBD_X_GOLDEN_DIR) {}
+
+TestRunner3D::~TestRunner3D() {
+    // The renderer's GL objects go before their context
+    renderer.reset();
+    context.reset();
+}
+
+int TestRunner3D::runAll(const std::string& outputDir) {
+    // Until the frame of a tear ends, the solver must not pull the torn ends back
+    // together: strain limiting lets no spring of tear_release grow past 1.1 * 0.2
+    auto torn = std::make_shared<std::vector<std::pair<PointMass*, PointMass*>>>();
+    auto tearCount = std::make_shared<int>(0);
+    auto tornEndsApart = [torn, tearCount](Simulation& sim, int frame) -> std::string {
+        if (frame == 0) {
+            sim.setTearListener([torn](PointMass* a, PointMass* b) { torn->emplace_back(a, b); });
+            return "";
+        }
+        for (const auto& [a, b] : *torn) {
+            float gap = (b->getPosition() - a->getPosition()).magnitude();
+            if (gap <= 0.22f) return "torn spring pulled back to " + std::to_string(gap) + " within its frame";
+        }
+        *tearCount += (int)torn->size();
+        torn->clear();
+        return (frame == 60 && *tearCount == 0) ? "no spring tore" : "";
+    };
+    // The rod reaches its end at frame 30; a cloth it did not carry along was tunneled
+    auto wallCarried = [](Simulation& sim, int frame) -> std::string {
+        if (frame != 30) return "";
+        float deepest = 0.0f;
+        for (int i = 0; i < 36; ++i) deepest = std::min(deepest, sim.getPointMasses()[i]->getPosition().z);
+        return deepest > -0.5f ? "rod passed through the spring cloth" : "";
+    };
+    // Once the rope sleeps on the floor, a pin set on the point mass itself must wake it
+    auto pinnedAt = std::make_shared<int>(0);
+    auto repinWakes = [pinnedAt](Simulation& sim, int frame) -> std::string {
+        if (frame == 0) {
+            *pinnedAt = 0;
+        } else if (*pinnedAt == 0 && sim.getAwakeIslandCount() == 0) {
+            sim.getPointMasses()[9]->setFixed(true);
+            *pinnedAt = frame;
+        } else if (*pinnedAt > 0 && frame == *pinnedAt + 1 && sim.getAwakeIslandCount() == 0) {
+            return "island pinned while asleep stayed asleep";
+        }
+        return (frame == 240 && *pinnedAt == 0) ? "rope never fell asleep" : "";
+    };
+    const std::vector<TestCase> cases = {
+        // The interactive application's demo scene
+        {"default", R"(
+cloth position=0,2,0 size=8,8 spacing=0.2 pins=corners
+rope position=3,0,0 points=10 spacing=0.15 pins=first
+)", 300},
+        {"large_cloth", R"(
+cloth position=-1.6,0,0 size=64,64 spacing=0.05 pins=row
+)", 120},
+        // Free bodies landing on the floor, for contact and restitution
+        {"floor_drop", R"(
+floor y=-1 restitution=0.6
+cloth position=-0.8,0,0 size=16,16 spacing=0.1 pins=none
+rope position=1.5,0.5,0 points=12 spacing=0.1 pins=none
+)", 240},
+        // Pins carried along keyframed paths: a rope on a swinging hook and a cloth on a rig
+        {"kinematic_pins", R"(
+path hook keys=0:2,1,0;1:3,1.5,0;2:2,1,0 interpolation=smooth loop=on
+path rig keys=0:0,0,0;2:0,0,1 interpolation=linear
+rope position=2,1,0 points=12 spacing=0.1 pins=first path=hook
+cloth position=-1,1,0 size=12,12 spacing=0.1 pins=row path=rig
+)", 240},
+        // Pins jump away at t=0.5 and tear every spring to them in one substep
+        {"tear_release", R"(
+solver tearing=on tear_strain=0.5 tethers=on strain_limit=on max_stretch=0.1 multigrid=on
+path jump keys=0:0,0,0;0.5:0,0,0.5 interpolation=step
+rope name=line position=2,0,0 points=12 spacing=0.1 pins=first
+pin body=line vertex=11 path=jump
+cloth position=-1,0,0 size=16,16 spacing=0.1 pins=240,241,242,243,244,245,246,247,248,249,250,251,252,253,254,255 path=jump
+)", 60, tornEndsApart},
+        // A pinned rod swept through a spring cloth, which has no triangles of its own
+        {"ccd_spring_cloth", R"(
+solver ccd=on
+path sweep keys=0:0,0,0;0.5:0,0,-1 interpolation=linear
+cloth name=wall position=-0.5,0,0 size=6,6 spacing=0.2 pins=corners
+rope name=rod position=0,0.1,0.3 points=8 spacing=0.1 pins=0,1,2,3,4,5,6,7 path=sweep
+)", 60, wallCarried},
+        // A free rope comes to rest on the floor and is pinned while asleep
+        {"sleep_repin", R"(
+rope position=0,-0.9,0 points=10 spacing=0.1 pins=none
+)", 240, repinWakes},
+    };
+
+    std::filesystem::create_directories(outputDir);
+    const std::string baselinePath = goldenDir + "/perf_" + perfConfiguration() + ".txt";
+    std::map<std::string, double> baseline = loadBaseline(baselinePath);
+    bool baselineChanged = false;
+
+    int failures = 0;
+    for (const TestCase& test : cases) {
+        try {
+            failures += runCase(test, outputDir, baseline, baselineChanged);
+        } catch (const std::exception& e) {
+            std::cout << "[FAIL] " << test.name << ": " << e.what() << std::endl;
+            ++failures;
+        }
+    }
+    if (baselineChanged) saveBaseline(baselinePath, baseline);
+
+    // Parsers and constraint kernels checked on their own, with files in outputDir
+    const std::vector<std::pair<std::string, std::function<std::string(const std::string&)>>> unitChecks = {
+        {"obj_polygon_fan", objPolygonFan},
+        {"obj_index_forms", objIndexForms},
+        {"triangle_constraints_converge", triangleConstraintsConverge},
+    };
+    for (const auto& [name, check] : unitChecks) {
+        std::string violation;
+        try {
+            violation = check(outputDir);
+        } catch (const std::exception& e) {
+            violation = e.what();
+        }
+        if (violation.empty()) {
+            std::cout << "[PASS] " << name << std::endl;
+        } else {
+            std::cout << "[FAIL] " << name << ": " << violation << std::endl;
+            ++failures;
+        }
+    }
+
+    std::cout << cases.size() << " scenes, " << unitChecks.size() << " unit checks, " << failures << " failed checks"
+              << std::endl;
+    return failures;
+}
+
+int TestRunner3D::runCase(const TestCase& test, const std::string& outputDir, std::map<std::string, double>& baseline,
+                          bool& baselineChanged) {
+    Simulation sim;
+    SceneSettings settings = SceneLoader::loadFromString(test.scene, sim, test.name);
+    std::string violation = test.check ? test.check(sim, 0) : "";
+    int violationFrame = 0;
+
+    GoldenTrajectory actual;
+    actual.particles = Trajectory::sampleParticles((int)sim.getPointMasses().size());
+    std::vector<double> frameMs;
+    frameMs.reserve(test.frames);
+    const double unitMs = calibrationMs();
+    for (int frame = 1; frame <= test.frames; ++frame) {
+        sim.applyGlobalForce(settings.gravity);
+        if (settings.windEnabled) sim.applyGlobalForce(settings.wind);
+        auto t0 = std::chrono::steady_clock::now();
+        sim.update(settings.frameTime);
+        frameMs.push_back(std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - t0).count());
+        if (test.check && violation.empty()) {
+            violation = test.check(sim, frame);
+            violationFrame = frame;
+        }
+
+        if (frame % actual.sampleEvery == 0) {
+            std::vector<float> sample;
+            sample.reserve(actual.particles.size() * 3);
+            for (int index : actual.particles) {
+                Vector3D p = sim.getPointMasses()[index]->getPosition();
+                sample.insert(sample.end(), {p.x, p.y, p.z});
+            }
+            actual.frames.push_back(frame);
+            actual.positions.push_back(std::move(sample));
+        }
+    }
+
+    int failures = 0;
+    const std::string goldenPath = goldenDir + "/" + test.name + ".traj";
+    if (updateGolden) {
+        actual.save(goldenPath);
+        std::cout << "[GOLD] " << test.name << ": wrote " << goldenPath << std::endl;
+    } else {
+        TrajectoryMismatch m = Trajectory::compare(GoldenTrajectory::load(goldenPath), actual, POSITION_TOLERANCE,
+                                                   TOLERANCE_GROWTH, settings.frameTime);
+        if (m.matches) {
+            std::cout << "[PASS] " << test.name << ": trajectory matches over " << test.frames << " frames" << std::endl;
+        } else if (m.tolerance == 0.0f) {
+            std::cout << "[FAIL] " << test.name << ": " << m.reason << std::endl;
+            ++failures;
+        } else {
+            std::cout << "[FAIL] " << test.name << ": " << m.reason << " at frame " << m.frame << ", particle "
+                      << m.particle << " off by " << m.error << " (tolerance " << m.tolerance << ")" << std::endl;
+            ++failures;
+        }
+    }
+
+    if (!violation.empty()) {
+        std::cout << "[FAIL] " << test.name << ": " << violation << " at frame " << violationFrame << std::endl;
+        ++failures;
+    } else if (test.check) {
+        std::cout << "[PASS] " << test.name << ": scene checks hold over " << test.frames << " frames" << std::endl;
+    }
+
+    // The median ignores the odd frame delayed by the scheduler
+    std::nth_element(frameMs.begin(), frameMs.begin() + frameMs.size() / 2, frameMs.end());
+    const double ms = frameMs[frameMs.size() / 2];
+    const double units = ms / unitMs;
+    auto stored = baseline.find(test.name);
+    if (updateBaseline) {
+        baseline[test.name] = units;
+        baselineChanged = true;
+        std::cout << "[TIME] " << test.name << ": " << ms << " ms per frame, " << units
+                  << " calibration units, recorded as baseline" << std::endl;
+    } else if (stored == baseline.end()) {
+        std::cout << "[TIME] " << test.name << ": " << ms << " ms per frame, no baseline for " << perfConfiguration()
+                  << " (record one with --update-baseline)" << std::endl;
+    } else if (units > stored->second * (1.0 + perfThreshold) && (units - stored->second) * unitMs > PERF_NOISE_MS) {
+        std::cout << "[FAIL] " << test.name << ": " << ms << " ms per frame, " << units << " calibration units, baseline "
+                  << stored->second << ", allowed " << (int)(perfThreshold * 100.0f) << "% slower" << std::endl;
+        ++failures;
+    } else {
+        std::cout << "[PASS] " << test.name << ": " << ms << " ms per frame, " << units << " calibration units, baseline "
+                  << stored->second << std::endl;
+    }
+
+    render(sim, outputDir + "/" + test.name + ".ppm");
+    return failures;
+}
+
+void TestRunner3D::render(const Simulation& sim, const std::string& path) {
+    if (renderingUnavailable) return;
+    if (!context) {
+        try {
+            context = std::make_unique<GLFWContext>(width, height, "PBD-X tests", true);
+            renderer = std::make_unique<OpenGLRenderer3D>(width, height);
+            renderer->setViewportSize(width, height);
+        } catch (const std::exception& e) {
+            std::cout << "Frames are not rendered: " << e.what() << std::endl;
+            renderer.reset();
+            context.reset();
+            renderingUnavailable = true;
+            return;
+        }
+    }
+
+    std::vector<float> lines;
+    for (const Spring* spring : sim.getSprings()) {
+        Vector3D a = spring->getPointMass1()->getPosition();
+        Vector3D b = spring->getPointMass2()->getPosition();
+        lines.insert(lines.end(), {a.x, a.y, a.z, b.x, b.y, b.z});
+    }
+    std::vector<float> points;
+    for (const PointMass* pm : sim.getPointMasses()) {
+        Vector3D p = pm->getPosition();
+        points.insert(points.end(), {p.x, p.y, p.z});
+    }
+
+    glClearColor(0.12f, 0.12f, 0.14f, 1.0f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    renderer->beginFrame();
+    renderer->drawGrid(0.5f);
+    renderer->drawLines(lines, glm::vec3(0.9f, 0.9f, 0.9f));
+    renderer->drawPoints(points, glm::vec3(0.2f, 0.7f, 0.9f), 4.0f);
+    renderer->endFrame();
+    context->swapBuffers();
+    if (!renderer->saveFrameAsPPM(path)) {
+        std::cout << "Could not write " << path << std::endl;
+    }
+}
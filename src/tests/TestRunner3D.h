@@ -0,0 +1,71 @@
+#ifndef PBD_X_TESTRUNNER3D_H
+#define PBD_X_TESTRUNNER3D_H
+
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include "GoldenTrajectory.h"
+
+class GLFWContext;
+class OpenGLRenderer3D;
+class Simulation;
+
+// Regression harness for the 3D solver. Each canonical scene is stepped headless and
+// compared frame by frame against its golden trajectory, and its median time per
+// frame, as a multiple of a fixed calibration kernel timed just before, is checked
+// against a committed baseline, so a solver change is caught when it alters results
+// or slows the step down. The final frame of each scene is rendered offscreen into
+// the output directory when an EGL context is available. A few unit checks of the
+// mesh parsers and the triangle constraint kernels run after the scenes.
+//
+// Goldens hold for one floating-point evaluation: a build that contracts to FMA or
+// vectorizes differently (-march=native, another architecture) records its own with
+// --update-golden. Timing baselines sit next to the goldens, one file per build
+// configuration (perf_<architecture>-<release|debug>.txt), and are only written with
+// --update-baseline; a configuration without one reports its timings unchecked.
+class TestRunner3D {
+public:
+    TestRunner3D(int width, int height);
+    ~TestRunner3D();
+
+    // Run every scene; returns the number of failed checks
+    int runAll(const std::string& outputDir);
+
+    // Rewrite the golden trajectories from this run instead of comparing against them
+    void setUpdateGolden(bool update) { updateGolden = update; }
+    // Replace the stored timings with this run's instead of checking against them
+    void setUpdateBaseline(bool update) { updateBaseline = update; }
+    // Allowed slowdown against the baseline as a fraction, 0.25 meaning 25% slower
+    void setPerfThreshold(float fraction) { perfThreshold = fraction; }
+    void setGoldenDir(const std::string& dir) { goldenDir = dir; }
+
+private:
+    struct TestCase {
+        std::string name;
+        std::string scene;
+        int frames;
+        // Optional scene-specific check, called with frame 0 once the scene is built and
+        // then after every frame; a non-empty message fails the scene
+        std::function<std::string(Simulation&, int)> check{};
+    };
+
+    // Returns the number of failed checks of one scene
+    int runCase(const TestCase& test, const std::string& outputDir, std::map<std::string, double>& baseline,
+                bool& baselineChanged);
+    // Draw the springs and particles of sim offscreen and save the frame as a PPM
+    void render(const Simulation& sim, const std::string& path);
+
+    int width;
+    int height;
+    bool updateGolden{false};
+    bool updateBaseline{false};
+    float perfThreshold{0.25f};
+    std::string goldenDir;
+    // Created on first use; null when no offscreen context could be made
+    std::unique_ptr<GLFWContext> context;
+    std::unique_ptr<OpenGLRenderer3D> renderer;
+    bool renderingUnavailable{false};
+};
+
+#endif //PBD_X_TESTRUNNER3D_H